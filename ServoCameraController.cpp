@@ -1,10 +1,16 @@
 // ServoCameraController.cpp
 #include "ServoCameraController.h"
 #include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
 
 ServoCameraController::ServoCameraController(const std::string &ip, int port)
 {
-    client = std::make_unique<ServoControl::ServoClient>(ip, port, 2000);
+    client = std::make_unique<ServoControl::ServoClient>(ip, port, COMMAND_TIMEOUT_MS);
+    // The default GPIO is the tilt servo
+    pitchAxis.enabled = true;
 }
 
 ServoCameraController::~ServoCameraController()
@@ -26,65 +32,211 @@ bool ServoCameraController::start()
         }
     }
 
-    running.store(true);
-    receiveThread = std::thread([this]() {
-        // Example receive loop: poll until running == false.
-        while (running.load()) {
-            // read status or handle keep-alive; avoid blocking forever
-            // use client->poll or similar with timeout; if none exists, use sleeps shorter
-            try {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                // If your ServoClient has a receiver method, call it with nonblocking behavior
-            } catch (...) {
-                // swallow exceptions; ensure thread can end
-            }
-        }
-
-        // On thread exit, ensure client disconnected
-        {
-            std::lock_guard<std::mutex> lg(clientMutex);
-            if (client && client->isConnected())
-                client->disconnect();
+    {
+        std::lock_guard<std::mutex> lk(motionMutex);
+        for (Axis *axis : {&yawAxis, &pitchAxis}) {
+            axis->positionKnown = false;
+            axis->velocity = 0.;
+            axis->lastSent = -1;
+            axis->inFlight = false;
         }
-    });
+        positionDirty = false;
+    }
+    yawSpeed = 0;
+    pitchSpeed = 0;
 
+    running.store(true);
+    for (Axis *axis : {&yawAxis, &pitchAxis}) {
+        if (axis->enabled) queryInitialPosition(*axis);
+    }
+    integratorThread = std::thread([this]() { integratorLoop(); });
     return true;
 }
 
 void ServoCameraController::stop()
 {
-    // 1) set flag
-    running.store(false);
+    // 1) set flag and wake the integrator
+    {
+        std::lock_guard<std::mutex> lk(motionMutex);
+        running.store(false);
+    }
+    motionCv.notify_all();
 
     // 2) join the thread
-    if (receiveThread.joinable()) {
-        receiveThread.join();
+    if (integratorThread.joinable()) {
+        integratorThread.join();
     }
 
-    // 3) ensure client disconnected and freed
+    // 3) disconnect, commands still in flight complete as failed. The client is kept for a restart.
     {
         std::lock_guard<std::mutex> lg(clientMutex);
         if (client && client->isConnected()) {
             client->disconnect();
         }
-        client.reset();
     }
 }
 
 bool ServoCameraController::isRunning() const {
     return running.load();
 }
-// This depends on how your servo API accepts positions vs speeds.
-// Example: convert yaw/pitch speed to servo position commands or call ServoWorker
+
 bool ServoCameraController::setGimbalSpeed(int yaw, int pitch)
 {
-    if (!client || !connected) return false;
-    // For simple approach: map yaw/pitch speed into a relative movement call or position
-    // Here we use a placeholder: client->setPosition(...);
-    // Replace with actual API calls that your ServoClient provides.
+    if (!isRunning()) return false;
+    // Picked up by the next integrator tick
+    yawSpeed = std::clamp(yaw, -100, 100);
+    pitchSpeed = std::clamp(pitch, -100, 100);
+    return true;
+}
+
+void ServoCameraController::setUpdateRate(double hz)
+{
+    if (hz <= 0.) return;
+    std::lock_guard<std::mutex> lk(motionMutex);
+    updateHz = hz;
+}
+
+void ServoCameraController::setMotionLimits(double maxRate, double maxAccel)
+{
+    if (maxRate <= 0. || maxAccel <= 0.) return;
+    std::lock_guard<std::mutex> lk(motionMutex);
+    maxRateDegPerSec = maxRate;
+    maxAccelDegPerSec2 = maxAccel;
+}
+
+void ServoCameraController::setYawGpio(const ServoControl::GpioDefinition &gpio)
+{
+    setAxisGpio(yawAxis, gpio);
+}
+
+void ServoCameraController::setPitchGpio(const ServoControl::GpioDefinition &gpio)
+{
+    setAxisGpio(pitchAxis, gpio);
+}
+
+void ServoCameraController::setAxisGpio(Axis &axis, const ServoControl::GpioDefinition &gpio)
+{
+    {
+        std::lock_guard<std::mutex> lk(motionMutex);
+        axis.gpio = gpio;
+        axis.enabled = true;
+        // Possibly another servo: the axis holds still until its position is read, as at start
+        axis.positionKnown = false;
+        axis.velocity = 0.;
+        axis.lastSent = -1;
+    }
+    // A failed query completes on this thread and takes motionMutex, so not under it
+    if (running.load()) queryInitialPosition(axis);
+}
+
+ServoCameraController::MotionStats ServoCameraController::motionStats() const
+{
+    MotionStats stats;
+    stats.ticks = ticks.load();
+    stats.sends = sends.load();
+    stats.unchanged_skips = unchangedSkips.load();
+    stats.in_flight_skips = inFlightSkips.load();
+    stats.failures = failures.load();
+    return stats;
+}
+
+void ServoCameraController::queryInitialPosition(Axis &axis)
+{
+    ServoControl::ServoRequest request(ServoControl::RequestType::GET_CURRENT_POSITION, axis.gpio);
+    client->sendRequestAsync(request, [this, &axis](const ServoControl::ServoResponse &response) {
+        int position = ServoControl::Utils::extractPositionFromResponse(response);
+        std::lock_guard<std::mutex> lk(motionMutex);
+        // An absolute position set meanwhile wins
+        if (axis.positionKnown) return;
+        if (position < MIN_POSITION || position > MAX_POSITION) {
+            qWarning() << "[ServoCameraController] could not read servo position, assuming center";
+            position = (MIN_POSITION + MAX_POSITION) / 2;
+        }
+        axis.position = position;
+        axis.lastSent = position;
+        axis.positionKnown = true;
+    });
+}
+
+void ServoCameraController::integratorLoop()
+{
+    using clock = std::chrono::steady_clock;
+    auto last = clock::now();
+    auto next = last;
+    std::vector<PendingSend> pending;
+
+    std::unique_lock<std::mutex> lk(motionMutex);
+    while (running.load()) {
+        motionCv.wait_until(lk, next, [this]() { return !running.load() || positionDirty; });
+        if (!running.load()) break;
+        positionDirty = false;
+
+        // Fixed rate on an absolute schedule. An absolute position wakes the loop early without
+        // moving the schedule, ticks missed while busy are skipped rather than bunched.
+        auto now = clock::now();
+        if (now >= next) {
+            auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1. / updateHz));
+            next += period;
+            if (next <= now) next = now + period;
+        }
+        double dt = std::min(std::chrono::duration<double>(now - last).count(), 4. / updateHz);
+        last = now;
+        ticks++;
+
+        pending.clear();
+        if (stepAxis(yawAxis, yawSpeed.load(), dt)) pending.push_back({&yawAxis, yawAxis.gpio, yawAxis.lastSent});
+        if (stepAxis(pitchAxis, pitchSpeed.load(), dt)) pending.push_back({&pitchAxis, pitchAxis.gpio, pitchAxis.lastSent});
+
+        // Sending never blocks, but keep the UI's setters free while it happens
+        lk.unlock();
+        for (const PendingSend &send : pending) sendPosition(send);
+        lk.lock();
+    }
+}
+
+bool ServoCameraController::stepAxis(Axis &axis, int speed, double dt)
+{
+    if (!axis.enabled || !axis.positionKnown) return false;
+
+    // Velocity follows the command with bounded acceleration, the position stops at the ends
+    double targetVelocity = speed / 100. * maxRateDegPerSec;
+    double maxChange = maxAccelDegPerSec2 * dt;
+    axis.velocity += std::clamp(targetVelocity - axis.velocity, -maxChange, maxChange);
+    axis.position += axis.velocity * dt;
+    if (axis.position <= MIN_POSITION || axis.position >= MAX_POSITION) {
+        axis.position = std::clamp(axis.position, double(MIN_POSITION), double(MAX_POSITION));
+        axis.velocity = 0.;
+    }
+
+    int quantized = static_cast<int>(std::lround(axis.position));
+    if (quantized == axis.lastSent) {
+        unchangedSkips++;
+        return false;
+    }
+    if (axis.inFlight.load()) {
+        inFlightSkips++;
+        return false;
+    }
+    axis.lastSent = quantized;
+    axis.inFlight = true;
     return true;
 }
 
+void ServoCameraController::sendPosition(const PendingSend &send)
+{
+    sends++;
+    Axis *axis = send.axis;
+    client->setPositionAsync(send.position, [this, axis](const ServoControl::ServoResponse &response) {
+        if (!ServoControl::Utils::isSuccessResponse(response)) {
+            failures++;
+            // Send the same target again on the next tick
+            std::lock_guard<std::mutex> lk(motionMutex);
+            axis->lastSent = -1;
+        }
+        axis->inFlight = false;
+    }, send.gpio);
+}
+
 void ServoCameraController::setRtspUri(const QString &uri) {
     Q_UNUSED(uri);
     // servo controller typically not responsible for RTSP, keep no-op or forward to video logic
@@ -93,13 +245,21 @@ void ServoCameraController::setRtspUri(const QString &uri) {
 bool ServoCameraController::setGimbalPosition(int yawPos, int pitchPos)
 {
     if (!client || !isRunning()) return false;
-    // Map absolute yaw/pitch to servo positions if you have an API.
-    // Placeholder:
     qDebug() << "[ServoCameraController] Setting absolute position ("
              << yawPos << "," << pitchPos << ")";
-    // If your ServoClient has a method name, call it here, e.g.:
-    // return client->setPosition(yawPos, pitchPos);
-    return true; // or false if not supported
+    {
+        std::lock_guard<std::mutex> lk(motionMutex);
+        for (auto [axis, position] : {std::pair<Axis *, int>{&yawAxis, yawPos}, {&pitchAxis, pitchPos}}) {
+            if (!axis->enabled) continue;
+            axis->position = std::clamp(position, MIN_POSITION, MAX_POSITION);
+            axis->velocity = 0.;
+            axis->positionKnown = true;
+        }
+        positionDirty = true;
+    }
+    // Sent by the integrator right away instead of at the next tick
+    motionCv.notify_all();
+    return true;
 }
 
 bool ServoCameraController::setAbsoluteZoom(float zoomLevel, int speed)
@@ -1,14 +1,30 @@
 // ServoCameraController.h
 #pragma once
 #include "CameraController.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "servo_client.hpp"
 #include <mutex>
 #include <thread>
 
+// Drives servo axes through ServoClient. Speed commands (-100..100, like the SIYI gimbal) are
+// integrated into positions by a fixed-rate thread: the velocity follows the command with a
+// bounded acceleration, the position is clamped to the servo range and only sent when its whole
+// degree changes and the previous command for that axis has been answered.
+// The pitch axis is the servo on the default GPIO, yaw is only driven when a GPIO is set for it.
 class ServoCameraController : public CameraController {
 public:
+    struct MotionStats {
+        uint64_t ticks = 0;            // integrator updates
+        uint64_t sends = 0;            // position commands sent
+        uint64_t unchanged_skips = 0;  // quantized target equal to the last one sent
+        uint64_t in_flight_skips = 0;  // previous command still unanswered, newer target follows
+        uint64_t failures = 0;         // commands that failed or timed out
+    };
+
     ServoCameraController(const std::string &ip, int port);
     ~ServoCameraController() override;
 
@@ -16,19 +32,76 @@ public:
     void stop() override;
     bool isRunning() const override;
 
-    bool setGimbalSpeed(int yaw, int pitch) override; // implement mapping to servo
+    bool setGimbalSpeed(int yaw, int pitch) override; // integrated into servo positions
     bool setAbsoluteZoom(float zoomLevel, int speed = 1) override; // maybe no-op
     bool requestAutofocus() override { return false; }
     void setRtspUri(const QString &uri) override;
     bool setGimbalPosition(int yawPos, int pitchPos) override;
     bool supportsAbsolutePosition() const override;
 
+    // Integrator frequency, 50 Hz by default
+    void setUpdateRate(double hz);
+
+    // Full speed (100) in degrees per second and the largest change of speed per second
+    void setMotionLimits(double maxRateDegPerSec, double maxAccelDegPerSec2);
+
+    // Enables the axis. While running it holds still until the servo reports its position
+    void setYawGpio(const ServoControl::GpioDefinition &gpio);
+    void setPitchGpio(const ServoControl::GpioDefinition &gpio);
+
+    MotionStats motionStats() const;
 
 private:
+    struct Axis {
+        ServoControl::GpioDefinition gpio;
+        bool enabled = false;
+        bool positionKnown = false;   // read from the servo (or assumed centered) at start
+        double position = 90.;        // degrees
+        double velocity = 0.;         // degrees per second, smoothed
+        int lastSent = -1;
+        std::atomic<bool> inFlight{false};
+    };
+
+    struct PendingSend {
+        Axis *axis;
+        ServoControl::GpioDefinition gpio;
+        int position;
+    };
+
+    void integratorLoop();
+    // Advance one axis by dt seconds, true if its new position should be sent. motionMutex held.
+    bool stepAxis(Axis &axis, int speed, double dt);
+    void sendPosition(const PendingSend &send);
+    void queryInitialPosition(Axis &axis);
+    void setAxisGpio(Axis &axis, const ServoControl::GpioDefinition &gpio);
+
     std::unique_ptr<ServoControl::ServoClient> client;
-    // If you have a ServoWorker thread, keep it here and connect signals
-    bool connected = false;
     std::atomic<bool> running{false};
-    std::thread receiveThread;
     mutable std::mutex clientMutex;
+
+    // Motion state, guarded by motionMutex
+    Axis yawAxis;
+    Axis pitchAxis;
+    double updateHz = 50.;
+    double maxRateDegPerSec = 60.;
+    double maxAccelDegPerSec2 = 240.;
+    bool positionDirty = false;       // absolute position set, send without waiting for the tick
+    mutable std::mutex motionMutex;
+    std::condition_variable motionCv;
+    std::thread integratorThread;
+
+    std::atomic<int> yawSpeed{0};
+    std::atomic<int> pitchSpeed{0};
+
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> sends{0};
+    std::atomic<uint64_t> unchangedSkips{0};
+    std::atomic<uint64_t> inFlightSkips{0};
+    std::atomic<uint64_t> failures{0};
+
+    // A lost reply holds its axis until the timeout, and a newer target is usually waiting by
+    // then, so fail fast rather than wait seconds for an answer that will not come
+    static constexpr int COMMAND_TIMEOUT_MS = 250;
+    static constexpr int MIN_POSITION = 0;
+    static constexpr int MAX_POSITION = 180;
 };
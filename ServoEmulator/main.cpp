@@ -0,0 +1,81 @@
+// Stand-alone servo server emulator
+//
+// Usage: servo-emulator [--bind IP] [--port N] [--latency-ms X] [--jitter-ms X] [--loss P]
+//                       [--reorder P] [--reorder-ms X] [--json-only] [--no-request-id] [--seed S]
+// Point the application's servo IP/port at it and stop with Ctrl-C.
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "servo_emulator.hpp"
+
+namespace {
+
+void usage(const char* name) {
+    std::printf("usage: %s [--bind IP] [--port N] [--latency-ms X] [--jitter-ms X] [--loss P] "
+                "[--reorder P] [--reorder-ms X] [--json-only] [--no-request-id] [--seed S]\n", name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ServoControl::ServoEmulator::Config config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--json-only") {
+            config.compact = false;
+            continue;
+        }
+        if (arg == "--no-request-id") {
+            config.echo_request_id = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        const char* value = argv[++i];
+        if (arg == "--bind") config.bind_ip = value;
+        else if (arg == "--port") config.port = std::atoi(value);
+        else if (arg == "--latency-ms") config.latency_us = int(std::atof(value) * 1000.);
+        else if (arg == "--jitter-ms") config.jitter_us = int(std::atof(value) * 1000.);
+        else if (arg == "--loss") config.loss = std::atof(value);
+        else if (arg == "--reorder") config.reorder = std::atof(value);
+        else if (arg == "--reorder-ms") config.reorder_delay_us = int(std::atof(value) * 1000.);
+        else if (arg == "--seed") config.seed = uint32_t(std::strtoul(value, nullptr, 10));
+        else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Signals are taken synchronously below, the emulator thread must not see them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ServoControl::ServoEmulator emulator(config);
+    if (!emulator.start()) return EXIT_FAILURE;
+    std::printf("Servo emulator on %s:%d (latency %.1f ms, jitter %.1f ms, loss %.1f %%, reorder %.1f %%, %s)\n",
+                config.bind_ip.c_str(), emulator.port(), config.latency_us / 1000., config.jitter_us / 1000.,
+                config.loss * 100., config.reorder * 100., config.compact ? "json + compact" : "json only");
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    emulator.stop();
+
+    ServoControl::ServoEmulator::Stats stats = emulator.stats();
+    std::printf("%llu requests (%llu compact), %llu replies, %llu dropped, %llu reordered, %llu malformed\n",
+                (unsigned long long) stats.requests, (unsigned long long) stats.compact_requests,
+                (unsigned long long) stats.replies, (unsigned long long) stats.dropped,
+                (unsigned long long) stats.reordered, (unsigned long long) stats.malformed);
+    return EXIT_SUCCESS;
+}
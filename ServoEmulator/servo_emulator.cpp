@@ -0,0 +1,304 @@
+#include "servo_emulator.hpp"
+#include "servo_client.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <endian.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace ServoControl {
+
+    namespace {
+        int64_t monotonicNs() {
+            struct timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        constexpr int MIN_POSITION = 0;
+        constexpr int MAX_POSITION = 180;
+        constexpr int INITIAL_POSITION = 90;
+    }
+
+    ServoEmulator::ServoEmulator(Config config) : config(std::move(config)), rng(this->config.seed) {}
+
+    ServoEmulator::~ServoEmulator() {
+        stop();
+    }
+
+    bool ServoEmulator::start() {
+        if (running) {
+            return true;
+        }
+
+        socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr(config.bind_ip.c_str());
+        addr.sin_port = htons(config.port);
+        socklen_t addr_len = sizeof(addr);
+
+        bool ok = socket_fd >= 0 && epoll_fd >= 0 && timer_fd >= 0 && wake_fd >= 0 &&
+                  bind(socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+                  getsockname(socket_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0;
+        for (int fd : {socket_fd, timer_fd, wake_fd}) {
+            if (!ok) break;
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            ok = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+        }
+        if (!ok) {
+            std::cerr << "Servo emulator failed to bind " << config.bind_ip << ":" << config.port
+                      << ": " << strerror(errno) << std::endl;
+            for (int* fd : {&socket_fd, &epoll_fd, &timer_fd, &wake_fd}) {
+                if (*fd >= 0) close(*fd);
+                *fd = -1;
+            }
+            return false;
+        }
+        bound_port = ntohs(addr.sin_port);
+
+        running = true;
+        thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void ServoEmulator::stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            std::cerr << "Failed to wake the servo emulator" << std::endl;
+        }
+        if (thread.joinable()) {
+            thread.join();
+        }
+
+        for (int* fd : {&socket_fd, &epoll_fd, &timer_fd, &wake_fd}) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+
+    int ServoEmulator::port() const {
+        return bound_port;
+    }
+
+    ServoEmulator::Stats ServoEmulator::stats() const {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return counters;
+    }
+
+    void ServoEmulator::run() {
+        struct epoll_event events[3];
+        char buffer[1024];
+
+        while (running) {
+            int count = epoll_wait(epoll_fd, events, 3, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Servo emulator epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
+            }
+
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == timer_fd || fd == wake_fd) {
+                    uint64_t value;
+                    while (read(fd, &value, sizeof(value)) > 0) {}
+                    continue;
+                }
+
+                while (true) {
+                    sockaddr_in from{};
+                    socklen_t from_len = sizeof(from);
+                    ssize_t received = recvfrom(socket_fd, buffer, sizeof(buffer) - 1, 0,
+                                                reinterpret_cast<sockaddr*>(&from), &from_len);
+                    if (received <= 0) break;
+
+                    int64_t now = monotonicNs();
+                    if (buffer[0] == '{') {
+                        handleJson(buffer, static_cast<size_t>(received), from, now);
+                    } else {
+                        handleCompact(buffer, static_cast<size_t>(received), from, now);
+                    }
+                }
+            }
+
+            int64_t now = monotonicNs();
+            sendDueReplies(now);
+            armTimer(now);
+        }
+    }
+
+    void ServoEmulator::handleJson(const char* data, size_t len, const sockaddr_in& from, int64_t now_ns) {
+        cJSON* request = cJSON_ParseWithLength(data, len);
+        cJSON* request_type = cJSON_GetObjectItem(request, "request_type");
+        if (!request || !request_type || !cJSON_IsNumber(request_type)) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.malformed++;
+            cJSON_Delete(request);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.requests++;
+        }
+
+        cJSON* new_value = cJSON_GetObjectItem(request, "new_value");
+        cJSON* gpio_line = cJSON_GetObjectItem(cJSON_GetObjectItem(request, "gpio_definition"), "gpio_line");
+        cJSON* request_id = cJSON_GetObjectItem(request, "request_id");
+        cJSON* offer = cJSON_GetObjectItem(request, "accept_wire_format");
+
+        int type = request_type->valueint;
+        int value = new_value && cJSON_IsNumber(new_value) ? new_value->valueint : 0;
+        int position = 0;
+        bool ok = apply(type, value, gpio_line && cJSON_IsNumber(gpio_line) ? gpio_line->valueint : 0, position);
+
+        cJSON* response = cJSON_CreateObject();
+        cJSON_AddNumberToObject(response, "response_type",
+                                static_cast<int>(ok ? ResponseType::SUCCESS : ResponseType::FAILED));
+        std::string message;
+        if (!ok) {
+            message = type == static_cast<int>(RequestType::SET_NEW_POSITION)
+                      ? "Invalid position " + std::to_string(value) : "Unknown request type";
+        } else if (type == static_cast<int>(RequestType::SET_NEW_POSITION)) {
+            message = "Servo position set to " + std::to_string(position);
+        } else {
+            message = "Current servo position: " + std::to_string(position);
+        }
+        cJSON_AddStringToObject(response, "response_message", message.c_str());
+        if (config.echo_request_id && request_id && cJSON_IsNumber(request_id)) {
+            cJSON_AddNumberToObject(response, "request_id", request_id->valuedouble);
+        }
+        if (config.compact && offer && cJSON_IsString(offer) && strcmp(offer->valuestring, Wire::COMPACT_NAME) == 0) {
+            cJSON_AddStringToObject(response, "wire_format", Wire::COMPACT_NAME);
+        }
+
+        char* text = cJSON_PrintUnformatted(response);
+        if (text) {
+            scheduleReply(text, from, now_ns);
+            free(text);
+        }
+        cJSON_Delete(response);
+        cJSON_Delete(request);
+    }
+
+    void ServoEmulator::handleCompact(const char* data, size_t len, const sockaddr_in& from, int64_t now_ns) {
+        Wire::CompactRequest request;
+        if (!config.compact || len < sizeof(request)) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.malformed++;
+            return;
+        }
+        memcpy(&request, data, sizeof(request));
+        if (le16toh(request.magic) != Wire::REQUEST_MAGIC || request.version != Wire::VERSION) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.malformed++;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.requests++;
+            counters.compact_requests++;
+        }
+
+        int position = -1;
+        bool ok = apply(request.request_type, static_cast<int32_t>(le32toh(static_cast<uint32_t>(request.new_value))),
+                        le16toh(request.gpio_line), position);
+
+        Wire::CompactResponse response{};
+        response.magic = htole16(Wire::RESPONSE_MAGIC);
+        response.version = Wire::VERSION;
+        response.response_type = static_cast<uint8_t>(ok ? ResponseType::SUCCESS : ResponseType::FAILED);
+        // Servers from before request IDs never spoke compact, its replies always carry the ID
+        response.request_id = request.request_id;
+        response.position = static_cast<int32_t>(htole32(static_cast<uint32_t>(ok ? position : -1)));
+        scheduleReply(std::string(reinterpret_cast<const char*>(&response), sizeof(response)), from, now_ns);
+    }
+
+    bool ServoEmulator::apply(int request_type, int new_value, int gpio_line, int& position) {
+        auto it = positions.emplace(gpio_line, INITIAL_POSITION).first;
+        if (request_type == static_cast<int>(RequestType::GET_CURRENT_POSITION)) {
+            position = it->second;
+            return true;
+        }
+        if (request_type != static_cast<int>(RequestType::SET_NEW_POSITION) ||
+            new_value < MIN_POSITION || new_value > MAX_POSITION) {
+            return false;
+        }
+
+        it->second = new_value;
+        position = new_value;
+        if (config.on_position) {
+            config.on_position(gpio_line, new_value);
+        }
+        return true;
+    }
+
+    void ServoEmulator::scheduleReply(std::string payload, const sockaddr_in& to, int64_t now_ns) {
+        std::uniform_real_distribution<double> chance(0., 1.);
+        if (config.loss > 0. && chance(rng) < config.loss) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.dropped++;
+            return;
+        }
+
+        int64_t delay_us = config.latency_us;
+        if (config.jitter_us > 0) {
+            delay_us += std::uniform_int_distribution<int>(-config.jitter_us, config.jitter_us)(rng);
+        }
+        if (config.reorder > 0. && chance(rng) < config.reorder) {
+            delay_us += config.reorder_delay_us;
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            counters.reordered++;
+        }
+
+        PendingReply reply;
+        reply.due_ns = now_ns + std::max<int64_t>(delay_us, 0) * 1000;
+        reply.order = reply_order++;
+        reply.payload = std::move(payload);
+        reply.to = to;
+        pending.push(std::move(reply));
+    }
+
+    void ServoEmulator::sendDueReplies(int64_t now_ns) {
+        uint64_t sent = 0;
+        while (!pending.empty() && pending.top().due_ns <= now_ns) {
+            const PendingReply& reply = pending.top();
+            sendto(socket_fd, reply.payload.data(), reply.payload.size(), 0,
+                   reinterpret_cast<const sockaddr*>(&reply.to), sizeof(reply.to));
+            pending.pop();
+            sent++;
+        }
+        if (sent == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        counters.replies += sent;
+    }
+
+    void ServoEmulator::armTimer(int64_t now_ns) {
+        struct itimerspec spec{};
+        if (!pending.empty()) {
+            int64_t next = std::max(pending.top().due_ns, now_ns + 1);
+            spec.it_value.tv_sec = next / 1000000000;
+            spec.it_value.tv_nsec = next % 1000000000;
+        }
+        timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+}
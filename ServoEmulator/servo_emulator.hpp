@@ -0,0 +1,110 @@
+#ifndef SERVO_EMULATOR_HPP
+#define SERVO_EMULATOR_HPP
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Servo Server Emulator
+ *
+ * Stands in for the servo control UDP server on the target board, so ServoClient and everything
+ * built on it can be exercised on a desktop. It speaks the same JSON protocol (and the compact
+ * format when offered), echoes request IDs and keeps one position per GPIO line. Replies can be
+ * delayed, jittered, dropped and reordered.
+ */
+
+namespace ServoControl {
+
+    class ServoEmulator {
+    public:
+        struct Config {
+            std::string bind_ip = "127.0.0.1";
+            int port = 8000;                 // 0 picks a free port, see port()
+            int latency_us = 0;              // added before every reply
+            int jitter_us = 0;               // reply latency varies uniformly by +- this much
+            double loss = 0.;                // probability that a reply is dropped
+            double reorder = 0.;             // probability that a reply is held back ...
+            int reorder_delay_us = 5000;     // ... this much longer, so later replies overtake it
+            bool compact = true;             // accept the compact wire format when offered
+            bool echo_request_id = true;     // false: JSON replies as from servers before request IDs
+            uint32_t seed = 1;
+            // Called on the emulator thread whenever a position is set
+            std::function<void(int gpio_line, int position)> on_position;
+        };
+
+        struct Stats {
+            uint64_t requests = 0;
+            uint64_t compact_requests = 0;
+            uint64_t replies = 0;
+            uint64_t dropped = 0;
+            uint64_t reordered = 0;
+            uint64_t malformed = 0;
+        };
+
+        explicit ServoEmulator(Config config);
+
+        ~ServoEmulator();
+
+        /**
+         * Bind the socket and start answering
+         * @return false if the socket cannot be set up
+         */
+        bool start();
+
+        void stop();
+
+        int port() const;
+
+        Stats stats() const;
+
+    private:
+        struct PendingReply {
+            int64_t due_ns;
+            uint64_t order;  // keeps replies due at the same time in arrival order
+            std::string payload;
+            sockaddr_in to;
+
+            bool operator>(const PendingReply& other) const {
+                return due_ns != other.due_ns ? due_ns > other.due_ns : order > other.order;
+            }
+        };
+
+        void run();
+        void handleJson(const char* data, size_t len, const sockaddr_in& from, int64_t now_ns);
+        void handleCompact(const char* data, size_t len, const sockaddr_in& from, int64_t now_ns);
+        // Apply a request, returns whether it succeeded and the position of the line afterwards
+        bool apply(int request_type, int new_value, int gpio_line, int& position);
+        void scheduleReply(std::string payload, const sockaddr_in& to, int64_t now_ns);
+        void sendDueReplies(int64_t now_ns);
+        void armTimer(int64_t now_ns);
+
+        Config config;
+        std::mt19937 rng;
+        std::map<int, int> positions;  // by GPIO line
+        std::priority_queue<PendingReply, std::vector<PendingReply>, std::greater<PendingReply>> pending;
+        uint64_t reply_order = 0;
+
+        int socket_fd = -1;
+        int epoll_fd = -1;
+        int timer_fd = -1;
+        int wake_fd = -1;
+        int bound_port = 0;
+
+        std::atomic<bool> running{false};
+        std::thread thread;
+
+        Stats counters;
+        mutable std::mutex stats_mutex;
+    };
+}
+
+#endif // SERVO_EMULATOR_HPP
@@ -1,22 +1,131 @@
 #pragma once
 #include <QObject>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include "servo_client.hpp"
+#include "latency_histogram.h"
 
+// Sends servo positions, newest first.
+//
+// setPosition() only stores the target in a one-slot mailbox, so it never blocks and is safe from
+// any thread; connect to it with Qt::DirectConnection so positions do not queue up in the event
+// loop. At most one command is in flight: when its reply (or timeout) arrives the completion
+// wakes the worker, which sends whatever target is newest by then. Targets overwritten before
+// they were sent are counted as superseded and never reach the servo.
 class ServoWorker : public QObject {
   Q_OBJECT
 public:
+  struct Stats {
+    uint64_t submitted = 0;   // setPosition() calls
+    uint64_t sent = 0;        // commands handed to the client
+    uint64_t superseded = 0;  // replaced by a newer target before being sent
+    uint64_t dropped = 0;     // not sent (disconnected) or failed / timed out after sending
+    uint64_t completed = 0;   // acknowledged by the servo
+    // End-to-end command age, from setPosition() to the servo's reply
+    double age_p50_ms = 0.;
+    double age_p99_ms = 0.;
+    double age_max_ms = 0.;
+    double age_mean_ms = 0.;
+  };
+
   explicit ServoWorker(std::unique_ptr<ServoControl::ServoClient> servo, QObject* parent=nullptr)
     : QObject(parent), _servo(std::move(servo)) {}
 
+  ~ServoWorker() override {
+    // Fails the command in flight, its completion sees the client disconnected and stops there
+    if (_servo) _servo->disconnect();
+  }
+
+  Stats stats() const {
+    Stats s;
+    s.submitted = _submitted.load();
+    s.sent = _sent.load();
+    s.superseded = _superseded.load();
+    s.dropped = _dropped.load();
+    s.completed = _completed.load();
+    std::lock_guard<std::mutex> lock(_ageMutex);
+    s.age_p50_ms = _age.value_at_percentile(50.) / 1000.;
+    s.age_p99_ms = _age.value_at_percentile(99.) / 1000.;
+    s.age_max_ms = _age.max() / 1000.;
+    s.age_mean_ms = _age.mean() / 1000.;
+    return s;
+  }
+
 public slots:
   void setPosition(int pos) {
-    if (_servo && _servo->isConnected()) {
-      _servo->setPosition(pos);
-    }
+    uint64_t previous = _slot.exchange(pack(pos, nowUs()));
+    _submitted++;
+    if (previous & SLOT_FULL) _superseded++;
+    pump();
   }
 
 private:
+  // Mailbox word: bit 63 set while it holds a target, bits 32-62 the position, bits 0-31 the
+  // submit time in microseconds (wrapping, ages up to 71 minutes come out right)
+  static constexpr uint64_t SLOT_FULL = uint64_t(1) << 63;
+
+  static uint64_t pack(int pos, uint32_t timeUs) {
+    return SLOT_FULL | (uint64_t(uint32_t(pos) & 0x7fffffffu) << 32) | timeUs;
+  }
+
+  static int unpackPosition(uint64_t slot) {
+    // Sign-extend the 31-bit field
+    return int(uint32_t(slot >> 32) << 1) >> 1;
+  }
+
+  static uint32_t nowUs() {
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // Send the newest target unless a command is already in flight. Whoever clears _inFlight
+  // checks the slot again, so a target stored meanwhile is never stranded.
+  void pump() {
+    while (!_inFlight.exchange(true)) {
+      uint64_t slot = _slot.exchange(0);
+      if ((slot & SLOT_FULL) && send(slot)) return;
+      _inFlight = false;
+      if (!(_slot.load() & SLOT_FULL)) return;
+    }
+  }
+
+  // False if the command could not be handed to the client, the caller still owns _inFlight then
+  bool send(uint64_t slot) {
+    if (!_servo || !_servo->isConnected()) {
+      _dropped++;
+      return false;
+    }
+
+    _sent++;
+    uint32_t submitted = uint32_t(slot);
+    _servo->setPositionAsync(unpackPosition(slot), [this, submitted](const ServoControl::ServoResponse& response) {
+      if (ServoControl::Utils::isSuccessResponse(response)) {
+        _completed++;
+        std::lock_guard<std::mutex> lock(_ageMutex);
+        _age.record(uint32_t(nowUs() - submitted));
+      } else {
+        _dropped++;
+      }
+      _inFlight = false;
+      pump();
+    });
+    return true;
+  }
+
   std::unique_ptr<ServoControl::ServoClient> _servo;
-};
 
+  std::atomic<uint64_t> _slot{0};
+  std::atomic<bool> _inFlight{false};
+
+  std::atomic<uint64_t> _submitted{0};
+  std::atomic<uint64_t> _sent{0};
+  std::atomic<uint64_t> _superseded{0};
+  std::atomic<uint64_t> _dropped{0};
+  std::atomic<uint64_t> _completed{0};
+
+  mutable std::mutex _ageMutex;
+  LatencyHistogram _age;  // microseconds
+};
@@ -3,9 +3,6 @@
 #include <chrono>
 #include <thread>
 
-static constexpr int STOP_WAIT_MS = 300;
-static constexpr int STOP_POLL_MS = 10;
-
 SiyiCameraController::SiyiCameraController(const std::string &ip, int port)
     : sdkIp_(ip), sdkPort_(port)
 {
@@ -42,10 +39,19 @@ void SiyiCameraController::parseRtsp(const QString &uri, std::string &outIp, int
     }
 }
 
+std::shared_ptr<SIYI_SDK> SiyiCameraController::sdk() const
+{
+    return std::atomic_load(&sdkPtr);
+}
+
 bool SiyiCameraController::start()
 {
     std::lock_guard<std::mutex> lk(lifeMutex);
+    return startLocked();
+}
 
+bool SiyiCameraController::startLocked()
+{
     if (running.load()) {
         qDebug() << "[SiyiCameraController] start() called but already running";
         return true;
@@ -54,65 +60,40 @@ bool SiyiCameraController::start()
     qDebug() << "[SiyiCameraController] creating SIYI_SDK instance at"
              << QString::fromStdString(sdkIp_) << sdkPort_;
 
+    std::shared_ptr<SIYI_SDK> sp;
     try {
-        sdkPtr = std::make_shared<SIYI_SDK>(sdkIp_.c_str(), sdkPort_);
+        sp = std::make_shared<SIYI_SDK>(sdkIp_.c_str(), sdkPort_);
 
         // Test connection with a simple command
-        if (!sdkPtr->request_firmware_version()) {
+        if (!sp->request_firmware_version()) {
             qWarning() << "[SiyiCameraController] Failed to communicate with camera";
-            sdkPtr.reset();
             return false;
         }
 
     } catch (const std::exception& e) {
         qWarning() << "[SiyiCameraController] Exception creating SIYI_SDK:" << e.what();
-        sdkPtr.reset();
         return false;
     } catch (...) {
         qWarning() << "[SiyiCameraController] Unknown exception creating SIYI_SDK";
-        sdkPtr.reset();
         return false;
     }
 
-    // Rest of your existing start code...
-    sdkLoopFlagPtr = std::make_shared<bool>(true);
-    threadExited.store(false);
-    threadExitedPtr = std::make_shared<std::atomic<bool>>(false);
-
-    auto capturedSdk = sdkPtr;
-    auto capturedFlag = sdkLoopFlagPtr;
-    auto capturedThreadExited = threadExitedPtr;
-    // Don't use shared_from_this() here to avoid complications, just use the shared ptrs
-    
-    receiveThread = std::thread([capturedSdk, capturedFlag, capturedThreadExited]() {
-        qDebug() << "[SiyiCameraController] receive thread started";
-        if (capturedSdk && capturedFlag) {
-            try {
-                capturedSdk->receive_message_loop(*capturedFlag);
-            } catch (...) {
-                qWarning() << "[SiyiCameraController] receive_message_loop threw";
-            }
-        }
-        qDebug() << "[SiyiCameraController] receive thread exiting";
-        if (capturedThreadExited) {
-            capturedThreadExited->store(true);
-        }
-    });
+    // Receiving and telemetry polling run on the SDK's own I/O thread from here on
+    std::atomic_store(&sdkPtr, sp);
+    followModeAsserted.store(false);
 
     // initial polite queries with error checking
-    if (sdkPtr) {
-        if (!sdkPtr->request_follow_mode()) {
-            qWarning() << "[SiyiCameraController] Failed to set follow mode";
-        }
-        if (!sdkPtr->request_firmware_version()) {
-            qWarning() << "[SiyiCameraController] Failed to request firmware version";
-        }
-        if (!sdkPtr->request_gimbal_center()) {
-            qWarning() << "[SiyiCameraController] Failed to request gimbal center";
-        }
-        if (!sdkPtr->request_autofocus()) {
-            qWarning() << "[SiyiCameraController] Failed to request autofocus";
-        }
+    if (!sp->request_follow_mode()) {
+        qWarning() << "[SiyiCameraController] Failed to set follow mode";
+    }
+    if (!sp->request_firmware_version()) {
+        qWarning() << "[SiyiCameraController] Failed to request firmware version";
+    }
+    if (!sp->request_gimbal_center()) {
+        qWarning() << "[SiyiCameraController] Failed to request gimbal center";
+    }
+    if (!sp->request_autofocus()) {
+        qWarning() << "[SiyiCameraController] Failed to request autofocus";
     }
 
     running.store(true);
@@ -124,44 +105,26 @@ bool SiyiCameraController::start()
 void SiyiCameraController::stop()
 {
     std::lock_guard<std::mutex> lk(lifeMutex);
-    qDebug() << "[SiyiCameraController] stop() enter";
-
-    if (sdkLoopFlagPtr) {
-        *sdkLoopFlagPtr = false;
-    }
+    stopLocked();
+}
 
-    // rename 'start' -> 'tstart' to avoid potential shadowing
-    auto tstart = std::chrono::steady_clock::now();
-    bool joined = false;
-    while (std::chrono::duration_cast<std::chrono::milliseconds>(
-               std::chrono::steady_clock::now() - tstart).count() < STOP_WAIT_MS)
-    {
-        bool exited = threadExited.load();
-        if (threadExitedPtr) {
-            exited = threadExitedPtr->load();
-        }
-        if (exited) {
-            if (receiveThread.joinable()) {
-                try {
-                    receiveThread.join();
-                } catch (const std::system_error &e) {
-                    qWarning() << "[SiyiCameraController] join threw:" << e.what();
-                }
-            }
-            joined = true;
-            break;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(STOP_POLL_MS));
-    }
+void SiyiCameraController::stopLocked()
+{
+    qDebug() << "[SiyiCameraController] stop() enter";
 
-    if (!joined && receiveThread.joinable()) {
-        qWarning() << "[SiyiCameraController] thread didn't exit quickly — detaching";
-        receiveThread.detach();
+    // SIYI_SDK::stop() wakes the I/O thread through its eventfd and joins it, so this is bounded by
+    // one reactor iteration rather than a receive timeout. The socket is closed once the last
+    // command in flight on another thread has dropped its reference.
+    auto sp = std::atomic_exchange(&sdkPtr, std::shared_ptr<SIYI_SDK>());
+    if (sp) {
+        auto tstart = std::chrono::steady_clock::now();
+        sp->stop();
+        sp.reset();
+        qDebug() << "[SiyiCameraController] SDK stopped in"
+                 << std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - tstart).count() << "us";
     }
 
-    sdkPtr.reset();
-    sdkLoopFlagPtr.reset();
-    threadExitedPtr.reset();
     running.store(false);
     qDebug() << "[SiyiCameraController] stop() exit";
 }
@@ -174,7 +137,7 @@ bool SiyiCameraController::isRunning() const
 
 bool SiyiCameraController::setGimbalSpeed(int yawSpeed, int pitchSpeed)
 {
-    auto sp = sdkPtr;
+    auto sp = sdk();
     if (!sp) {
         qWarning() << "[SiyiCameraController] setGimbalSpeed: not connected";
         return false;
@@ -182,13 +145,12 @@ bool SiyiCameraController::setGimbalSpeed(int yawSpeed, int pitchSpeed)
 
     // If we're about to send a non-zero command, ensure the camera is in follow mode.
     // Use a small flag so we only hammer the follow request when needed.
-    static std::atomic<bool> follow_mode_asserted{false};
-
-    if ((yawSpeed != 0 || pitchSpeed != 0) && !follow_mode_asserted.load()) {
+    // It is cleared on every start, a restarted camera has to be told again.
+    if ((yawSpeed != 0 || pitchSpeed != 0) && !followModeAsserted.load()) {
         qDebug() << "[SiyiCameraController] asserting follow mode before movement";
         sp->request_follow_mode();
         std::this_thread::sleep_for(std::chrono::milliseconds(60));
-        follow_mode_asserted.store(true);
+        followModeAsserted.store(true);
     }
 
     qDebug() << "[SiyiCameraController] set_gimbal_speed(" << yawSpeed << "," << pitchSpeed << ")";
@@ -207,7 +169,7 @@ bool SiyiCameraController::setGimbalSpeed(int yawSpeed, int pitchSpeed)
 
     if (!ok) {
         // If still failing, clear asserted flag so we can try again later
-        follow_mode_asserted.store(false);
+        followModeAsserted.store(false);
     }
 
     return ok;
@@ -223,7 +185,7 @@ bool SiyiCameraController::setGimbalPosition(int, int)
 bool SiyiCameraController::setAbsoluteZoom(float zoomLevel, int speed)
 {
     (void) speed;
-    auto sp = sdkPtr;
+    auto sp = sdk();
     if (!sp) return false;
     int integer = static_cast<int>(zoomLevel);
     int fractional = static_cast<int>((zoomLevel - integer) * 1000.0f);
@@ -234,7 +196,7 @@ bool SiyiCameraController::setAbsoluteZoom(float zoomLevel, int speed)
 
 bool SiyiCameraController::requestAutofocus()
 {
-    auto sp = sdkPtr;
+    auto sp = sdk();
     if (!sp) return false;
     return sp->request_autofocus();
 }
@@ -260,43 +222,11 @@ void SiyiCameraController::setRtspUri(const QString &uri)
     sdkIp_ = newIp;
     sdkPort_ = newPort;
 
-    // If running, perform a restart so the SDK connects to new IP/port
+    // If running, perform a restart so the SDK connects to new IP/port. Both halves run under the
+    // lock taken above, start() would deadlock on it.
     if (running.load()) {
         qDebug() << "[SiyiCameraController] restarting controller for new SDK IP/port";
-        // stop (will signal flag and cleanup)
-        if (sdkLoopFlagPtr) {
-            *sdkLoopFlagPtr = false;
-        }
-
-        // rename 'start' -> 'tstart' here as well
-        auto tstart = std::chrono::steady_clock::now();
-        bool joined = false;
-        while (std::chrono::duration_cast<std::chrono::milliseconds>(
-                   std::chrono::steady_clock::now() - tstart).count() < STOP_WAIT_MS)
-        {
-            bool exited = threadExited.load();
-            if (threadExitedPtr) {
-                exited = threadExitedPtr->load();
-            }
-            if (exited) {
-                if (receiveThread.joinable()) {
-                    try { receiveThread.join(); } catch(...) {}
-                }
-                joined = true;
-                break;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(STOP_POLL_MS));
-        }
-        if (!joined && receiveThread.joinable()) {
-            receiveThread.detach();
-        }
-
-        // release old SDK object and create new one
-        sdkPtr.reset();
-        sdkLoopFlagPtr.reset();
-        running.store(false);
-
-        // now start fresh (calls the member function start())
-        start();
+        stopLocked();
+        startLocked();
     }
 }
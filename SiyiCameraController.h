@@ -4,7 +4,6 @@
 #include "thirdparty/SIYI-SDK/src/sdk.h"
 #include <QString>
 #include <string>
-#include <thread>
 #include <mutex>
 #include <atomic>
 #include <memory>
@@ -32,19 +31,24 @@ private:
     // parse RTSP into ip/port if needed
     void parseRtsp(const QString &uri, std::string &outIp, int &outPort);
 
+    // lifecycle with lifeMutex already held, so setRtspUri can restart in one critical section
+    bool startLocked();
+    void stopLocked();
+
+    // current SDK or null, safe to call while another thread restarts the controller
+    std::shared_ptr<SIYI_SDK> sdk() const;
+
     QString rtspUri_;
     std::string sdkIp_;
     int sdkPort_ = 37260;
 
-    // SDK ownership and thread control
+    // SDK ownership. The SDK runs its own I/O thread and stops it on stop(), there is no
+    // receive thread here to wait for. Swapped with std::atomic_load/atomic_store.
     std::shared_ptr<SIYI_SDK> sdkPtr;
-    std::shared_ptr<bool> sdkLoopFlagPtr;
-    std::thread receiveThread;
-    std::shared_ptr<std::atomic<bool>> threadExitedPtr;
 
     mutable std::mutex lifeMutex;
     std::atomic<bool> running{false};
-    std::atomic<bool> threadExited{false};
+    std::atomic<bool> followModeAsserted{false};
     int lastSentYaw = 50;
     int lastSentPitch = 50;
 };
@@ -0,0 +1,326 @@
+// FragmentWriter.cpp
+#include "FragmentWriter.h"
+#include <QDebug>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Payload of the first child box of the given type among the boxes in data
+bool findBox(const guint8 *data, size_t size, const char *type, const guint8 **payload, size_t *payloadSize) {
+    size_t offset = 0;
+    while (offset + 8 <= size) {
+        guint64 boxSize = GST_READ_UINT32_BE(data + offset);
+        size_t headerSize = 8;
+        if (boxSize == 1) {
+            if (offset + 16 > size) return false;
+            boxSize = GST_READ_UINT64_BE(data + offset + 8);
+            headerSize = 16;
+        } else if (boxSize == 0) {
+            boxSize = size - offset;
+        }
+        if (boxSize < headerSize || boxSize > size - offset) return false;
+        if (memcmp(data + offset + 4, type, 4) == 0) {
+            *payload = data + offset + headerSize;
+            *payloadSize = size_t(boxSize) - headerSize;
+            return true;
+        }
+        offset += size_t(boxSize);
+    }
+    return false;
+}
+
+// Walks down a path of boxes, "trak/mdia/mdhd" style, one four-letter type per step
+bool findPath(const guint8 *data, size_t size, const char *path, const guint8 **payload, size_t *payloadSize) {
+    for (const char *type = path; ; type += 5) {
+        if (!findBox(data, size, type, &data, &size)) return false;
+        if (type[4] == '\0') break;
+    }
+    *payload = data;
+    *payloadSize = size;
+    return true;
+}
+
+// moov: the media timescale of the first track
+guint32 readTimescale(const guint8 *moov, size_t size) {
+    const guint8 *mdhd;
+    size_t mdhdSize;
+    if (!findPath(moov, size, "trak/mdia/mdhd", &mdhd, &mdhdSize) || mdhdSize < 1) return 0;
+    size_t at = mdhd[0] == 1 ? 20 : 12;   // after version/flags and the creation/modification times
+    return mdhdSize >= at + 4 ? GST_READ_UINT32_BE(mdhd + at) : 0;
+}
+
+// moof: decode time of its first sample, in the track's timescale
+bool readDecodeTime(const guint8 *moof, size_t size, guint64 *time) {
+    const guint8 *tfdt;
+    size_t tfdtSize;
+    if (!findPath(moof, size, "traf/tfdt", &tfdt, &tfdtSize) || tfdtSize < 8) return false;
+    if (tfdt[0] == 1) {
+        if (tfdtSize < 12) return false;
+        *time = GST_READ_UINT64_BE(tfdt + 4);
+    } else {
+        *time = GST_READ_UINT32_BE(tfdt + 4);
+    }
+    return true;
+}
+
+} // namespace
+
+FragmentWriter::FragmentWriter() = default;
+
+FragmentWriter::~FragmentWriter() {
+    close();
+}
+
+QString FragmentWriter::indexPath(const QString &path) {
+    return path + ".idx";
+}
+
+bool FragmentWriter::open(const QString &newPath) {
+    if (isOpen()) return false;
+
+    void *memory = nullptr;
+    if (posix_memalign(&memory, WRITE_ALIGNMENT, WRITE_BUFFER_BYTES) != 0) {
+        qCritical() << "[FragmentWriter] open: cannot allocate the write buffer";
+        return false;
+    }
+    fd = ::open(newPath.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    indexFd = ::open(indexPath(newPath).toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || indexFd < 0) {
+        qCritical() << "[FragmentWriter] open: cannot create" << newPath << ":" << strerror(errno);
+        if (fd >= 0) ::close(fd);
+        if (indexFd >= 0) ::close(indexFd);
+        fd = indexFd = -1;
+        free(memory);
+        return false;
+    }
+
+    buffer = static_cast<guint8*>(memory);
+    buffered = 0;
+    written = 0;
+    headerFill = 0;
+    boxStart = boxSize = boxLeft = 0;
+    boxData.clear();
+    timescale = 0;
+    fragmentStart = 0;
+    fragmentTime = -1.;
+    fragments = 0;
+    writeFailed = false;
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        error.clear();
+    }
+    path = newPath;
+    closing = false;
+
+    static const char indexHeader[] = "# offset size start_s\n";
+    writeAll(indexFd, indexHeader, sizeof(indexHeader) - 1);
+
+    thread = std::thread([this]() { run(); });
+    return true;
+}
+
+void FragmentWriter::write(GstBuffer *data) {
+    gsize size = gst_buffer_get_size(data);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return queuedBytes < MAX_QUEUED_BYTES || closing; });
+        if (closing) return;
+        queue.push_back(gst_buffer_ref(data));
+        queuedBytes += size;
+    }
+    cond.notify_all();
+}
+
+bool FragmentWriter::close() {
+    if (!isOpen()) return !writeFailed;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    cond.notify_all();
+    thread.join();
+
+    ::close(fd);
+    ::close(indexFd);
+    fd = indexFd = -1;
+    free(buffer);
+    buffer = nullptr;
+    qDebug() << "[FragmentWriter] closed" << path << "," << fragments << "fragments," << written << "bytes";
+    return !writeFailed;
+}
+
+QString FragmentWriter::errorString() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return error;
+}
+
+void FragmentWriter::run() {
+    for (;;) {
+        GstBuffer *next;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return !queue.empty() || closing; });
+            if (queue.empty()) break;
+            next = queue.front();
+            queue.pop_front();
+            queuedBytes -= gst_buffer_get_size(next);
+        }
+        cond.notify_all();
+
+        GstMapInfo map;
+        if (!writeFailed && gst_buffer_map(next, &map, GST_MAP_READ)) {
+            scan(map.data, map.size);
+            gst_buffer_unmap(next, &map);
+        }
+        gst_buffer_unref(next);
+    }
+
+    // Whatever follows the last fragment (mfra), and a line that says the file was closed cleanly
+    if (flush() && fdatasync(fd) != 0) {
+        fail(QString("Cannot sync %1: %2").arg(path, strerror(errno)));
+    }
+    char line[64];
+    int length = snprintf(line, sizeof(line), "# end %llu\n", static_cast<unsigned long long>(written));
+    if (!writeFailed) writeAll(indexFd, line, size_t(length));
+}
+
+// Follows the top-level boxes while handing the bytes on to the file, so a fragment can be synced
+// the moment its mdat is complete
+void FragmentWriter::scan(const guint8 *data, gsize size) {
+    while (size > 0) {
+        if (boxSize == 0) {
+            size_t want = headerFill < 8 ? 8 - headerFill
+                        : GST_READ_UINT32_BE(header) == 1 ? 16 - headerFill : 0;
+            size_t take = std::min<size_t>(want, size);
+            memcpy(header + headerFill, data, take);
+            headerFill += take;
+            append(data, take);
+            data += take;
+            size -= take;
+            if (headerFill < 8) continue;
+
+            guint64 size32 = GST_READ_UINT32_BE(header);
+            if (size32 == 1 && headerFill < 16) continue;
+            size_t headerSize = size32 == 1 ? 16 : 8;
+            boxSize = size32 == 1 ? GST_READ_UINT64_BE(header + 8)
+                    : size32 == 0 ? G_MAXUINT64                     // runs to the end of the file
+                    : size32;
+            if (boxSize < headerSize) boxSize = headerSize;
+            boxLeft = boxSize - headerSize;
+            memcpy(boxType, header + 4, 4);
+
+            boxData.clear();
+            if (memcmp(boxType, "moov", 4) == 0 || memcmp(boxType, "moof", 4) == 0) {
+                boxData.assign(header, header + headerSize);
+            }
+            if (memcmp(boxType, "moof", 4) == 0) {
+                fragmentStart = boxStart;
+                fragmentTime = -1.;
+            }
+            if (boxLeft == 0) boxComplete();
+            continue;
+        }
+
+        size_t take = size_t(std::min<guint64>(boxLeft, size));
+        if (!boxData.empty()) {
+            if (boxData.size() + take <= MAX_KEPT_BOX_BYTES) {
+                boxData.insert(boxData.end(), data, data + take);
+            } else {
+                boxData.clear();
+            }
+        }
+        append(data, take);
+        data += take;
+        size -= take;
+        boxLeft -= take;
+        if (boxLeft == 0) boxComplete();
+    }
+}
+
+void FragmentWriter::boxComplete() {
+    if (!boxData.empty()) {
+        size_t headerSize = GST_READ_UINT32_BE(boxData.data()) == 1 ? 16 : 8;
+        const guint8 *payload = boxData.data() + headerSize;
+        size_t payloadSize = boxData.size() - headerSize;
+        if (memcmp(boxType, "moov", 4) == 0) {
+            timescale = readTimescale(payload, payloadSize);
+        } else {
+            guint64 decodeTime;
+            fragmentTime = timescale && readDecodeTime(payload, payloadSize, &decodeTime)
+                         ? double(decodeTime) / timescale : -1.;
+        }
+    }
+
+    bool initDone = memcmp(boxType, "moov", 4) == 0;
+    bool fragmentDone = memcmp(boxType, "mdat", 4) == 0;
+    guint64 end = boxStart + boxSize;
+    boxStart = end;
+    boxSize = 0;
+    headerFill = 0;
+    boxData.clear();
+    if (!initDone && !fragmentDone) return;
+
+    // The header or a whole fragment is in: on disk it goes, before the index points at it
+    if (!flush()) return;
+    if (fdatasync(fd) != 0) {
+        fail(QString("Cannot sync %1: %2").arg(path, strerror(errno)));
+        return;
+    }
+    if (!fragmentDone) return;
+
+    char line[96];
+    int length = snprintf(line, sizeof(line), "%llu %llu %.3f\n",
+                          static_cast<unsigned long long>(fragmentStart),
+                          static_cast<unsigned long long>(end - fragmentStart), fragmentTime);
+    writeAll(indexFd, line, size_t(length));
+    fragments++;
+}
+
+void FragmentWriter::append(const guint8 *data, gsize size) {
+    while (size > 0 && !writeFailed) {
+        size_t take = std::min<size_t>(WRITE_BUFFER_BYTES - buffered, size);
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        size -= take;
+        if (buffered == WRITE_BUFFER_BYTES) flush();
+    }
+}
+
+bool FragmentWriter::flush() {
+    if (writeFailed) return false;
+    if (buffered == 0) return true;
+    if (!writeAll(fd, buffer, buffered)) return false;
+    written += buffered;
+    buffered = 0;
+    return true;
+}
+
+void FragmentWriter::fail(const QString &what) {
+    if (writeFailed.exchange(true)) return;
+    qWarning() << "[FragmentWriter]" << what;
+    std::lock_guard<std::mutex> lock(errorMutex);
+    error = what;
+}
+
+bool FragmentWriter::writeAll(int target, const void *data, size_t size) {
+    const auto *bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t done = ::write(target, bytes, size);
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            fail(QString("Cannot write %1: %2").arg(target == fd ? path : indexPath(path), strerror(errno)));
+            return false;
+        }
+        bytes += done;
+        size -= size_t(done);
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#ifndef FRAGMENTWRITER_H
+#define FRAGMENTWRITER_H
+
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gst/gst.h>
+
+// Writes a fragmented MP4 byte stream to disk from its own thread. The muxer's thread only queues
+// buffers; the writer gathers them in a large aligned buffer and writes it out when it is full or
+// a fragment (moof + mdat) is complete, then syncs the file and appends the fragment to a small
+// text index next to it ("<file>.idx": byte offset, size and start time per fragment). After a
+// crash the file is readable up to the last complete fragment, and the index says where that is.
+class FragmentWriter {
+public:
+    FragmentWriter();
+    ~FragmentWriter();
+
+    // Creates the file and its index and starts the writer thread
+    bool open(const QString &path);
+    // Muxer thread. Takes a ref; blocks while too much is waiting for the disk, which backs up
+    // into the recorder's appsrc and its keyframe-aligned dropping
+    void write(GstBuffer *data);
+    // Writes what is queued, ends the index and joins the thread. False if any write failed
+    bool close();
+    bool isOpen() const { return thread.joinable(); }
+    bool failed() const { return writeFailed; }
+    QString errorString() const;
+
+    static QString indexPath(const QString &path);
+
+private:
+    void run();
+    void scan(const guint8 *data, gsize size);
+    void boxComplete();
+    void append(const guint8 *data, gsize size);
+    bool flush();
+    void fail(const QString &what);
+    bool writeAll(int target, const void *data, size_t size);
+
+    // Queue between the muxer thread and the writer thread
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<GstBuffer*> queue;
+    size_t queuedBytes = 0;
+    bool closing = false;
+    std::thread thread;
+
+    // Writer thread only
+    int fd = -1;
+    int indexFd = -1;
+    guint8 *buffer = nullptr;             // WRITE_BUFFER_BYTES, page aligned
+    size_t buffered = 0;
+    guint64 written = 0;                  // bytes of the stream handed to the file so far
+
+    // Top-level box tracking over the byte stream
+    guint8 header[16] = {};
+    size_t headerFill = 0;
+    guint64 boxStart = 0;
+    guint64 boxSize = 0;                  // 0 while the header is incomplete
+    guint64 boxLeft = 0;                  // payload bytes still to come
+    char boxType[5] = {};
+    std::vector<guint8> boxData;          // moov and moof are kept to read the timing from
+    guint32 timescale = 0;                // of the first track, from moov
+    guint64 fragmentStart = 0;            // offset of the current moof
+    double fragmentTime = -1.;            // its start in seconds, -1 if unknown
+    quint64 fragments = 0;
+
+    std::atomic<bool> writeFailed{false};
+    mutable std::mutex errorMutex;
+    QString error;
+    QString path;
+
+    static constexpr size_t WRITE_BUFFER_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t WRITE_ALIGNMENT = 4096;
+    static constexpr size_t MAX_QUEUED_BYTES = 32 * 1024 * 1024;
+    static constexpr size_t MAX_KEPT_BOX_BYTES = 1024 * 1024;
+};
+
+#endif // FRAGMENTWRITER_H
@@ -0,0 +1,453 @@
+// StreamRecorder.cpp
+#include "StreamRecorder.h"
+#include <QDebug>
+#include <QFile>
+#include <QMetaObject>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrent>
+
+namespace {
+// Gap left when the live timestamps restart, one frame at 30 fps
+constexpr GstClockTime RESTART_GAP = GST_SECOND / 30;
+} // namespace
+
+StreamRecorder::StreamRecorder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+StreamRecorder::~StreamRecorder() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pipeline) {
+        // Nobody is left to run the bus watch or a worker's report, finalise the file here.
+        // Anything written needs it, also while waiting for a keyframe after a drop
+        bool finalise = haveOffset || state == State::Finalizing;
+        if (finalise && state != State::Finalizing) {
+            gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+        }
+        QString file = path;
+        Detached detached = detach();
+        if (finalise) {
+            GstBus *bus = gst_element_get_bus(detached.pipeline);
+            GstMessage *msg = gst_bus_timed_pop_filtered(bus, FINALIZE_TIMEOUT_MS * GST_MSECOND,
+                                                         GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+            if (!msg || GST_MESSAGE_TYPE(msg) != GST_MESSAGE_EOS) {
+                qWarning() << "[StreamRecorder] could not finalise" << file;
+            }
+            if (msg) gst_message_unref(msg);
+            gst_object_unref(bus);
+        }
+        shutdown(detached);
+    }
+    clearPreroll();
+    if (streamCaps) gst_caps_unref(streamCaps);
+}
+
+bool StreamRecorder::start(const QString &newPath) {
+    bool startedNow = false;
+    if (!startLocked(newPath, startedNow)) {
+        return false;
+    }
+    if (startedNow) {
+        emit started(newPath);
+    }
+    return true;
+}
+
+bool StreamRecorder::startLocked(const QString &newPath, bool &startedNow) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state != State::Idle) {
+        qWarning() << "[StreamRecorder] start: already recording" << path;
+        return false;
+    }
+    if (!streamCaps) {
+        qWarning() << "[StreamRecorder] start: no stream to record";
+        return false;
+    }
+
+    const gchar *codec = gst_structure_get_name(gst_caps_get_structure(streamCaps, 0));
+    const char *parserName = g_str_has_prefix(codec, "video/x-h265") ? "h265parse"
+                           : g_str_has_prefix(codec, "video/x-h264") ? "h264parse"
+                           : nullptr;
+    if (!parserName) {
+        qWarning() << "[StreamRecorder] start: cannot record" << codec;
+        return false;
+    }
+    bool matroska = newPath.endsWith(".mkv", Qt::CaseInsensitive);
+    bool fragmented = fragmentMs > 0 && !matroska;
+
+    pipeline             = gst_pipeline_new("recorder");
+    appsrc               = gst_element_factory_make("appsrc",    "recordsrc");
+    GstElement *parser   = gst_element_factory_make(parserName,  "recordparser");
+    GstElement *muxer    = gst_element_factory_make(matroska ? "matroskamux" : "mp4mux", "recordmux");
+    GstElement *sink     = gst_element_factory_make(fragmented ? "appsink" : "filesink", "recordsink");
+
+    if (!pipeline || !appsrc || !parser || !muxer || !sink) {
+        qCritical() << "[StreamRecorder] start: failed to create the recording pipeline";
+        for (GstElement *element : {pipeline, appsrc, parser, muxer, sink}) {
+            if (element) gst_object_unref(element);
+        }
+        pipeline = nullptr;
+        appsrc = nullptr;
+        return false;
+    }
+
+    // Never block the live streaming thread: past the backlog limit access units are dropped
+    // until the next keyframe instead
+    g_object_set(appsrc,
+                 "caps", streamCaps,
+                 "format", GST_FORMAT_TIME,
+                 "is-live", TRUE,
+                 "block", FALSE,
+                 "max-bytes", guint64(MAX_BACKLOG_BYTES + prerollSize),
+                 nullptr);
+    GstAppSrcCallbacks callbacks = {};
+    callbacks.need_data = StreamRecorder::onNeedData;
+    callbacks.enough_data = StreamRecorder::onEnoughData;
+    gst_app_src_set_callbacks(GST_APP_SRC(appsrc), &callbacks, this, nullptr);
+
+    if (fragmented) {
+        // moov up front and a moof + mdat per fragment, nothing to seek back to at the end
+        g_object_set(muxer, "fragment-duration", fragmentMs, "streamable", TRUE, nullptr);
+        g_object_set(sink, "sync", FALSE, "emit-signals", FALSE, nullptr);
+        GstAppSinkCallbacks sinkCallbacks = {};
+        sinkCallbacks.new_sample = StreamRecorder::onFragmentData;
+        // The writer outlives the recorder while it is being closed, the sink talks only to it
+        writer = std::make_shared<FragmentWriter>();
+        gst_app_sink_set_callbacks(GST_APP_SINK(sink), &sinkCallbacks, writer.get(), nullptr);
+    } else {
+        g_object_set(sink, "location", newPath.toUtf8().constData(), nullptr);
+    }
+
+    gst_bin_add_many(GST_BIN(pipeline), appsrc, parser, muxer, sink, nullptr);
+    if (!gst_element_link_many(appsrc, parser, muxer, sink, nullptr)
+        || (fragmented && !writer->open(newPath))) {
+        qCritical() << "[StreamRecorder] start: failed to set up the recording pipeline for" << newPath;
+        gst_object_unref(pipeline);
+        pipeline = nullptr;
+        appsrc = nullptr;
+        writer.reset();
+        return false;
+    }
+
+    GstBus *bus = gst_element_get_bus(pipeline);
+    gst_bus_add_watch(bus, StreamRecorder::busCall, this);
+    gst_object_unref(bus);
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        qCritical() << "[StreamRecorder] start: cannot open" << newPath;
+        // Nothing flows yet, stopping it here is quick
+        Detached detached = detach();
+        shutdown(detached);
+        return false;
+    }
+
+    path = newPath;
+    haveOffset = false;
+    offset = 0;
+    lastTime = GST_CLOCK_TIME_NONE;
+    backlogFull = false;
+    droppedUnits = 0;
+    state = State::WaitingForKeyframe;
+    qDebug() << "[StreamRecorder] start:" << path << "(" << parserName << (matroska ? "matroskamux" : "mp4mux")
+             << (fragmented ? QString("%1 ms fragments").arg(fragmentMs) : QString()) << ")";
+
+    // The file begins with what was received before the start, the ring starts on a keyframe
+    size_t prerollUnits = preroll.size();
+    for (GstBuffer *buffer : preroll) {
+        startedNow = writeUnit(buffer) || startedNow;
+    }
+    if (prerollUnits > 0) {
+        qDebug() << "[StreamRecorder] start: wrote" << prerollUnits << "pre-roll access units," << prerollSize << "bytes";
+    }
+    return true;
+}
+
+void StreamRecorder::stop() {
+    QString abandoned;
+    Detached detached;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state == State::Idle || state == State::Finalizing) return;
+
+        if (!haveOffset) {
+            // Nothing written yet, there is no file to finalise. Waiting for a keyframe after
+            // a drop or a restart is not that, the file has data and gets finalised
+            abandoned = path;
+            detached = detach();
+        } else {
+            // The muxer finishes the file on EOS, busCall reports it
+            state = State::Finalizing;
+            gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+            qDebug() << "[StreamRecorder] stop: finalising" << path << "," << droppedUnits << "access units dropped";
+        }
+    }
+    if (!abandoned.isEmpty()) {
+        finish(std::move(detached), abandoned, Outcome::Abandoned);
+    }
+}
+
+bool StreamRecorder::isRecording() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state == State::WaitingForKeyframe || state == State::Recording;
+}
+
+void StreamRecorder::pushAccessUnit(GstBuffer *buffer, GstCaps *caps) {
+    bool startedNow = false;
+    QString startedPath;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (caps && (!streamCaps || !gst_caps_is_equal(caps, streamCaps))) {
+            gst_caps_replace(&streamCaps, caps);
+            // Access units of the old caps cannot go in front of the new ones
+            clearPreroll();
+            if (appsrc && state != State::Finalizing) {
+                gst_app_src_set_caps(GST_APP_SRC(appsrc), caps);
+            }
+        }
+        addToPreroll(buffer);
+        if (state == State::WaitingForKeyframe || state == State::Recording) {
+            startedNow = writeUnit(buffer);
+            startedPath = path;
+        }
+    }
+
+    if (startedNow) {
+        emit started(startedPath);
+    }
+}
+
+bool StreamRecorder::writeUnit(GstBuffer *buffer) {
+    GstClockTime time = GST_BUFFER_DTS_OR_PTS(buffer);
+    if (!GST_CLOCK_TIME_IS_VALID(time)) return false;
+    bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    bool startedNow = false;
+
+    // A file starts with a keyframe, and so does the rest of it after anything was dropped
+    if (backlogFull) {
+        droppedUnits++;
+        if (state == State::Recording) state = State::WaitingForKeyframe;
+        return false;
+    }
+    if (state == State::WaitingForKeyframe) {
+        if (!keyframe) return false;
+        if (!haveOffset) {
+            // The file starts at zero with this keyframe
+            offset = -GstClockTimeDiff(time);
+            haveOffset = true;
+            startedNow = true;
+        }
+        state = State::Recording;
+    }
+
+    // When the live pipeline restarts its timestamps start over, the file carries on from
+    // where it was. Small steps back are B-frames without DTS, not a restart
+    GstClockTimeDiff fileTime = GstClockTimeDiff(time) + offset;
+    if (fileTime < 0 || (GST_CLOCK_TIME_IS_VALID(lastTime) && fileTime + GstClockTimeDiff(GST_SECOND) < GstClockTimeDiff(lastTime))) {
+        if (!keyframe) {
+            droppedUnits++;
+            state = State::WaitingForKeyframe;
+            return startedNow;
+        }
+        qDebug() << "[StreamRecorder] live timestamps restarted, resuming" << path;
+        offset = GstClockTimeDiff(lastTime + RESTART_GAP) - GstClockTimeDiff(time);
+        fileTime = GstClockTimeDiff(time) + offset;
+    }
+
+    // Shallow copy: new timestamps, same memory
+    GstBuffer *out = gst_buffer_copy(buffer);
+    if (GST_BUFFER_PTS_IS_VALID(buffer)) GST_BUFFER_PTS(out) = GstClockTime(GstClockTimeDiff(GST_BUFFER_PTS(buffer)) + offset);
+    if (GST_BUFFER_DTS_IS_VALID(buffer)) GST_BUFFER_DTS(out) = GstClockTime(GstClockTimeDiff(GST_BUFFER_DTS(buffer)) + offset);
+    if (!GST_CLOCK_TIME_IS_VALID(lastTime) || GstClockTime(fileTime) > lastTime) lastTime = GstClockTime(fileTime);
+    gst_app_src_push_buffer(GST_APP_SRC(appsrc), out);
+    return startedNow;
+}
+
+// --- pre-roll ------------------------------------------------------------------
+//
+// The ring holds whole GOPs: it always starts with a keyframe, and when it grows past its byte
+// budget the oldest GOP goes as a whole. A GOP larger than the whole budget empties it, and
+// filling starts again at the next keyframe.
+
+void StreamRecorder::setPrerollBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    prerollLimit = bytes;
+    trimPreroll();
+}
+
+size_t StreamRecorder::prerollBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return prerollLimit;
+}
+
+GstClockTime StreamRecorder::prerollDuration() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (preroll.size() < 2) return 0;
+    GstClockTime first = GST_BUFFER_DTS_OR_PTS(preroll.front());
+    GstClockTime last = GST_BUFFER_DTS_OR_PTS(preroll.back());
+    if (!GST_CLOCK_TIME_IS_VALID(first) || !GST_CLOCK_TIME_IS_VALID(last) || last < first) return 0;
+    return last - first;
+}
+
+void StreamRecorder::discardPreroll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearPreroll();
+}
+
+void StreamRecorder::setFragmentDuration(guint ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    fragmentMs = ms;
+}
+
+guint StreamRecorder::fragmentDuration() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fragmentMs;
+}
+
+void StreamRecorder::addToPreroll(GstBuffer *buffer) {
+    if (prerollLimit == 0) return;
+    bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (preroll.empty() && !keyframe) return;
+
+    preroll.push_back(gst_buffer_ref(buffer));
+    prerollSize += gst_buffer_get_size(buffer);
+    trimPreroll();
+}
+
+void StreamRecorder::trimPreroll() {
+    while (prerollSize > prerollLimit && !preroll.empty()) {
+        // Drop the oldest keyframe and everything up to the next one
+        do {
+            prerollSize -= gst_buffer_get_size(preroll.front());
+            gst_buffer_unref(preroll.front());
+            preroll.pop_front();
+        } while (!preroll.empty() && GST_BUFFER_FLAG_IS_SET(preroll.front(), GST_BUFFER_FLAG_DELTA_UNIT));
+    }
+}
+
+void StreamRecorder::clearPreroll() {
+    for (GstBuffer *buffer : preroll) {
+        gst_buffer_unref(buffer);
+    }
+    preroll.clear();
+    prerollSize = 0;
+}
+
+gboolean StreamRecorder::busCall(GstBus * /*bus*/, GstMessage *msg, gpointer data) {
+    auto *self = static_cast<StreamRecorder*>(data);
+
+    switch (GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_EOS: {
+        QString finished;
+        Detached detached;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            finished = self->path;
+            detached = self->detach();
+        }
+        self->finish(std::move(detached), finished, Outcome::Finalised);
+        return FALSE;
+    }
+    case GST_MESSAGE_ERROR: {
+        GError *err = nullptr;
+        gchar  *dbg = nullptr;
+        gst_message_parse_error(msg, &err, &dbg);
+        QString what = err ? QString::fromUtf8(err->message) : QString("Recording failed");
+        qWarning() << "[StreamRecorder] ERROR:" << what << (dbg ? dbg : "");
+        if (err) g_error_free(err);
+        if (dbg) g_free(dbg);
+        QString failed;
+        Detached detached;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            failed = self->path;
+            detached = self->detach();
+        }
+        self->finish(std::move(detached), failed, Outcome::Failed, what);
+        return FALSE;
+    }
+    default:
+        break;
+    }
+    return TRUE;
+}
+
+void StreamRecorder::onNeedData(GstAppSrc * /*src*/, guint /*length*/, gpointer data) {
+    static_cast<StreamRecorder*>(data)->backlogFull = false;
+}
+
+void StreamRecorder::onEnoughData(GstAppSrc * /*src*/, gpointer data) {
+    static_cast<StreamRecorder*>(data)->backlogFull = true;
+}
+
+GstFlowReturn StreamRecorder::onFragmentData(GstAppSink *sink, gpointer data) {
+    auto *writer = static_cast<FragmentWriter*>(data);
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_EOS;
+
+    // Blocks while the disk is behind, the appsrc backlog takes it from there
+    GstFlowReturn ret = writer->failed() ? GST_FLOW_ERROR : GST_FLOW_OK;
+    if (GstBuffer *buffer = gst_sample_get_buffer(sample); buffer && ret == GST_FLOW_OK) {
+        writer->write(buffer);
+    }
+    gst_sample_unref(sample);
+    return ret;
+}
+
+StreamRecorder::Detached StreamRecorder::detach() {
+    Detached detached;
+    if (pipeline) {
+        if (auto bus = gst_element_get_bus(pipeline)) {
+            gst_bus_remove_watch(bus);
+            gst_object_unref(bus);
+        }
+        // The appsrc may still call back while it stops, by then into a newer recording
+        GstAppSrcCallbacks none = {};
+        gst_app_src_set_callbacks(GST_APP_SRC(appsrc), &none, nullptr, nullptr);
+    }
+    detached.pipeline = pipeline;
+    detached.writer = std::move(writer);
+    pipeline = nullptr;
+    appsrc = nullptr;
+    state = State::Idle;
+    return detached;
+}
+
+QString StreamRecorder::shutdown(Detached &detached) {
+    if (detached.pipeline) {
+        gst_element_set_state(detached.pipeline, GST_STATE_NULL);
+        gst_object_unref(detached.pipeline);
+        detached.pipeline = nullptr;
+    }
+    // The muxer thread is gone, what it queued still goes to disk
+    if (detached.writer && !detached.writer->close()) {
+        return detached.writer->errorString();
+    }
+    return QString();
+}
+
+void StreamRecorder::finish(Detached detached, const QString &file, Outcome outcome, const QString &message) {
+    QPointer<StreamRecorder> self(this);
+    QtConcurrent::run([self, detached, file, outcome, message]() mutable {
+        QString writeError = shutdown(detached);
+        if (outcome == Outcome::Abandoned) {
+            QFile::remove(file);
+            QFile::remove(FragmentWriter::indexPath(file));
+        }
+
+        QMetaObject::invokeMethod(self, [self, file, outcome, message, writeError]() {
+            if (!self) return;
+            if (outcome == Outcome::Abandoned) {
+                emit self->error(QString("Recording stopped before the first keyframe, nothing was written"));
+            } else if (!writeError.isEmpty()) {
+                // A failed disk write also surfaces as a flow error, its own message says more
+                emit self->error(writeError);
+            } else if (outcome == Outcome::Failed) {
+                emit self->error(message);
+            } else {
+                qDebug() << "[StreamRecorder] finalised" << file;
+                emit self->stopped(file);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
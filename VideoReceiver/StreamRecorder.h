@@ -0,0 +1,122 @@
+#ifndef STREAMRECORDER_H
+#define STREAMRECORDER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+#include "FragmentWriter.h"
+
+// Writes the live stream's parsed H.264/H.265 access units to a file without decoding them.
+// VideoReceiver feeds it from its parser, so recording needs no second RTSP session. Each
+// recording runs in its own small pipeline (appsrc → parser → muxer → filesink): starting and
+// finalising a file never touches the live pipeline.
+class StreamRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    explicit StreamRecorder(QObject *parent = nullptr);
+    ~StreamRecorder();
+
+    // Opens the file and writes the pre-roll into it, so the file starts before the call (at the
+    // pre-roll's first keyframe, or else the next one). ".mkv" is written as Matroska, anything
+    // else as MP4. Fails if no access unit has been seen yet or a recording is running.
+    bool start(const QString &path);
+    // Ends the file after the last access unit received, stopped() once it is finalised
+    void stop();
+    bool isRecording() const;
+
+    // Budget of the pre-roll ring of compressed access units, 0 disables it. It keeps whole GOPs
+    // and no more bytes than this, how many seconds that is depends on the bitrate.
+    void setPrerollBytes(size_t bytes);
+    size_t prerollBytes() const;
+    // Stream time the pre-roll covers now, what a start() would put in front of the call
+    GstClockTime prerollDuration() const;
+    // When the live stream ends, so a later recording does not start with the old one
+    void discardPreroll();
+
+    // Segmented mode: MP4 recordings are written as fragments of about this many milliseconds,
+    // through a FragmentWriter and with an index next to the file. A crash costs at most the
+    // fragment being written and stopping only finishes the last one. 0 writes plain MP4 with
+    // its index at the end. Matroska files are not affected. Takes effect on the next start().
+    void setFragmentDuration(guint ms);
+    guint fragmentDuration() const;
+
+    // Streaming thread: one access unit of the live stream, with the caps of the pad it came from
+    void pushAccessUnit(GstBuffer *buffer, GstCaps *caps);
+
+signals:
+    void started(const QString &path);      // first keyframe is in the file
+    void stopped(const QString &path);      // file finalised
+    void error(const QString &message);
+
+private:
+    enum class State {
+        Idle,
+        WaitingForKeyframe,
+        Recording,
+        Finalizing
+    };
+
+    static gboolean busCall(GstBus *bus, GstMessage *msg, gpointer data);
+    static void onNeedData(GstAppSrc *src, guint length, gpointer data);
+    static void onEnoughData(GstAppSrc *src, gpointer data);
+    static GstFlowReturn onFragmentData(GstAppSink *sink, gpointer data);
+
+    // A recording's pipeline and writer once it ended, taken out so that stopping them (and
+    // flushing the writer) never holds the mutex the live stream's thread takes
+    struct Detached {
+        GstElement *pipeline = nullptr;
+        std::shared_ptr<FragmentWriter> writer;
+    };
+    enum class Outcome {
+        Finalised,
+        Failed,
+        Abandoned                         // stopped before the first keyframe, the file goes
+    };
+    bool startLocked(const QString &newPath, bool &startedNow);
+    // Writes one access unit to the file, true if it is the file's first. Mutex held, as for the
+    // rest of the private functions
+    bool writeUnit(GstBuffer *buffer);
+    void addToPreroll(GstBuffer *buffer);
+    void trimPreroll();
+    void clearPreroll();
+    // Takes the pipeline and writer out and leaves the recorder Idle
+    Detached detach();
+    // Any thread, no mutex: sets the pipeline to NULL and closes the writer, blocking until the
+    // file is on disk. The writer's error if it failed
+    static QString shutdown(Detached &detached);
+    // shutdown() on a worker thread, then stopped() or error() on the recorder's thread
+    void finish(Detached detached, const QString &file, Outcome outcome, const QString &message = QString());
+
+    mutable std::mutex mutex;
+    State state = State::Idle;
+    GstElement *pipeline = nullptr;
+    GstElement *appsrc = nullptr;
+    GstCaps *streamCaps = nullptr;           // caps of the last access unit
+    QString path;
+    bool haveOffset = false;
+    GstClockTimeDiff offset = 0;                   // file time = live time + offset
+    GstClockTime lastTime = GST_CLOCK_TIME_NONE;   // latest file time written
+    std::atomic<bool> backlogFull{false};
+    quint64 droppedUnits = 0;
+
+    std::deque<GstBuffer*> preroll;       // refs, oldest first, starts with a keyframe
+    size_t prerollSize = 0;               // bytes in preroll
+    size_t prerollLimit = DEFAULT_PREROLL_BYTES;
+
+    guint fragmentMs = 0;
+    std::shared_ptr<FragmentWriter> writer;   // while a segmented recording runs
+
+    static constexpr guint64 MAX_BACKLOG_BYTES = 64 * 1024 * 1024;
+    // About 10 s of a 12 Mbit/s stream
+    static constexpr size_t DEFAULT_PREROLL_BYTES = 16 * 1024 * 1024;
+    static constexpr int FINALIZE_TIMEOUT_MS = 3000;
+};
+
+#endif // STREAMRECORDER_H
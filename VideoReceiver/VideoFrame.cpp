@@ -0,0 +1,168 @@
+// VideoFrame.cpp
+#include "VideoFrame.h"
+#include <QDebug>
+
+struct VideoFrame::Data {
+    Data(GstSample *sample, const GstVideoInfo &info, std::shared_ptr<VideoFramePool::State> pool)
+        : sample(sample), info(info), pool(std::move(pool)) {}
+
+    ~Data() {
+        gst_sample_unref(sample);
+        pool->inUse--;
+    }
+
+    GstSample *sample;
+    GstVideoInfo info;
+    std::shared_ptr<VideoFramePool::State> pool;
+};
+
+namespace {
+
+// Keeps the frame mapped for as long as a QImage points into it
+struct ImageView {
+    std::shared_ptr<const void> frame;
+    GstVideoFrame mapped;
+};
+
+void releaseImageView(void *info) {
+    auto *view = static_cast<ImageView*>(info);
+    gst_video_frame_unmap(&view->mapped);
+    delete view;
+}
+
+QImage::Format imageFormat(GstVideoFormat format) {
+    switch (format) {
+    case GST_VIDEO_FORMAT_RGBx:  return QImage::Format_RGBX8888;
+    case GST_VIDEO_FORMAT_RGBA:  return QImage::Format_RGBA8888;
+    case GST_VIDEO_FORMAT_BGRx:  return QImage::Format_RGB32;      // 0xffRRGGBB little endian
+    case GST_VIDEO_FORMAT_BGRA:  return QImage::Format_ARGB32;
+    case GST_VIDEO_FORMAT_RGB:   return QImage::Format_RGB888;
+    case GST_VIDEO_FORMAT_GRAY8: return QImage::Format_Grayscale8;
+    default:                     return QImage::Format_Invalid;
+    }
+}
+
+// Anything else to RGB32 through GStreamer's converter, which takes the YUV matrix and range from
+// the frame's colorimetry (BT.709 for HD streams, BT.601 for SD)
+QImage convertToRgb(const GstVideoFrame &frame) {
+    const GstVideoInfo &inInfo = frame.info;
+    int width = GST_VIDEO_INFO_WIDTH(&inInfo);
+    int height = GST_VIDEO_INFO_HEIGHT(&inInfo);
+    QImage image(width, height, QImage::Format_RGB32);
+    if (image.isNull()) return {};
+
+    GstVideoInfo outInfo;
+    gst_video_info_set_format(&outInfo, GST_VIDEO_FORMAT_BGRx, guint(width), guint(height));
+    outInfo.stride[0] = int(image.bytesPerLine());
+    outInfo.size = gsize(image.sizeInBytes());
+
+    // The converter writes straight into the image
+    GstBuffer *outBuffer = gst_buffer_new_wrapped_full(GstMemoryFlags(0), image.bits(), outInfo.size,
+                                                       0, outInfo.size, nullptr, nullptr);
+    GstVideoFrame out;
+    if (!gst_video_frame_map(&out, &outInfo, outBuffer, GST_MAP_WRITE)) {
+        gst_buffer_unref(outBuffer);
+        return {};
+    }
+
+    GstVideoConverter *converter = gst_video_converter_new(const_cast<GstVideoInfo*>(&inInfo), &outInfo, nullptr);
+    bool converted = converter != nullptr;
+    if (converted) {
+        gst_video_converter_frame(converter, &frame, &out);
+        gst_video_converter_free(converter);
+    }
+    gst_video_frame_unmap(&out);
+    gst_buffer_unref(outBuffer);
+    return converted ? image : QImage();
+}
+
+} // namespace
+
+int VideoFrame::width() const {
+    return d ? GST_VIDEO_INFO_WIDTH(&d->info) : 0;
+}
+
+int VideoFrame::height() const {
+    return d ? GST_VIDEO_INFO_HEIGHT(&d->info) : 0;
+}
+
+GstVideoFormat VideoFrame::format() const {
+    return d ? GST_VIDEO_INFO_FORMAT(&d->info) : GST_VIDEO_FORMAT_UNKNOWN;
+}
+
+GstClockTime VideoFrame::pts() const {
+    return d ? GST_BUFFER_PTS(buffer()) : GST_CLOCK_TIME_NONE;
+}
+
+const GstVideoInfo* VideoFrame::info() const {
+    return d ? &d->info : nullptr;
+}
+
+GstBuffer* VideoFrame::buffer() const {
+    return d ? gst_sample_get_buffer(d->sample) : nullptr;
+}
+
+QImage VideoFrame::toImage() const {
+    if (!d) return {};
+
+    auto *view = new ImageView{d, {}};
+    if (!gst_video_frame_map(&view->mapped, const_cast<GstVideoInfo*>(&d->info), buffer(), GST_MAP_READ)) {
+        qWarning() << "[VideoFrame] toImage: failed to map buffer";
+        delete view;
+        return {};
+    }
+
+    QImage::Format qtFormat = imageFormat(format());
+    if (qtFormat != QImage::Format_Invalid) {
+        // Read-only view: Qt copies on the first non-const access, not before
+        return QImage(static_cast<const uchar*>(GST_VIDEO_FRAME_PLANE_DATA(&view->mapped, 0)),
+                      width(), height(), GST_VIDEO_FRAME_PLANE_STRIDE(&view->mapped, 0),
+                      qtFormat, releaseImageView, view);
+    }
+
+    QImage image = convertToRgb(view->mapped);
+    if (image.isNull()) {
+        qWarning() << "[VideoFrame] toImage: no conversion from" << gst_video_format_to_string(format());
+    }
+    releaseImageView(view);
+    return image;
+}
+
+VideoFramePool::VideoFramePool(int capacity)
+    : state(std::make_shared<State>(capacity))
+{
+}
+
+VideoFrame VideoFramePool::wrap(GstSample *sample) {
+    if (!sample) return {};
+
+    GstVideoInfo info;
+    GstCaps *caps = gst_sample_get_caps(sample);
+    if (!caps || !gst_sample_get_buffer(sample) || !gst_video_info_from_caps(&info, caps)) {
+        gst_sample_unref(sample);
+        return {};
+    }
+
+    if (state->inUse.fetch_add(1) >= state->capacity) {
+        state->inUse--;
+        state->dropped++;
+        gst_sample_unref(sample);
+        return {};
+    }
+
+    VideoFrame frame;
+    frame.d = std::make_shared<const VideoFrame::Data>(sample, info, state);
+    return frame;
+}
+
+int VideoFramePool::capacity() const {
+    return state->capacity;
+}
+
+int VideoFramePool::inUse() const {
+    return state->inUse;
+}
+
+quint64 VideoFramePool::dropped() const {
+    return state->dropped;
+}
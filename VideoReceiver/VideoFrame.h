@@ -0,0 +1,68 @@
+#ifndef VIDEOFRAME_H
+#define VIDEOFRAME_H
+
+#include <QImage>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+class VideoFramePool;
+
+// A decoded frame, backed by the GstBuffer the pipeline produced. Copies share the buffer, so
+// passing frames around (also through queued signals) never copies pixels. The frame holds one
+// slot of the VideoFramePool it came from until the last copy is gone.
+class VideoFrame {
+public:
+    VideoFrame() = default;
+
+    bool isValid() const { return d != nullptr; }
+    int width() const;
+    int height() const;
+    GstVideoFormat format() const;
+    GstClockTime pts() const;
+    const GstVideoInfo* info() const;
+    // Borrowed, valid as long as this frame
+    GstBuffer* buffer() const;
+
+    // RGB and grey frames are wrapped without a copy, the image keeps the buffer mapped until it
+    // and its copies are destroyed. Other formats are converted to RGB32 according to the
+    // frame's colorimetry, a null image if GStreamer cannot convert them.
+    QImage toImage() const;
+
+private:
+    struct Data;
+    friend class VideoFramePool;
+
+    std::shared_ptr<const Data> d;
+};
+
+Q_DECLARE_METATYPE(VideoFrame)
+
+// Bounds how many frames consumers can hold at once. When every slot is taken new frames are
+// dropped instead of pinning more buffers, so a slow consumer costs frames, not memory.
+class VideoFramePool {
+public:
+    explicit VideoFramePool(int capacity);
+
+    // Takes ownership of the sample, an invalid frame if the pool is full or it is not video
+    VideoFrame wrap(GstSample *sample);
+
+    int capacity() const;
+    int inUse() const;
+    quint64 dropped() const;
+
+private:
+    struct State {
+        explicit State(int capacity) : capacity(capacity) {}
+        const int capacity;
+        std::atomic<int> inUse{0};
+        std::atomic<quint64> dropped{0};
+    };
+
+    std::shared_ptr<State> state;
+    friend struct VideoFrame::Data;
+};
+
+#endif // VIDEOFRAME_H
@@ -198,8 +198,8 @@ gboolean VideoReceiver::bus_call(GstBus* /*bus*/, GstMessage* msg, gpointer data
                 if (nowPlaying) {
                     // Try to get caps from the sink pad when stream starts
                     if (!self->analysisPrinted) {
-                        GstElement *sink = nullptr;
-                        g_object_get(self->pipeline, "video-sink", &sink, nullptr);
+                        // Both pipeline modes render into our own videosink
+                        GstElement *sink = self->videosink;
                         if (sink) {
                             GstPad *sinkPad = gst_element_get_static_pad(sink, "sink");
                             if (sinkPad) {
@@ -351,57 +351,16 @@ VideoReceiver::VideoReceiver(QObject *parent)
     videosink(nullptr)
 {
     gst_init(nullptr, nullptr);
+    qRegisterMetaType<VideoFrame>("VideoFrame");
+
+    recorder = new StreamRecorder(this);
+    connect(recorder, &StreamRecorder::started, this, &VideoReceiver::recordingStarted);
+    connect(recorder, &StreamRecorder::stopped, this, &VideoReceiver::recordingStopped);
+    connect(recorder, &StreamRecorder::error, this, &VideoReceiver::recordingError);
 
     QString uri = getRtspUriFromConfig();
     qDebug() << "[VideoReceiver] Using RTSP URI:" << uri;
 
-    // 1) Create playbin
-    pipeline  = gst_element_factory_make("playbin", "player");
-    if (!pipeline) {
-        qCritical() << "[VideoReceiver] Failed to create playbin";
-        return;
-    }
-
-    GstElement* convert = gst_element_factory_make("videoconvert",  "convert");
-
-    // 2) Create the sink and tell playbin to use it
-    // Try different video sinks in order of preference
-    const char* sinkNames[] = {"xvimagesink", "glimagesink", "vaapisink", "autovideosink", nullptr};
-    const char** sinkName = sinkNames;
-    
-    while (*sinkName) {
-        videosink = gst_element_factory_make(*sinkName, "videosink");
-        if (videosink) {
-            qDebug() << "[VideoReceiver] Created" << *sinkName << "as videosink";
-            break;
-        }
-        sinkName++;
-    }
-    
-    if (!videosink) {
-        qCritical() << "[VideoReceiver] Failed to create any videosink";
-        gst_object_unref(pipeline);
-        pipeline = nullptr;
-        return;
-    }
-    
-    // Check if the sink supports video overlay
-    if (GST_IS_VIDEO_OVERLAY(videosink)) {
-        qDebug() << "[VideoReceiver]" << *sinkName << "supports video overlay";
-    } else {
-        qDebug() << "[VideoReceiver]" << *sinkName << "does NOT support video overlay";
-    }
-    
-    // disable sync so frames show immediately
-    g_object_set(videosink, "sync", FALSE, nullptr);
-
-    // 3) Configure playbin: set our RTSP URI, low latency, and video sink
-    g_object_set(pipeline,
-                 "uri",         uri.toUtf8().constData(),
-                 "latency",     100,            // 100 ms jitter buffer
-                 "video-sink",  videosink,
-                 nullptr);
-
     //Using PC camera for testing purposes:
     // temporarily use the laptop camera:
     // const char *webcamUri = "v4l2:///dev/video0";
@@ -410,14 +369,9 @@ VideoReceiver::VideoReceiver(QObject *parent)
     //              "video-sink", videosink,
     //              nullptr);
 
-    // 4) Watch the bus for EOS / errors / state changes
-    GstBus *bus = gst_element_get_bus(pipeline);
-    gst_bus_add_watch(bus, VideoReceiver::bus_call, this);
-    gst_object_unref(bus);
-
-    // 5) Fire it up
-    gst_element_set_state(pipeline, GST_STATE_PLAYING);
-    qDebug() << "[VideoReceiver] playbin → PLAYING";
+    // Build the pipeline for the configured mode, watch the bus and fire it up
+    loadPipelineSettings();
+    createPipeline(uri);
 }
 
 
@@ -655,6 +609,7 @@ VideoReceiver::~VideoReceiver() {
     // Don't unref individual elements - they're owned by the pipeline
     videosink = nullptr;
     appsink = nullptr;
+    sinkBin = nullptr;
 }
 
 
@@ -696,6 +651,10 @@ void VideoReceiver::start() {
 
 void VideoReceiver::stop()
 {
+    // The recording has its own pipeline, it finishes the file by itself
+    recorder->stop();
+    recorder->discardPreroll();
+
     if (!pipeline) return;
 
     gst_element_set_state(pipeline, GST_STATE_NULL);
@@ -713,6 +672,14 @@ void VideoReceiver::stop()
     // Make sure to drop sinks too (they're owned by pipeline anyway)
     videosink = nullptr;
     appsink   = nullptr;
+    sinkBin   = nullptr;
+    rtspSrc   = nullptr;
+    depay     = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        lastFrame = VideoFrame();
+    }
 
     qDebug() << "[VideoReceiver] stop(): pipeline destroyed and references cleared";
 }
@@ -850,47 +817,14 @@ bool VideoReceiver::isPlaying() const {
 
 QImage VideoReceiver::grabFrame()
 {
-    if (!appsink) return {};
-
-    // Pull the most recent sample (non-blocking)
-    GstSample *sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), 0);
-    if (!sample) return {};
-
-    GstBuffer *buf = gst_sample_get_buffer(sample);
-    GstMapInfo info;
-    if (!gst_buffer_map(buf, &info, GST_MAP_READ)) {
-        gst_sample_unref(sample);
-        return {};
-    }
-
-    GstCaps *caps = gst_sample_get_caps(sample);
-    auto *s      = gst_caps_get_structure(caps, 0);
-    int width, height;
-    gst_structure_get_int(s, "width",  &width);
-    gst_structure_get_int(s, "height", &height);
-
-    // appsink caps forced us to RGB
-    QImage img((uchar*)info.data, width, height, QImage::Format_RGB888);
-
-    // copy before we unmap/unref
-    QImage copy = img.copy();
-
-    gst_buffer_unmap(buf, &info);
-    gst_sample_unref(sample);
-    return copy;
-
-    if (sample) {
-        // Always unref sample when done
-        QImage result;
-        GstBuffer *buf = gst_sample_get_buffer(sample);
-        if (buf && gst_buffer_map(buf, &info, GST_MAP_READ)) {
-            // ... image creation code ...
-            gst_buffer_unmap(buf, &info);
-        }
-        gst_sample_unref(sample);
-        return result;
-    }
-    return {};
+    // A view on the frame tap's buffer, converted only if the stream is YUV
+    return latestFrame().toImage();
+}
+
+VideoFrame VideoReceiver::latestFrame() const
+{
+    std::lock_guard<std::mutex> lock(frameMutex);
+    return lastFrame;
 }
 
 
@@ -903,6 +837,10 @@ QImage VideoReceiver::grabFrame()
 void VideoReceiver::setRtspUri(const QString& uri) {
     qDebug() << "[VideoReceiver] setRtspUri called with" << uri;
 
+    // A recording and its pre-roll belong to the old source
+    recorder->stop();
+    recorder->discardPreroll();
+
     // If pipeline exists, stop and clean up
     if (pipeline) {
         gst_element_set_state(pipeline, GST_STATE_NULL);
@@ -916,6 +854,10 @@ void VideoReceiver::setRtspUri(const QString& uri) {
         pipeline = nullptr;
         // IMPORTANT: Also clear videosink since it was owned by the pipeline
         videosink = nullptr;
+        appsink = nullptr;
+        sinkBin = nullptr;
+        rtspSrc = nullptr;
+        depay = nullptr;
         qDebug() << "[VideoReceiver] setRtspUri: old pipeline destroyed";
     }
 
@@ -928,38 +870,137 @@ void VideoReceiver::setRtspUri(const QString& uri) {
 
 
 
+
+
+
+GstElement* VideoReceiver::makeVideoSink() {
+    // Try different video sinks in order of preference
+    const char* sinkNames[] = {"xvimagesink", "glimagesink", "vaapisink", "autovideosink", nullptr};
+    const char** sinkName = sinkNames;
+    GstElement *sink = nullptr;
+
+    while (*sinkName) {
+        sink = gst_element_factory_make(*sinkName, "videosink");
+        if (sink) {
+            qDebug() << "[VideoReceiver] createPipeline: created" << *sinkName;
+            break;
+        }
+        sinkName++;
+    }
+
+    if (!sink) {
+        qCritical() << "[VideoReceiver] createPipeline: failed to create any videosink";
+        return nullptr;
+    }
+
+    // Check if the sink supports video overlay
+    if (GST_IS_VIDEO_OVERLAY(sink)) {
+        qDebug() << "[VideoReceiver] createPipeline:" << *sinkName << "supports video overlay";
+    } else {
+        qDebug() << "[VideoReceiver] createPipeline:" << *sinkName << "does NOT support video overlay";
+    }
+
+    // disable sync so frames show immediately
+    g_object_set(sink, "sync", FALSE, nullptr);
+    return sink;
+}
+
+GstElement* VideoReceiver::makeSinkBin() {
+    GstElement *bin     = gst_bin_new("sinkbin");
+    GstElement *tee     = gst_element_factory_make("tee",          "displaytee");
+    GstElement *queue   = gst_element_factory_make("queue",        "tapqueue");
+    GstElement *convert = gst_element_factory_make("videoconvert", "tapconvert");
+    GstElement *tap     = gst_element_factory_make("appsink",      "frametap");
+
+    if (!bin || !tee || !queue || !convert || !tap) {
+        qWarning() << "[VideoReceiver] makeSinkBin: failed to create the frame tap, rendering only";
+        for (GstElement *element : {bin, tee, queue, convert, tap}) {
+            if (element) gst_object_unref(element);
+        }
+        return nullptr;
+    }
+
+    // The tap never holds the display up: one frame in flight, older ones are dropped
+    g_object_set(queue,
+                 "leaky", 2,
+                 "max-size-buffers", 1,
+                 "max-size-bytes", 0,
+                 "max-size-time", (guint64)0,
+                 nullptr);
+
+    // Formats VideoFrame can view or convert. videoconvert passes these through untouched, so
+    // usually the tap gets the decoder's own buffers
+    GstCaps *caps = gst_caps_from_string(
+        "video/x-raw, format=(string){ BGRx, RGBx, BGRA, RGBA, RGB, GRAY8, I420, NV12 }");
+    g_object_set(tap,
+                 "caps", caps,
+                 "sync", FALSE,
+                 "max-buffers", 1,
+                 "drop", TRUE,
+                 "enable-last-sample", FALSE,
+                 nullptr);
+    gst_caps_unref(caps);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = VideoReceiver::onNewSample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(tap), &callbacks, this, nullptr);
+
+    gst_bin_add_many(GST_BIN(bin), tee, queue, convert, tap, nullptr);
+    if (!gst_element_link_many(queue, convert, tap, nullptr)) {
+        qWarning() << "[VideoReceiver] makeSinkBin: failed to link the frame tap, rendering only";
+        gst_object_unref(bin);
+        return nullptr;
+    }
+
+    // The display branch has no queue of its own, the tee hands it each frame first
+    gst_bin_add(GST_BIN(bin), videosink);
+    if (!gst_element_link(tee, videosink) || !gst_element_link(tee, queue)) {
+        qCritical() << "[VideoReceiver] makeSinkBin: failed to link the sink bin";
+        gst_object_unref(bin);      // takes the videosink with it
+        videosink = nullptr;
+        return nullptr;
+    }
+
+    GstPad *teeSink = gst_element_get_static_pad(tee, "sink");
+    gst_element_add_pad(bin, gst_ghost_pad_new("sink", teeSink));
+    gst_object_unref(teeSink);
+
+    appsink = tap;
+    return bin;
+}
+
+GstElement* VideoReceiver::displaySink() const {
+    return sinkBin ? sinkBin : videosink;
+}
+
+GstFlowReturn VideoReceiver::onNewSample(GstAppSink *sink, gpointer data) {
+    auto *self = static_cast<VideoReceiver*>(data);
+
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_OK;   // flushing
+
+    // Two slots go to the latest frame and the one replacing it, the rest to consumers
+    VideoFrame frame = self->framePool.wrap(sample);
+    if (!frame.isValid()) return GST_FLOW_OK;
+
+    {
+        std::lock_guard<std::mutex> lock(self->frameMutex);
+        self->lastFrame = frame;
+    }
+    emit self->frameReady(frame);
+    return GST_FLOW_OK;
+}
+
 void VideoReceiver::createPipeline(const QString& uri) {
-    qDebug() << "[VideoReceiver] createPipeline: creating playbin for" << uri;
+    qDebug() << "[VideoReceiver] createPipeline: creating"
+             << (mode == PipelineMode::LowLatency ? "low-latency pipeline" : "playbin") << "for" << uri;
 
     // make sure we have a persistent videosink to attach the Qt window to
     if (!videosink) {
-        // Try different video sinks in order of preference
-        const char* sinkNames[] = {"xvimagesink", "glimagesink", "vaapisink", "autovideosink", nullptr};
-        const char** sinkName = sinkNames;
-        
-        while (*sinkName) {
-            videosink = gst_element_factory_make(*sinkName, "videosink");
-            if (videosink) {
-                qDebug() << "[VideoReceiver] createPipeline: created" << *sinkName;
-                break;
-            }
-            sinkName++;
-        }
-        
+        videosink = makeVideoSink();
         if (!videosink) {
-            qCritical() << "[VideoReceiver] createPipeline: failed to create any videosink";
             return;
         }
-        
-        // Check if the sink supports video overlay
-        if (GST_IS_VIDEO_OVERLAY(videosink)) {
-            qDebug() << "[VideoReceiver] createPipeline:" << *sinkName << "supports video overlay";
-        } else {
-            qDebug() << "[VideoReceiver] createPipeline:" << *sinkName << "does NOT support video overlay";
-        }
-        
-        // disable sync so frames show immediately
-        g_object_set(videosink, "sync", FALSE, nullptr);
     } else {
         // Verify the videosink is still valid
         if (!GST_IS_ELEMENT(videosink)) {
@@ -971,20 +1012,33 @@ void VideoReceiver::createPipeline(const QString& uri) {
         }
     }
 
-    // Create the playbin pipeline
-    pipeline = gst_element_factory_make("playbin", "playbin");
-    if (!pipeline) {
-        qCritical() << "[VideoReceiver] createPipeline: failed to create playbin!";
-        return;
+    // Without tee or appsink the stream still plays, only the frame tap is missing
+    if (!sinkBin) {
+        sinkBin = makeSinkBin();
+        if (!displaySink()) {
+            return;
+        }
     }
 
-    // Ensure the sink is set on playbin before starting playback so playbin
-    // does not create a default sink (which would open a new top-level window).
-    g_object_set(pipeline,
-                 "uri", uri.toUtf8().constData(),
-                 "latency", 100,
-                 "video-sink", videosink,
-                 nullptr);
+    if (mode != PipelineMode::LowLatency || !createLowLatencyPipeline(uri)) {
+        // Create the playbin pipeline
+        pipeline = gst_element_factory_make("playbin", "playbin");
+        if (!pipeline) {
+            qCritical() << "[VideoReceiver] createPipeline: failed to create playbin!";
+            return;
+        }
+
+        // Ensure the sink is set on playbin before starting playback so playbin
+        // does not create a default sink (which would open a new top-level window).
+        g_object_set(pipeline,
+                     "uri", uri.toUtf8().constData(),
+                     "latency", 100,
+                     "video-sink", displaySink(),
+                     nullptr);
+
+        // Recording taps the parser decodebin plugs in
+        g_signal_connect(pipeline, "deep-element-added", G_CALLBACK(VideoReceiver::onDeepElementAdded), this);
+    }
 
     // If we already have a saved window handle, apply it to the videosink overlay.
     if (savedWindowId != 0 && GST_IS_VIDEO_OVERLAY(videosink)) {
@@ -995,6 +1049,8 @@ void VideoReceiver::createPipeline(const QString& uri) {
         qDebug() << "[VideoReceiver] createPipeline: videosink does not support video overlay, cannot set window handle";
     }
 
+    attachLatencyProbe();
+
     // Attach a bus watch
     GstBus *bus = gst_element_get_bus(pipeline);
     gst_bus_add_watch(bus, VideoReceiver::bus_call, this);
@@ -1004,3 +1060,377 @@ void VideoReceiver::createPipeline(const QString& uri) {
     GstStateChangeReturn ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
     qDebug() << "[VideoReceiver] createPipeline: PLAYING for" << uri << " (ret =" << ret << ")";
 }
+
+// --- low-latency pipeline ----------------------------------------------------
+//
+// rtspsrc ~> depay → parse → decoder → queue (leaky) → videoconvert → sink bin
+//                      └─ access units to the recorder
+//
+// rtspsrc's jitter buffer is the only deliberate delay, packets that would arrive after it has
+// given up on them are dropped instead of stalling the picture. The decode chain is built once
+// rtspsrc tells us the codec. The leaky queue sits on decoded frames, so when display falls
+// behind the oldest picture goes and the decoder never loses a reference frame.
+
+namespace {
+// GstRTSPLowerTrans flags, without pulling in gstreamer-rtsp for them
+constexpr guint RTSP_LOWER_TRANS_UDP       = 0x1;
+constexpr guint RTSP_LOWER_TRANS_UDP_MCAST = 0x2;
+constexpr guint RTSP_LOWER_TRANS_TCP       = 0x4;
+// avdec thread-type, frame threading holds back one frame per decoder thread
+constexpr gint AVDEC_THREAD_TYPE_SLICE = 2;
+// Seconds from the NTP epoch (1900) to the Unix epoch
+constexpr guint64 NTP_UNIX_OFFSET_S = 2208988800ULL;
+
+bool hasProperty(GstElement *element, const char *name) {
+    return g_object_class_find_property(G_OBJECT_GET_CLASS(element), name) != nullptr;
+}
+
+QString configFilePath() {
+    QDir configDirectory(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation));
+    return configDirectory.filePath("Haxa5Camera/Hexa5CameraConfig.json");
+}
+} // namespace
+
+void VideoReceiver::setPipelineMode(PipelineMode newMode) {
+    mode = newMode;
+}
+
+VideoReceiver::PipelineMode VideoReceiver::pipelineMode() const {
+    return mode;
+}
+
+void VideoReceiver::setLowLatencySettings(const LowLatencySettings &settings) {
+    lowLatency = settings;
+}
+
+VideoReceiver::LowLatencySettings VideoReceiver::lowLatencySettings() const {
+    return lowLatency;
+}
+
+// Optional "videoPipeline" object of the camera config, e.g.
+//   "videoPipeline": { "mode": "lowLatency", "jitterBufferMs": 50, "dropOnLatency": true,
+//                      "queueBuffers": 2, "decoderThreads": 0, "tcp": false }
+// Missing keys keep their current values.
+void VideoReceiver::loadPipelineSettings() {
+    QFile file(configFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject() || !doc.object().contains("videoPipeline")) {
+        return;
+    }
+
+    QJsonObject obj = doc.object().value("videoPipeline").toObject();
+    QString modeName = obj.value("mode").toString().toLower();
+    if (modeName == "lowlatency") {
+        mode = PipelineMode::LowLatency;
+    } else if (modeName == "playbin") {
+        mode = PipelineMode::Playbin;
+    }
+    lowLatency.jitterBufferMs = guint(qMax(0, obj.value("jitterBufferMs").toInt(int(lowLatency.jitterBufferMs))));
+    lowLatency.dropOnLatency = obj.value("dropOnLatency").toBool(lowLatency.dropOnLatency);
+    lowLatency.queueBuffers = qMax(1, obj.value("queueBuffers").toInt(lowLatency.queueBuffers));
+    lowLatency.decoderThreads = qMax(0, obj.value("decoderThreads").toInt(lowLatency.decoderThreads));
+    lowLatency.tcp = obj.value("tcp").toBool(lowLatency.tcp);
+    if (obj.contains("recordPrerollBytes")) {
+        recorder->setPrerollBytes(size_t(qMax(0.0, obj.value("recordPrerollBytes").toDouble())));
+    }
+    if (obj.contains("recordFragmentMs")) {
+        recorder->setFragmentDuration(guint(qMax(0, obj.value("recordFragmentMs").toInt())));
+    }
+
+    qDebug() << "[VideoReceiver] pipeline mode" << (mode == PipelineMode::LowLatency ? "lowLatency" : "playbin")
+             << "jitter buffer" << lowLatency.jitterBufferMs << "ms, queue" << lowLatency.queueBuffers
+             << "buffers, decoder threads" << lowLatency.decoderThreads
+             << ", record pre-roll" << recorder->prerollBytes() << "bytes, fragments"
+             << recorder->fragmentDuration() << "ms";
+}
+
+bool VideoReceiver::createLowLatencyPipeline(const QString& uri) {
+    rtspSrc = gst_element_factory_make("rtspsrc", "src");
+    if (!rtspSrc) {
+        qWarning() << "[VideoReceiver] createLowLatencyPipeline: no rtspsrc, falling back to playbin";
+        return false;
+    }
+
+    g_object_set(rtspSrc,
+                 "location", uri.toUtf8().constData(),
+                 "latency", lowLatency.jitterBufferMs,
+                 "drop-on-latency", lowLatency.dropOnLatency ? TRUE : FALSE,
+                 "protocols", lowLatency.tcp ? RTSP_LOWER_TRANS_TCP
+                                             : RTSP_LOWER_TRANS_UDP | RTSP_LOWER_TRANS_UDP_MCAST | RTSP_LOWER_TRANS_TCP,
+                 nullptr);
+    // Capture times from the camera's RTCP sender reports, for the glass-to-glass latency (1.22+)
+    if (hasProperty(rtspSrc, "add-reference-timestamp-meta")) {
+        g_object_set(rtspSrc, "add-reference-timestamp-meta", TRUE, nullptr);
+    }
+
+    pipeline = gst_pipeline_new("video-receiver");
+    gst_bin_add_many(GST_BIN(pipeline), rtspSrc, displaySink(), nullptr);
+    g_signal_connect(rtspSrc, "pad-added", G_CALLBACK(VideoReceiver::onPadAdded), this);
+    return true;
+}
+
+void VideoReceiver::onPadAdded(GstElement * /*src*/, GstPad *new_pad, gpointer user_data) {
+    auto *self = static_cast<VideoReceiver*>(user_data);
+
+    GstCaps *caps = gst_pad_get_current_caps(new_pad);
+    if (!caps) caps = gst_pad_query_caps(new_pad, nullptr);
+    GstStructure *str = gst_caps_get_structure(caps, 0);
+    const gchar *media = gst_structure_get_string(str, "media");
+    QString encoding = QString::fromUtf8(gst_structure_get_string(str, "encoding-name"));
+    gst_caps_unref(caps);
+
+    if (g_strcmp0(media, "video") != 0 || encoding.isEmpty()) {
+        qDebug() << "[VideoReceiver] onPadAdded: ignoring" << (media ? media : "unknown") << "stream";
+        return;
+    }
+
+    // rtspsrc adds its pads again after an error restart, the chain is kept
+    if (!self->depay && !self->buildDecodeChain(encoding.toUtf8().constData())) {
+        emit self->cameraError(QString("Unsupported video encoding %1").arg(encoding));
+        return;
+    }
+
+    GstPad *sinkPad = gst_element_get_static_pad(self->depay, "sink");
+    if (!gst_pad_is_linked(sinkPad) && gst_pad_link(new_pad, sinkPad) != GST_PAD_LINK_OK) {
+        qDebug() << "[VideoReceiver] Failed to link rtspsrc → depay for" << encoding;
+    }
+    gst_object_unref(sinkPad);
+}
+
+bool VideoReceiver::buildDecodeChain(const gchar *encoding) {
+    struct Codec {
+        const char *encoding;
+        const char *depay;
+        const char *parse;
+        const char *decoder;
+    };
+    static const Codec codecs[] = {
+        {"H264", "rtph264depay", "h264parse", "avdec_h264"},
+        {"H265", "rtph265depay", "h265parse", "avdec_h265"},
+    };
+
+    const Codec *codec = nullptr;
+    for (const Codec &candidate : codecs) {
+        if (g_ascii_strcasecmp(candidate.encoding, encoding) == 0) codec = &candidate;
+    }
+    if (!codec) {
+        qWarning() << "[VideoReceiver] buildDecodeChain: no decode chain for" << encoding;
+        return false;
+    }
+
+    GstElement *newDepay = gst_element_factory_make(codec->depay,      "depay");
+    GstElement *parser   = gst_element_factory_make(codec->parse,      "parser");
+    GstElement *decoder  = gst_element_factory_make(codec->decoder,    "decoder");
+    GstElement *queue    = gst_element_factory_make("queue",           "displayqueue");
+    GstElement *convert  = gst_element_factory_make("videoconvert",    "convert");
+
+    if (!newDepay || !parser || !decoder || !queue || !convert) {
+        qCritical() << "[VideoReceiver] buildDecodeChain: failed to create elements for" << encoding
+                    << "(is gst-libav installed?)";
+        for (GstElement *element : {newDepay, parser, decoder, queue, convert}) {
+            if (element) gst_object_unref(element);
+        }
+        return false;
+    }
+
+    // Slice threads decode one frame at a time, frame threads would queue one per thread
+    g_object_set(decoder, "max-threads", lowLatency.decoderThreads, nullptr);
+    if (hasProperty(decoder, "thread-type")) {
+        g_object_set(decoder, "thread-type", AVDEC_THREAD_TYPE_SLICE, nullptr);
+    }
+
+    // Leak downstream: drop the oldest decoded frame rather than block the decoder
+    g_object_set(queue,
+                 "leaky", 2,
+                 "max-size-buffers", lowLatency.queueBuffers,
+                 "max-size-bytes", 0,
+                 "max-size-time", (guint64)0,
+                 nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), newDepay, parser, decoder, queue, convert, nullptr);
+    if (!gst_element_link_many(newDepay, parser, decoder, queue, convert, displaySink(), nullptr)) {
+        qCritical() << "[VideoReceiver] buildDecodeChain: failed to link the decode chain";
+        gst_bin_remove_many(GST_BIN(pipeline), newDepay, parser, decoder, queue, convert, nullptr);
+        return false;
+    }
+
+    tapParser(parser);
+
+    // The pipeline is already running, bring the new elements up sink side first
+    for (GstElement *element : {convert, queue, decoder, parser, newDepay}) {
+        gst_element_sync_state_with_parent(element);
+    }
+
+    depay = newDepay;
+    qDebug() << "[VideoReceiver] buildDecodeChain:" << codec->depay << "→" << codec->parse << "→"
+             << codec->decoder << "threads" << lowLatency.decoderThreads;
+    return true;
+}
+
+// --- latency measurement -----------------------------------------------------
+//
+// A frame's running time is when its first packet reached us (rtspsrc stamps arrivals on the
+// pipeline clock), so the clock's running time at the sink pad minus the frame's is the time it
+// spent in the jitter buffer, depayloader, decoder and queues. The videosink renders without
+// sync, what reaches its pad is on screen a refresh later.
+// With the camera's RTCP sender reports rtspsrc also attaches the capture time in NTP, which
+// against our wall clock gives glass-to-glass. That is only as good as the two clocks agree, so
+// it needs the camera and this machine synchronised (NTP/PTP).
+
+void VideoReceiver::attachLatencyProbe() {
+    {
+        std::lock_guard<std::mutex> lock(latencyStats.mutex);
+        gst_segment_init(&latencyStats.segment, GST_FORMAT_UNDEFINED);
+        latencyStats.receiverSumMs = 0.;
+        latencyStats.glassSumMs = 0.;
+        latencyStats.frames = 0;
+        latencyStats.glassFrames = 0;
+        latencyStats.lastReport = GST_CLOCK_TIME_NONE;
+    }
+
+    GstPad *sinkPad = gst_element_get_static_pad(videosink, "sink");
+    if (!sinkPad) {
+        qDebug() << "[VideoReceiver] attachLatencyProbe: videosink has no sink pad, latency not measured";
+        return;
+    }
+    gst_pad_add_probe(sinkPad,
+                      GstPadProbeType(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      VideoReceiver::latencyProbe, this, nullptr);
+    gst_object_unref(sinkPad);
+}
+
+GstPadProbeReturn VideoReceiver::latencyProbe(GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    auto *self = static_cast<VideoReceiver*>(data);
+    LatencyStats &stats = self->latencyStats;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+            const GstSegment *segment = nullptr;
+            gst_event_parse_segment(event, &segment);
+            std::lock_guard<std::mutex> lock(stats.mutex);
+            gst_segment_copy_into(segment, &stats.segment);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) return GST_PAD_PROBE_OK;
+
+    GstElement *sink = gst_pad_get_parent_element(pad);
+    if (!sink) return GST_PAD_PROBE_OK;
+    GstClock *clock = gst_element_get_clock(sink);
+    GstClockTime baseTime = gst_element_get_base_time(sink);
+    gst_object_unref(sink);
+    if (!clock) return GST_PAD_PROBE_OK;
+    GstClockTime now = gst_clock_get_time(clock) - baseTime;
+    gst_object_unref(clock);
+
+    // NTP capture time of the frame, when the camera sends RTCP and GStreamer is 1.22+
+    static GstCaps *ntpCaps = gst_caps_new_empty_simple("timestamp/x-ntp");
+    double glassMs = -1.;
+    if (GstReferenceTimestampMeta *meta = gst_buffer_get_reference_timestamp_meta(buffer, ntpCaps)) {
+        guint64 wallNtp = guint64(g_get_real_time()) * GST_USECOND + NTP_UNIX_OFFSET_S * GST_SECOND;
+        if (wallNtp > meta->timestamp) glassMs = double(wallNtp - meta->timestamp) / GST_MSECOND;
+    }
+
+    double receiverMs = 0.;
+    double glassAvgMs = -1.;
+    {
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        if (stats.segment.format != GST_FORMAT_TIME) return GST_PAD_PROBE_OK;
+        GstClockTime running = gst_segment_to_running_time(&stats.segment, GST_FORMAT_TIME,
+                                                           GST_BUFFER_PTS(buffer));
+        if (!GST_CLOCK_TIME_IS_VALID(running) || running > now) return GST_PAD_PROBE_OK;
+
+        stats.receiverSumMs += double(now - running) / GST_MSECOND;
+        stats.frames++;
+        if (glassMs >= 0.) {
+            stats.glassSumMs += glassMs;
+            stats.glassFrames++;
+        }
+
+        if (!GST_CLOCK_TIME_IS_VALID(stats.lastReport)) stats.lastReport = now;
+        if (now - stats.lastReport < GST_SECOND) return GST_PAD_PROBE_OK;
+
+        receiverMs = stats.receiverSumMs / stats.frames;
+        if (stats.glassFrames > 0) glassAvgMs = stats.glassSumMs / stats.glassFrames;
+        stats.receiverSumMs = 0.;
+        stats.glassSumMs = 0.;
+        stats.frames = 0;
+        stats.glassFrames = 0;
+        stats.lastReport = now;
+    }
+
+    // Streaming thread, receivers in the GUI thread get it queued
+    emit self->latencyUpdated(receiverMs, glassAvgMs);
+    return GST_PAD_PROBE_OK;
+}
+
+// --- recording ---------------------------------------------------------------
+
+bool VideoReceiver::startRecording(const QString &path) {
+    return recorder->start(path);
+}
+
+void VideoReceiver::stopRecording() {
+    recorder->stop();
+}
+
+bool VideoReceiver::isRecording() const {
+    return recorder->isRecording();
+}
+
+void VideoReceiver::setRecordingPrerollBytes(size_t bytes) {
+    recorder->setPrerollBytes(bytes);
+}
+
+size_t VideoReceiver::recordingPrerollBytes() const {
+    return recorder->prerollBytes();
+}
+
+qint64 VideoReceiver::recordingPrerollMs() const {
+    return qint64(recorder->prerollDuration() / GST_MSECOND);
+}
+
+void VideoReceiver::setRecordingFragmentDuration(guint ms) {
+    recorder->setFragmentDuration(ms);
+}
+
+guint VideoReceiver::recordingFragmentDuration() const {
+    return recorder->fragmentDuration();
+}
+
+void VideoReceiver::tapParser(GstElement *parser) {
+    // SPS/PPS (and VPS) in front of every keyframe, so a file can start at any of them
+    g_object_set(parser, "config-interval", -1, nullptr);
+
+    GstPad *srcPad = gst_element_get_static_pad(parser, "src");
+    gst_pad_add_probe(srcPad, GST_PAD_PROBE_TYPE_BUFFER, VideoReceiver::accessUnitProbe, this, nullptr);
+    gst_object_unref(srcPad);
+    qDebug() << "[VideoReceiver] tapParser: recording from" << GST_OBJECT_NAME(parser);
+}
+
+GstPadProbeReturn VideoReceiver::accessUnitProbe(GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    auto *self = static_cast<VideoReceiver*>(data);
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer) return GST_PAD_PROBE_OK;
+
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    self->recorder->pushAccessUnit(buffer, caps);
+    if (caps) gst_caps_unref(caps);
+    return GST_PAD_PROBE_OK;
+}
+
+void VideoReceiver::onDeepElementAdded(GstBin * /*bin*/, GstBin * /*subBin*/, GstElement *element, gpointer data) {
+    GstElementFactory *factory = gst_element_get_factory(element);
+    if (!factory) return;
+    const gchar *name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory));
+    if (g_strcmp0(name, "h264parse") == 0 || g_strcmp0(name, "h265parse") == 0) {
+        static_cast<VideoReceiver*>(data)->tapParser(element);
+    }
+}
@@ -4,11 +4,30 @@
 #include <QObject>
 #include <QWidget>  // Include this header to define WId
 #include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <mutex>
+#include "VideoFrame.h"
+#include "StreamRecorder.h"
 
 class VideoReceiver : public QObject {
     Q_OBJECT
 
 public:
+    enum class PipelineMode {
+        Playbin,      // playbin picks depayloader, decoder and sink, smooth but opaque
+        LowLatency    // explicit rtspsrc graph, tuned for control responsiveness
+    };
+
+    // Knobs of the low-latency graph. A larger jitter buffer and deeper queues play smoother over
+    // a bad link, smaller ones get the picture to the operator sooner.
+    struct LowLatencySettings {
+        guint jitterBufferMs = 50;    // rtspsrc latency
+        bool dropOnLatency = true;    // drop packets that would be late rather than wait for them
+        int queueBuffers = 2;         // per leaky queue, the oldest frames go first when full
+        int decoderThreads = 0;       // avdec max-threads, 0 is one per core
+        bool tcp = false;             // RTSP over TCP (interleaved) instead of UDP
+    };
+
     explicit VideoReceiver(QObject *parent = nullptr);
     ~VideoReceiver();
 
@@ -19,23 +38,96 @@ public:
     void stop();
     bool isPlaying() const;
     void start();
+    // Latest decoded frame at stream resolution, null until the first one arrived
     QImage grabFrame();
+    VideoFrame latestFrame() const;
     void setRtspUri(const QString &uri);
     void createPipeline(const QString& uri);
 
+    // Records the compressed stream as received, no second RTSP session and no re-encoding. The
+    // file starts with the pre-roll, the last GOPs received before the call; ".mkv" is Matroska,
+    // anything else MP4.
+    bool startRecording(const QString &path);
+    void stopRecording();
+    bool isRecording() const;
+    // Bytes of compressed stream kept for the pre-roll, 0 records from the next keyframe only
+    void setRecordingPrerollBytes(size_t bytes);
+    size_t recordingPrerollBytes() const;
+    qint64 recordingPrerollMs() const;
+    // Segmented recording: MP4 files as fragments of about this many ms plus an index, 0 is off
+    void setRecordingFragmentDuration(guint ms);
+    guint recordingFragmentDuration() const;
+
+    // Takes effect on the next createPipeline() / setRtspUri()
+    void setPipelineMode(PipelineMode mode);
+    PipelineMode pipelineMode() const;
+    void setLowLatencySettings(const LowLatencySettings &settings);
+    LowLatencySettings lowLatencySettings() const;
+
 signals:
     void cameraStarted();
     void cameraError(const QString &message);
     void videoCharacteristicsUpdated(const QString &characteristics);
+    // About once a second while frames reach the sink, averaged over the frames since the last
+    // update. receiverMs is the time from a packet reaching us to its frame reaching the sink,
+    // glassToGlassMs from the camera capturing it, -1 when the camera sends no RTCP time
+    void latencyUpdated(double receiverMs, double glassToGlassMs);
+    // Every decoded frame the pool has room for, emitted from the streaming thread. Direct
+    // connections must return quickly, queued ones hold a pool slot until they run.
+    void frameReady(const VideoFrame &frame);
+    void recordingStarted(const QString &path);
+    void recordingStopped(const QString &path);
+    void recordingError(const QString &message);
 
 private:
+    struct LatencyStats {
+        std::mutex mutex;
+        GstSegment segment;           // last segment seen on the sink pad
+        double receiverSumMs = 0.;
+        double glassSumMs = 0.;
+        int frames = 0;
+        int glassFrames = 0;
+        GstClockTime lastReport = GST_CLOCK_TIME_NONE;
+    };
+
+    // "videoPipeline" of the config file, read once at construction so the setters win later
+    void loadPipelineSettings();
+    bool createLowLatencyPipeline(const QString& uri);
+    // Builds depay → parse → queue → decoder → convert → queue → sink for the stream's codec
+    bool buildDecodeChain(const gchar *encoding);
+    void attachLatencyProbe();
+    static GstPadProbeReturn latencyProbe(GstPad *pad, GstPadProbeInfo *info, gpointer data);
+    GstElement* makeVideoSink();
+    // tee → videosink, tee → leaky queue → videoconvert → appsink (frame tap)
+    GstElement* makeSinkBin();
+    GstElement* displaySink() const;
+    static GstFlowReturn onNewSample(GstAppSink *sink, gpointer data);
+    // Feeds the parser's access units to the recorder, the parser repeats SPS/PPS at keyframes
+    void tapParser(GstElement *parser);
+    static GstPadProbeReturn accessUnitProbe(GstPad *pad, GstPadProbeInfo *info, gpointer data);
+    // playbin mode: finds the parser decodebin plugs in
+    static void onDeepElementAdded(GstBin *bin, GstBin *subBin, GstElement *element, gpointer data);
+
     GstElement *pipeline   = nullptr;
     GstElement *convert    = nullptr;
     GstElement *videosink  = nullptr;
     GstElement *appsink    = nullptr;
     GstElement *rtspSrc    = nullptr;
+    GstElement *sinkBin    = nullptr;   // videosink plus the frame tap, what the decoder feeds
+    GstElement *depay      = nullptr;   // low-latency mode, created once the codec is known
     WId savedWindowId = 0;
     bool analysisPrinted = false;
+
+    PipelineMode mode = PipelineMode::Playbin;
+    LowLatencySettings lowLatency;
+    LatencyStats latencyStats;
+
+    static constexpr int FRAME_POOL_CAPACITY = 4;
+    VideoFramePool framePool{FRAME_POOL_CAPACITY};
+    VideoFrame lastFrame;             // guarded by frameMutex, holds one pool slot
+    mutable std::mutex frameMutex;
+
+    StreamRecorder *recorder = nullptr;
 };
 
 #endif // VIDEORECEIVER_H
@@ -0,0 +1,275 @@
+// Checks FragmentWriter's box tracking and index on a synthetic fragmented MP4, then measures how
+// fast it gets a stream to disk
+//
+// Usage: fragment-writer-bench [directory]
+// The stream is fed in pieces split at arbitrary byte boundaries and has 32- and 64-bit box
+// sizes, both mdhd and tfdt versions and a fragment larger than the write buffer. fdatasync is
+// interposed: the file must be synced at the end of the init segment, of every fragment and at
+// close, and nowhere else.
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+#include "FragmentWriter.h"
+
+namespace {
+
+std::mutex syncMutex;
+std::vector<long long> syncedSizes;  // file size at every fdatasync
+
+} // namespace
+
+// Takes the place of libc's for FragmentWriter, which is linked into this executable
+extern "C" int fdatasync(int fd) {
+    struct stat st{};
+    fstat(fd, &st);
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        syncedSizes.push_back(static_cast<long long>(st.st_size));
+    }
+    return static_cast<int>(syscall(SYS_fdatasync, fd));
+}
+
+namespace {
+
+using Bytes = std::vector<guint8>;
+
+constexpr guint32 TIMESCALE = 90000;
+
+void put32(Bytes& out, guint32 value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(guint8(value >> shift));
+}
+
+void put64(Bytes& out, guint64 value) {
+    put32(out, guint32(value >> 32));
+    put32(out, guint32(value));
+}
+
+Bytes concat(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const Bytes& part : parts) out.insert(out.end(), part.begin(), part.end());
+    return out;
+}
+
+Bytes box(const char* type, const Bytes& payload, bool largeSize = false) {
+    Bytes out;
+    put32(out, largeSize ? 1 : guint32(8 + payload.size()));
+    out.insert(out.end(), type, type + 4);
+    if (largeSize) put64(out, 16 + payload.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+Bytes fullBox(const char* type, guint8 version, const Bytes& payload) {
+    return box(type, concat({Bytes{version, 0, 0, 0}, payload}));
+}
+
+Bytes word32(guint32 value) {
+    Bytes out;
+    put32(out, value);
+    return out;
+}
+
+Bytes mdhd(guint8 version) {
+    Bytes payload;
+    if (version == 1) {
+        put64(payload, 0);          // creation
+        put64(payload, 0);          // modification
+        put32(payload, TIMESCALE);
+        put64(payload, 0);          // duration
+    } else {
+        put32(payload, 0);
+        put32(payload, 0);
+        put32(payload, TIMESCALE);
+        put32(payload, 0);
+    }
+    put32(payload, 0);              // language, pre_defined
+    return fullBox("mdhd", version, payload);
+}
+
+struct Fragment {
+    guint64 offset;
+    guint64 size;
+    guint64 decodeTime;
+};
+
+struct Stream {
+    Bytes bytes;
+    guint64 initEnd = 0;
+    std::vector<Fragment> fragments;
+};
+
+Stream buildStream(guint8 mdhdVersion, bool bigFragment) {
+    Stream stream;
+    Bytes moov = box("moov", concat({
+        fullBox("mvhd", 0, Bytes(96)),
+        box("trak", concat({
+            fullBox("tkhd", 0, Bytes(80)),
+            box("mdia", concat({mdhd(mdhdVersion), fullBox("hdlr", 0, Bytes(20))})),
+        })),
+    }));
+    stream.bytes = concat({box("ftyp", Bytes{'i', 's', 'o', 'm', 0, 0, 2, 0}), moov});
+    stream.initEnd = stream.bytes.size();
+
+    for (guint32 i = 0; i < 6; i++) {
+        // Past 2^32 ticks from the fourth fragment on, which only a version 1 tfdt can carry
+        guint64 decodeTime = guint64(i) * 2 * TIMESCALE + (i >= 3 ? (guint64(1) << 33) : 0);
+        Bytes tfdt;
+        if (i >= 3 || i == 1) {
+            Bytes time;
+            put64(time, decodeTime);
+            tfdt = fullBox("tfdt", 1, time);
+        } else {
+            tfdt = fullBox("tfdt", 0, word32(guint32(decodeTime)));
+        }
+        Bytes moof = box("moof", concat({
+            fullBox("mfhd", 0, word32(i + 1)),
+            box("traf", concat({fullBox("tfhd", 0, word32(1)), tfdt, fullBox("trun", 0, Bytes(12))})),
+        }));
+        size_t samples = (bigFragment && i == 4) ? 5 * 1024 * 1024 : 1000 + i * 777;
+        Bytes payload(samples);
+        for (size_t j = 0; j < samples; j++) payload[j] = guint8(j * 31 + i);
+        Bytes mdat = box("mdat", payload, i == 2 || i == 4);
+
+        stream.fragments.push_back({stream.bytes.size(), moof.size() + mdat.size(), decodeTime});
+        stream.bytes.insert(stream.bytes.end(), moof.begin(), moof.end());
+        stream.bytes.insert(stream.bytes.end(), mdat.begin(), mdat.end());
+    }
+    Bytes mfra = box("mfra", Bytes(8));
+    stream.bytes.insert(stream.bytes.end(), mfra.begin(), mfra.end());
+    return stream;
+}
+
+void feed(FragmentWriter& writer, const guint8* data, size_t size) {
+    GstBuffer* buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+    gst_buffer_fill(buffer, 0, data, size);
+    writer.write(buffer);
+    gst_buffer_unref(buffer);
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// chunk 0 feeds pieces of random size
+bool check(const std::string& path, guint8 mdhdVersion, size_t chunk) {
+    Stream stream = buildStream(mdhdVersion, chunk == 0 || chunk > 4096);
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        syncedSizes.clear();
+    }
+
+    FragmentWriter writer;
+    if (!writer.open(QString::fromStdString(path))) {
+        std::printf("  cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::mt19937 random(chunk + mdhdVersion);
+    for (size_t at = 0; at < stream.bytes.size();) {
+        size_t take = chunk ? chunk : std::uniform_int_distribution<size_t>(1, 50000)(random);
+        take = std::min(take, stream.bytes.size() - at);
+        feed(writer, stream.bytes.data() + at, take);
+        at += take;
+    }
+    if (!writer.close()) {
+        std::printf("  write failed: %s\n", writer.errorString().toStdString().c_str());
+        return false;
+    }
+
+    bool ok = true;
+    auto fail = [&](const std::string& what) {
+        std::string pieces = chunk ? std::to_string(chunk) + " byte" : std::string("random");
+        std::printf("  mdhd v%d, %s pieces: %s\n", mdhdVersion, pieces.c_str(), what.c_str());
+        ok = false;
+    };
+
+    std::string written = readFile(path);
+    if (written != std::string(stream.bytes.begin(), stream.bytes.end())) fail("file differs from the stream");
+
+    std::ostringstream expected;
+    expected << "# offset size start_s\n";
+    for (const Fragment& fragment : stream.fragments) {
+        char line[96];
+        std::snprintf(line, sizeof(line), "%llu %llu %.3f\n", static_cast<unsigned long long>(fragment.offset),
+                      static_cast<unsigned long long>(fragment.size), double(fragment.decodeTime) / TIMESCALE);
+        expected << line;
+    }
+    expected << "# end " << stream.bytes.size() << "\n";
+    std::string index = readFile(FragmentWriter::indexPath(QString::fromStdString(path)).toStdString());
+    if (index != expected.str()) fail("index is\n" + index + "expected\n" + expected.str());
+
+    std::vector<long long> expectedSyncs = {static_cast<long long>(stream.initEnd)};
+    for (const Fragment& fragment : stream.fragments) {
+        expectedSyncs.push_back(static_cast<long long>(fragment.offset + fragment.size));
+    }
+    expectedSyncs.push_back(static_cast<long long>(stream.bytes.size()));
+    std::lock_guard<std::mutex> lock(syncMutex);
+    if (syncedSizes != expectedSyncs) {
+        std::string seen;
+        for (long long size : syncedSizes) seen += " " + std::to_string(size);
+        fail("synced at" + seen);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    std::string dir = argc > 1 ? argv[1] : g_get_tmp_dir();
+    std::string path = dir + "/fragment-writer-bench.mp4";
+
+    bool ok = true;
+    int runs = 0;
+    for (guint8 version : {0, 1}) {
+        for (size_t chunk : {size_t(1), size_t(3), size_t(8), size_t(13), size_t(16), size_t(4093), size_t(0),
+                             size_t(64) * 1024 * 1024}) {
+            ok = check(path, version, chunk) && ok;
+            runs++;
+        }
+    }
+    if (!ok) return EXIT_FAILURE;
+    std::printf("index, file and syncs match on %d split patterns\n\n", runs);
+
+    // 128 MiB in 64 KiB buffers as mp4mux hands them over, 2 MiB fragments
+    constexpr size_t FRAGMENT_BYTES = 2 * 1024 * 1024;
+    constexpr size_t PIECE_BYTES = 64 * 1024;
+    constexpr int FRAGMENTS = 64;
+    Bytes init = buildStream(0, false).bytes;
+    init.resize(buildStream(0, false).initEnd);
+    Bytes mdat = box("mdat", Bytes(FRAGMENT_BYTES), true);
+    Bytes moof = box("moof", box("traf", fullBox("tfdt", 1, Bytes(8))));
+
+    FragmentWriter writer;
+    writer.open(QString::fromStdString(path));
+    auto start = std::chrono::steady_clock::now();
+    feed(writer, init.data(), init.size());
+    for (int i = 0; i < FRAGMENTS; i++) {
+        feed(writer, moof.data(), moof.size());
+        for (size_t at = 0; at < mdat.size(); at += PIECE_BYTES) {
+            feed(writer, mdat.data() + at, std::min(PIECE_BYTES, mdat.size() - at));
+        }
+    }
+    ok = writer.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double megabytes = double(FRAGMENTS) * double(FRAGMENT_BYTES) / (1024. * 1024.);
+    std::printf("  %-36s %10.1f MiB/s  (%d fragments, each synced)\n", "fragmented write", megabytes / seconds,
+                FRAGMENTS);
+
+    std::remove(path.c_str());
+    std::remove(FragmentWriter::indexPath(QString::fromStdString(path)).toStdString().c_str());
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+// Compares CPU time per probe of the in-process ICMP engine with the ping utility
+//
+// Usage: ping-bench [host] [probes]
+// Both go through Ping::pingHost*, one echo request per call, as the connectivity watcher sends
+// them. CPU time includes the engine's I/O thread and, for the ping utility, the child processes.
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <QtCore/QString>
+
+#include "icmp_engine.h"
+#include "latency_histogram.h"
+#include "ping.h"
+
+namespace {
+
+struct Cost {
+    double cpu_us_per_probe = 0.;
+    double wall_us_per_probe = 0.;
+    int answered = 0;
+    LatencyHistogram rtt;  // microseconds
+};
+
+double cpuUs() {
+    double total = 0.;
+    for (int who : {RUSAGE_SELF, RUSAGE_CHILDREN}) {
+        struct rusage usage{};
+        getrusage(who, &usage);
+        total += usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec;
+        total += usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+    }
+    return total;
+}
+
+template<typename Probe>
+Cost measure(int probes, Probe&& probe) {
+    Cost cost;
+    double cpuStart = cpuUs();
+    auto wallStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < probes; i++) {
+        Ping::PingResult result = probe();
+        if (!result.success) continue;
+        cost.answered++;
+        cost.rtt.record(uint64_t(result.roundTripTimeUs >= 0 ? result.roundTripTimeUs : result.roundTripTime * 1000));
+    }
+    double wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+    cost.cpu_us_per_probe = (cpuUs() - cpuStart) / probes;
+    cost.wall_us_per_probe = wallUs / probes;
+    return cost;
+}
+
+void printCost(const char* name, int probes, const Cost& cost, double baseline_cpu_us = 0.) {
+    std::printf("  %-14s %5d/%-5d %12.1f %12.1f %10.1f", name, cost.answered, probes, cost.cpu_us_per_probe,
+                cost.wall_us_per_probe, double(cost.rtt.value_at_percentile(50.)));
+    if (baseline_cpu_us > 0.) std::printf("  (%6.1fx less CPU)", baseline_cpu_us / cost.cpu_us_per_probe);
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QString host = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QStringLiteral("127.0.0.1");
+    int probes = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (probes <= 0) probes = 200;
+
+    Ping ping;
+    if (!ping.usesIcmpEngine()) {
+        std::printf("no ICMP socket available, run grant-permissions.sh or widen net.ipv4.ping_group_range\n");
+        return EXIT_FAILURE;
+    }
+    std::shared_ptr<IcmpEngine> engine = IcmpEngine::shared();
+    std::printf("pinging %s, ICMP engine on a %s socket\n\n", qPrintable(host),
+                engine->socketType() == IcmpEngine::SocketType::Datagram ? "datagram" : "raw");
+    std::printf("  %-14s %11s %12s %12s %10s\n", "", "answered", "cpu us/probe", "wall us/probe", "p50 rtt us");
+
+    // The utility is slow, a tenth of the probes is plenty to see its cost
+    int processProbes = std::max(1, probes / 10);
+    Cost process = measure(processProbes, [&]() { return ping.pingHostWithProcess(host, 1, 1000); });
+    bool processWorks = process.answered > 0;
+    if (processWorks) {
+        printCost("ping utility", processProbes, process);
+    } else {
+        std::printf("  %-14s unavailable or unanswered, skipped\n", "ping utility");
+    }
+
+    Cost inProcess = measure(probes, [&]() { return ping.pingHostWithStats(host, 1, 1000); });
+    printCost("icmp engine", probes, inProcess, processWorks ? process.cpu_us_per_probe : 0.);
+
+    // On loopback every engine probe must come back
+    return inProcess.answered == probes ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,206 @@
+// Drives the servo stack against the emulator at increasing command rates
+//
+// Usage: servo-load-bench [latency-ms] [jitter-ms] [loss] [reorder]
+// ServoClient rounds stream setPositionAsync() at a fixed rate for one second and report how many
+// commands were answered and how long the answers took. ServoCameraController rounds set absolute
+// positions at a fixed rate with the integrator at the same rate, and report how many positions
+// reached the emulator and how old they were when they got there.
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include "latency_histogram.h"
+#include "servo_client.hpp"
+#include "servo_emulator.hpp"
+#include "ServoCameraController.h"
+
+using namespace ServoControl;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr auto ROUND = std::chrono::milliseconds(1000);
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Round {
+    double issued_per_s = 0.;
+    double done_per_s = 0.;
+    uint64_t failed = 0;
+    double p50_ms = 0.;
+    double p99_ms = 0.;
+    double max_ms = 0.;
+};
+
+void fillLatency(Round& round, const LatencyHistogram& histogram) {
+    round.p50_ms = histogram.value_at_percentile(50.) / 1000.;
+    round.p99_ms = histogram.value_at_percentile(99.) / 1000.;
+    round.max_ms = histogram.max() / 1000.;
+}
+
+void printRound(int rate, const Round& round) {
+    std::printf("  %8d %10.0f %10.0f %8llu %8.2f %8.2f %8.2f\n", rate, round.issued_per_s, round.done_per_s,
+                (unsigned long long) round.failed, round.p50_ms, round.p99_ms, round.max_ms);
+}
+
+// Calls issue(n) for every command due at `rate` per second until the round is over
+template<typename Issue>
+uint64_t paced(int rate, Issue&& issue) {
+    uint64_t issued = 0;
+    auto start = Clock::now();
+    while (true) {
+        auto elapsed = Clock::now() - start;
+        if (elapsed >= ROUND) break;
+        auto due = uint64_t(std::chrono::duration<double>(elapsed).count() * rate);
+        for (; issued < due; issued++) issue(issued);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return issued;
+}
+
+Round clientRound(ServoClient& client, int rate) {
+    // The callbacks use these locals until the last one has counted itself, under the mutex
+    std::mutex mutex;
+    std::condition_variable done;
+    LatencyHistogram latency;
+    uint64_t answered = 0;
+    uint64_t failed = 0;
+
+    uint64_t issued = paced(rate, [&](uint64_t n) {
+        int64_t sent = nowUs();
+        client.setPositionAsync(int(n % 181), [&, sent](const ServoResponse& response) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (Utils::isSuccessResponse(response)) {
+                answered++;
+                latency.record(uint64_t(nowUs() - sent));
+            } else {
+                failed++;
+            }
+            done.notify_all();
+        });
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return answered + failed == issued; });
+    Round round;
+    double seconds = std::chrono::duration<double>(ROUND).count();
+    round.issued_per_s = double(issued) / seconds;
+    round.done_per_s = double(answered) / seconds;
+    round.failed = failed;
+    fillLatency(round, latency);
+    return round;
+}
+
+// Positions the controller delivered, timed from setGimbalPosition() to the emulator applying them
+struct Delivery {
+    std::array<std::atomic<int64_t>, 181> submitted_us{};
+    std::mutex mutex;
+    LatencyHistogram age;
+    std::atomic<uint64_t> delivered{0};
+
+    void onPosition(int position) {
+        if (position < 0 || position > 180) return;
+        int64_t submitted = submitted_us[size_t(position)].load();
+        if (submitted == 0) return;
+        delivered++;
+        std::lock_guard<std::mutex> lock(mutex);
+        age.record(uint64_t(nowUs() - submitted));
+    }
+
+    void reset() {
+        for (auto& time : submitted_us) time = 0;
+        delivered = 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        age.reset();
+    }
+};
+
+Round controllerRound(ServoCameraController& controller, Delivery& delivery, int rate) {
+    controller.setUpdateRate(rate);
+    ServoCameraController::MotionStats before = controller.motionStats();
+    delivery.reset();
+
+    // Walk the whole range so every command is a new position
+    uint64_t issued = paced(rate, [&](uint64_t n) {
+        int position = int(n % 181);
+        delivery.submitted_us[size_t(position)] = nowUs();
+        controller.setGimbalPosition(0, position);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    ServoCameraController::MotionStats after = controller.motionStats();
+    Round round;
+    double seconds = std::chrono::duration<double>(ROUND).count();
+    round.issued_per_s = double(issued) / seconds;
+    round.done_per_s = double(delivery.delivered) / seconds;
+    round.failed = after.failures - before.failures;
+    std::lock_guard<std::mutex> lock(delivery.mutex);
+    fillLatency(round, delivery.age);
+    return round;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Delivery delivery;
+
+    ServoEmulator::Config config;
+    config.port = 0;
+    config.latency_us = int((argc > 1 ? std::atof(argv[1]) : 2.) * 1000.);
+    config.jitter_us = int((argc > 2 ? std::atof(argv[2]) : 0.5) * 1000.);
+    config.loss = argc > 3 ? std::atof(argv[3]) : 0.005;
+    config.reorder = argc > 4 ? std::atof(argv[4]) : 0.01;
+    config.on_position = [&delivery](int, int position) { delivery.onPosition(position); };
+
+    ServoEmulator emulator(config);
+    if (!emulator.start()) return EXIT_FAILURE;
+    std::printf("emulated link: %.1f ms latency, +-%.1f ms jitter, %.1f %% loss, %.1f %% reordered\n\n",
+                config.latency_us / 1000., config.jitter_us / 1000., config.loss * 100., config.reorder * 100.);
+
+    bool answered = true;
+    const char* header = "  %8s %10s %10s %8s %8s %8s %8s\n";
+    for (WireFormat format : {WireFormat::JSON, WireFormat::COMPACT}) {
+        ServoClient client("127.0.0.1", emulator.port(), 250);
+        client.setPreferredWireFormat(format);
+        client.connect();
+        client.getCurrentPosition();
+
+        std::printf("ServoClient, %s\n", format == WireFormat::JSON ? "json" : "compact");
+        std::printf(header, "rate/s", "issued/s", "acked/s", "failed", "p50 ms", "p99 ms", "max ms");
+        for (int rate : {100, 500, 1000, 2000, 5000, 10000}) {
+            Round round = clientRound(client, rate);
+            printRound(rate, round);
+            if (round.done_per_s == 0.) answered = false;
+        }
+        std::printf("\n");
+    }
+
+    ServoCameraController controller("127.0.0.1", emulator.port());
+    if (!controller.start()) return EXIT_FAILURE;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::printf("ServoCameraController, absolute positions with the integrator at the same rate\n");
+    std::printf(header, "rate/s", "issued/s", "applied/s", "failed", "p50 ms", "p99 ms", "max ms");
+    for (int rate : {20, 50, 100, 200, 500, 1000}) {
+        Round round = controllerRound(controller, delivery, rate);
+        printRound(rate, round);
+        if (round.done_per_s == 0.) answered = false;
+    }
+    controller.stop();
+    emulator.stop();
+
+    ServoEmulator::Stats stats = emulator.stats();
+    std::printf("\nemulator: %llu requests (%llu compact), %llu replies, %llu dropped, %llu reordered\n",
+                (unsigned long long) stats.requests, (unsigned long long) stats.compact_requests,
+                (unsigned long long) stats.replies, (unsigned long long) stats.dropped,
+                (unsigned long long) stats.reordered);
+
+    // With the emulator on the same host every round must get answers
+    return answered ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+// Checks Utils::parsePosition against the regex it replaced and compares their cost
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "servo_client.hpp"
+
+using namespace ServoControl;
+
+namespace {
+
+// What extractPositionFromResponse did before, one regex per call
+int regex_position(const std::string& message) {
+    std::regex position_regex(R"(.*position.*?(\d+))");
+    std::smatch match;
+    if (std::regex_search(message, match, position_regex)) {
+        try {
+            return std::stoi(match[1].str());
+        } catch (const std::exception&) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// The same regex built once, the best the old approach could do
+int cached_regex_position(const std::string& message) {
+    static const std::regex position_regex(R"(.*position.*?(\d+))");
+    std::smatch match;
+    if (std::regex_search(message, match, position_regex)) {
+        try {
+            return std::stoi(match[1].str());
+        } catch (const std::exception&) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+int main() {
+    const std::vector<std::string> corpus = {
+        "Current servo position: 90",
+        "Servo position set to 135",
+        "Current servo position: 0",
+        "position 7",
+        "position: 12 degrees, target 30",
+        "old position 10, new position 20",
+        "position 5 and position none",
+        "no position reported",
+        "line 1\nposition 44",
+        "position 1\nposition 2",
+        "position 5\nposition 99999999999",
+        "position 99999999999\nposition 3",
+        "position none\r\nposition 6",
+        "position\n55",
+        "Current servo position: 99999999999",
+        "position 2147483647",
+        "position 2147483648",
+        "positions 8",
+        "Position 9",
+        "GPIO 32 position -15",
+        "",
+    };
+
+    bool ok = true;
+    for (const std::string& message : corpus) {
+        int expected = regex_position(message);
+        int parsed = Utils::parsePosition(message).value_or(-1);
+        if (parsed != expected) {
+            std::printf("mismatch on \"%s\": regex %d, parsePosition %d\n", message.c_str(), expected, parsed);
+            ok = false;
+        }
+    }
+    if (!ok) return EXIT_FAILURE;
+    std::printf("parsePosition agrees with the regex on %zu messages\n\n", corpus.size());
+
+    const std::string reply = "Current servo position: 135";
+    double regex_ns = time_per_op_ns(20000, [&] { do_not_optimize(regex_position(reply)); });
+    print_result("regex built per call (old)", regex_ns);
+    print_result("regex built once", time_per_op_ns(200000, [&] {
+        do_not_optimize(cached_regex_position(reply));
+    }), regex_ns);
+    print_result("parsePosition", time_per_op_ns(10000000, [&] {
+        do_not_optimize(Utils::parsePosition(reply));
+    }), regex_ns);
+    return EXIT_SUCCESS;
+}
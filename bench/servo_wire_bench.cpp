@@ -0,0 +1,109 @@
+// Compares the JSON and compact servo wire formats end to end
+//
+// Usage: servo-wire-bench [commands]
+// The servo emulator on loopback plays the servo server and answers both formats. Each command is
+// a full ServoClient round trip: serialize, sendto, recvfrom on both sides, parse, and reading the
+// position back out of the reply. Commands are timed one at a time and with a window of them in
+// flight through the asynchronous API.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "bench_util.h"
+#include "servo_client.hpp"
+#include "servo_emulator.hpp"
+
+using namespace ServoControl;
+
+namespace {
+
+struct ModeResult {
+    double ns_per_command = 0.;
+    double pipelined_ns_per_command = 0.;
+    bool positions_match = true;
+};
+
+constexpr int PIPELINE_WINDOW = 16;
+
+ModeResult run_mode(int port, WireFormat format, size_t commands) {
+    ServoClient client("127.0.0.1", port, 1000);
+    client.setPreferredWireFormat(format);
+    client.connect();
+
+    ModeResult result;
+    // First exchange negotiates, keep it out of the timing
+    client.getCurrentPosition();
+    if (client.getWireFormat() != format) {
+        std::printf("  client did not switch to the requested wire format\n");
+        result.positions_match = false;
+        return result;
+    }
+
+    size_t i = 0;
+    result.ns_per_command = time_per_op_ns(commands, [&] {
+        int target = int(i++ % 181);
+        ServoResponse response = client.setPosition(target);
+        if (Utils::extractPositionFromResponse(response) != target) result.positions_match = false;
+    });
+
+    // Same commands with up to PIPELINE_WINDOW waiting for their replies
+    std::atomic<int> in_flight{0};
+    std::atomic<size_t> mismatches{0};
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < commands; n++) {
+        while (in_flight.load() >= PIPELINE_WINDOW) std::this_thread::yield();
+        in_flight++;
+        int target = int(n % 181);
+        client.setPositionAsync(target, [&, target](const ServoResponse& response) {
+            if (Utils::extractPositionFromResponse(response) != target) mismatches++;
+            in_flight--;
+        });
+    }
+    while (in_flight.load() > 0) std::this_thread::yield();
+    auto end = std::chrono::steady_clock::now();
+    result.pipelined_ns_per_command = std::chrono::duration<double, std::nano>(end - start).count() / double(commands);
+    if (mismatches > 0) result.positions_match = false;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t commands = argc > 1 ? size_t(std::strtoul(argv[1], nullptr, 10)) : 20000;
+
+    ServoEmulator::Config config;
+    config.port = 0;
+    ServoEmulator emulator(config);
+    if (!emulator.start()) return EXIT_FAILURE;
+
+    ServoRequest sample(RequestType::SET_NEW_POSITION, 90);
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "request_type", 1);
+    cJSON_AddNumberToObject(json, "new_value", 90);
+    cJSON* gpio = cJSON_AddObjectToObject(json, "gpio_definition");
+    cJSON_AddStringToObject(gpio, "consumer", sample.gpio_def.consumer.c_str());
+    cJSON_AddStringToObject(gpio, "gpio_chip", sample.gpio_def.gpio_chip.c_str());
+    cJSON_AddNumberToObject(gpio, "gpio_line", sample.gpio_def.gpio_line);
+    char* text = cJSON_PrintUnformatted(json);
+    std::printf("request size: json %zu bytes, compact %zu bytes\n\n", std::strlen(text), sizeof(Wire::CompactRequest));
+    std::free(text);
+    cJSON_Delete(json);
+
+    std::printf("setPosition round trip over loopback, %zu commands\n", commands);
+    ModeResult json_mode = run_mode(emulator.port(), WireFormat::JSON, commands);
+    print_result("json", json_mode.ns_per_command);
+    ModeResult compact_mode = run_mode(emulator.port(), WireFormat::COMPACT, commands);
+    print_result("compact", compact_mode.ns_per_command, json_mode.ns_per_command);
+    std::printf("\nwith %d commands in flight\n", PIPELINE_WINDOW);
+    print_result("json", json_mode.pipelined_ns_per_command, json_mode.ns_per_command);
+    print_result("compact", compact_mode.pipelined_ns_per_command, json_mode.ns_per_command);
+
+    emulator.stop();
+
+    bool ok = json_mode.positions_match && compact_mode.positions_match;
+    if (!ok) std::printf("replies did not report the commanded position\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,599 @@
+#include "icmp_engine.h"
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+    #include <netinet/ip.h>
+    #include <netinet/ip_icmp.h>
+    #include <linux/errqueue.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #include <algorithm>
+    #include <cerrno>
+    #include <cstring>
+    #include <ctime>
+    #include <vector>
+#endif
+
+#ifdef __linux__
+
+namespace {
+    // Echo payload after the ICMP header, enough to tell our probes apart in a capture
+    constexpr size_t PAYLOAD_SIZE = 16;
+    constexpr char PAYLOAD_TAG[] = "HexaCam";
+
+    constexpr int RECEIVE_BUFFER_BYTES = 1 << 20;
+
+    // ICMP_FILTER from <linux/icmp.h>, which cannot be included next to <netinet/ip_icmp.h>
+    constexpr int RAW_ICMP_FILTER = 1;
+
+    int64_t realtimeNs() {
+        struct timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    uint16_t checksum(const uint8_t* data, size_t len) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i + 1 < len; i += 2) {
+            sum += uint32_t(data[i]) << 8 | data[i + 1];
+        }
+        if (len & 1) {
+            sum += uint32_t(data[len - 1]) << 8;
+        }
+        while (sum >> 16) {
+            sum = (sum & 0xffff) + (sum >> 16);
+        }
+        return htons(static_cast<uint16_t>(~sum));
+    }
+
+    std::string icmpErrorText(int type, int code) {
+        if (type == ICMP_DEST_UNREACH) {
+            switch (code) {
+                case ICMP_NET_UNREACH: return "Destination network unreachable";
+                case ICMP_HOST_UNREACH: return "Destination host unreachable";
+                case ICMP_PKT_FILTERED: return "Destination administratively prohibited";
+                default: return "Destination unreachable";
+            }
+        }
+        if (type == ICMP_TIME_EXCEEDED) {
+            return "Time to live exceeded";
+        }
+        return "ICMP error " + std::to_string(type) + "/" + std::to_string(code);
+    }
+}
+
+IcmpEngine::IcmpEngine() {
+}
+
+IcmpEngine::~IcmpEngine() {
+    close();
+}
+
+std::shared_ptr<IcmpEngine> IcmpEngine::shared(std::string* error) {
+    static std::mutex mutex;
+    static std::weak_ptr<IcmpEngine> instance;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<IcmpEngine> engine = instance.lock();
+    if (engine) {
+        return engine;
+    }
+
+    engine = std::make_shared<IcmpEngine>();
+    if (!engine->open()) {
+        if (error) *error = engine->lastError();
+        return nullptr;
+    }
+    instance = engine;
+    return engine;
+}
+
+bool IcmpEngine::open() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (ioRunning) {
+        return true;
+    }
+
+    // Unprivileged ping socket first, raw socket if the sysctl does not allow it
+    SocketType opened = SocketType::Datagram;
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+    if (socketFd < 0) {
+        std::string datagramError = strerror(errno);
+        opened = SocketType::Raw;
+        socketFd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+        if (socketFd < 0) {
+            setLastError("Failed to open an ICMP socket: datagram: " + datagramError +
+                         ", raw: " + strerror(errno));
+            return false;
+        }
+    }
+
+    int on = 1;
+    if (setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        // Still works, round trips then end when the I/O thread reads the reply
+        setLastError("Kernel receive timestamps unavailable: " + std::string(strerror(errno)));
+    }
+    // Room for a reply from every probe in flight even when they all arrive together
+    int receiveBuffer = RECEIVE_BUFFER_BYTES;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    if (opened == SocketType::Datagram) {
+        // ICMP errors for our probes (unreachable, TTL exceeded) arrive on the error queue
+        setsockopt(socketFd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+    } else {
+        // Only wake up for replies and errors, not for every echo request the host sends
+        uint32_t filter = ~((1u << ICMP_ECHOREPLY) | (1u << ICMP_DEST_UNREACH) | (1u << ICMP_TIME_EXCEEDED));
+        setsockopt(socketFd, SOL_RAW, RAW_ICMP_FILTER, &filter, sizeof(filter));
+        // Another process (or engine) may use the same raw socket type, tell our replies apart
+        identifier = static_cast<uint16_t>(getpid() ^ (reinterpret_cast<uintptr_t>(this) >> 4));
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool registered = epollFd >= 0 && wakeFd >= 0;
+    for (int fd : {socketFd, wakeFd}) {
+        if (!registered) break;
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        registered = epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+    if (!registered) {
+        setLastError("Failed to set up socket polling: " + std::string(strerror(errno)));
+        for (int* fd : {&socketFd, &epollFd, &wakeFd}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+        return false;
+    }
+
+    type = opened;
+    ioRunning = true;
+    ioThread = std::thread([this]() { ioLoop(); });
+    return true;
+}
+
+void IcmpEngine::close() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (ioThread.joinable()) {
+        ioRunning = false;
+        wakeIoThread();
+        ioThread.join();
+    }
+
+    for (int* fd : {&socketFd, &epollFd, &wakeFd}) {
+        if (*fd >= 0) ::close(*fd);
+        *fd = -1;
+    }
+    type = SocketType::None;
+}
+
+bool IcmpEngine::isOpen() const {
+    return ioRunning;
+}
+
+IcmpEngine::SocketType IcmpEngine::socketType() const {
+    return type;
+}
+
+std::string IcmpEngine::lastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastErrorMessage;
+}
+
+bool IcmpEngine::resolve(const std::string& host, in_addr& address) {
+    if (inet_pton(AF_INET, host.c_str(), &address) == 1) {
+        return true;
+    }
+
+    struct addrinfo hints{};
+    hints.ai_family = AF_INET;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    address = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+uint16_t IcmpEngine::probe(const in_addr& address, int timeoutMs, Callback callback) {
+    auto fail = [&callback](const std::string& message) {
+        Reply reply;
+        reply.error = message;
+        if (callback) callback(reply);
+        return uint16_t(0);
+    };
+
+    if (!ioRunning) {
+        return fail("ICMP engine not open");
+    }
+
+    uint8_t packet[sizeof(icmphdr) + PAYLOAD_SIZE] = {};
+    auto* header = reinterpret_cast<icmphdr*>(packet);
+    header->type = ICMP_ECHO;
+    header->un.echo.id = htons(identifier);
+    memcpy(packet + sizeof(icmphdr), PAYLOAD_TAG, sizeof(PAYLOAD_TAG));
+
+    struct sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr = address;
+
+    // Register before sending so the reply cannot beat us to the table
+    uint16_t sequence = 0;
+    bool wake = true;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (int tries = 0; tries < 0xffff && sequence == 0; ++tries) {
+            uint16_t candidate = nextSequence++;
+            if (nextSequence == 0) nextSequence = 1;
+            if (pending.find(candidate) == pending.end()) sequence = candidate;
+        }
+        if (sequence != 0) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            // The I/O thread only needs waking if this deadline comes before all the others
+            for (const auto& entry : pending) {
+                if (entry.second.deadline <= deadline) {
+                    wake = false;
+                    break;
+                }
+            }
+            header->un.echo.sequence = htons(sequence);
+            header->checksum = checksum(packet, sizeof(packet));
+            pending.emplace(sequence, PendingProbe{std::move(callback), to.sin_addr.s_addr, realtimeNs(), deadline});
+        }
+    }
+    if (sequence == 0) {
+        return fail("Too many probes in flight");
+    }
+    if (wake) {
+        wakeIoThread();
+    }
+
+    if (sendto(socketFd, packet, sizeof(packet), 0, reinterpret_cast<sockaddr*>(&to), sizeof(to)) < 0) {
+        std::string message = "Failed to send echo request: " + std::string(strerror(errno));
+        Callback failed;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            auto it = pending.find(sequence);
+            if (it != pending.end()) {
+                failed = std::move(it->second.callback);
+                pending.erase(it);
+            }
+        }
+        callback = std::move(failed);
+        return fail(message);
+    }
+    return sequence;
+}
+
+IcmpEngine::Reply IcmpEngine::probeSync(const in_addr& address, int timeoutMs) {
+    auto promise = std::make_shared<std::promise<Reply>>();
+    std::future<Reply> future = promise->get_future();
+    probe(address, timeoutMs, [promise](const Reply& reply) {
+        promise->set_value(reply);
+    });
+    return future.get();
+}
+
+size_t IcmpEngine::pendingProbes() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pending.size();
+}
+
+void IcmpEngine::ioLoop() {
+    while (ioRunning) {
+        struct epoll_event events[2];
+        int count = epoll_wait(epollFd, events, 2, nextTimeoutMs());
+        if (count < 0 && errno != EINTR) {
+            setLastError("Failed to poll ICMP socket: " + std::string(strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeFd) {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            if (events[i].events & EPOLLERR) {
+                receiveErrors();
+            }
+            if (events[i].events & EPOLLIN) {
+                receivePackets();
+            }
+        }
+
+        expireProbes(std::chrono::steady_clock::now());
+    }
+
+    failAllProbes("Engine closed");
+}
+
+void IcmpEngine::receivePackets() {
+    uint8_t buffer[1500];
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct timespec))];
+
+    // Drain every packet that arrived
+    while (true) {
+        struct sockaddr_in from{};
+        struct iovec iov{buffer, sizeof(buffer)};
+        struct msghdr message{};
+        message.msg_name = &from;
+        message.msg_namelen = sizeof(from);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(socketFd, &message, 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                setLastError("Failed to receive ICMP packet: " + std::string(strerror(errno)));
+            }
+            break;
+        }
+
+        int64_t receivedNs = 0;
+        bool kernelTimestamp = false;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                receivedNs = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+                kernelTimestamp = true;
+            }
+        }
+        if (!kernelTimestamp) {
+            receivedNs = realtimeNs();
+        }
+
+        // Raw sockets deliver the IP header too
+        const uint8_t* data = buffer;
+        size_t len = static_cast<size_t>(received);
+        if (type == SocketType::Raw) {
+            if (len < sizeof(iphdr)) continue;
+            size_t headerLen = reinterpret_cast<const iphdr*>(buffer)->ihl * 4u;
+            if (len < headerLen) continue;
+            data += headerLen;
+            len -= headerLen;
+        }
+        handleMessage(data, len, from.sin_addr.s_addr, receivedNs, kernelTimestamp);
+    }
+}
+
+void IcmpEngine::receiveErrors() {
+    uint8_t buffer[256];
+    alignas(struct cmsghdr) char control[512];
+
+    // Datagram sockets only: the queued packet is our echo request, the cmsg says what happened
+    while (true) {
+        struct sockaddr_in to{};
+        struct iovec iov{buffer, sizeof(buffer)};
+        struct msghdr message{};
+        message.msg_name = &to;
+        message.msg_namelen = sizeof(to);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(socketFd, &message, MSG_ERRQUEUE);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (static_cast<size_t>(received) < sizeof(icmphdr)) continue;
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level != IPPROTO_IP || cmsg->cmsg_type != IP_RECVERR) continue;
+            struct sock_extended_err extended;
+            memcpy(&extended, CMSG_DATA(cmsg), sizeof(extended));
+            if (extended.ee_origin != SO_EE_ORIGIN_ICMP) continue;
+
+            const auto* sent = reinterpret_cast<const icmphdr*>(buffer);
+            Reply reply;
+            reply.error = icmpErrorText(extended.ee_type, extended.ee_code);
+            complete(ntohs(sent->un.echo.sequence), to.sin_addr.s_addr, reply, 0);
+        }
+    }
+}
+
+void IcmpEngine::handleMessage(const uint8_t* data, size_t len, uint32_t from, int64_t receivedNs,
+                               bool kernelTimestamp) {
+    if (len < sizeof(icmphdr)) {
+        return;
+    }
+    const auto* header = reinterpret_cast<const icmphdr*>(data);
+
+    if (header->type == ICMP_ECHOREPLY) {
+        // Datagram sockets only deliver replies to our own identifier
+        if (type == SocketType::Raw && ntohs(header->un.echo.id) != identifier) {
+            return;
+        }
+        Reply reply;
+        reply.success = true;
+        reply.kernelTimestamp = kernelTimestamp;
+        complete(ntohs(header->un.echo.sequence), from, reply, receivedNs);
+        return;
+    }
+
+    // Raw sockets: errors quote the IP header and the first 8 bytes of our echo request
+    if (header->type != ICMP_DEST_UNREACH && header->type != ICMP_TIME_EXCEEDED) {
+        return;
+    }
+    const uint8_t* quoted = data + sizeof(icmphdr);
+    size_t quotedLen = len - sizeof(icmphdr);
+    if (quotedLen < sizeof(iphdr)) {
+        return;
+    }
+    const auto* ip = reinterpret_cast<const iphdr*>(quoted);
+    size_t ipLen = ip->ihl * 4u;
+    if (quotedLen < ipLen + sizeof(icmphdr)) {
+        return;
+    }
+    const auto* sent = reinterpret_cast<const icmphdr*>(quoted + ipLen);
+    if (sent->type != ICMP_ECHO || ntohs(sent->un.echo.id) != identifier) {
+        return;
+    }
+
+    Reply reply;
+    reply.error = icmpErrorText(header->type, header->code);
+    complete(ntohs(sent->un.echo.sequence), ip->daddr, reply, 0);
+}
+
+void IcmpEngine::complete(uint16_t sequence, uint32_t address, Reply reply, int64_t receivedNs) {
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pending.find(sequence);
+        if (it == pending.end() || it->second.address != address) {
+            // Late (already timed out), a duplicate, or someone else's
+            return;
+        }
+        if (reply.success) {
+            // The realtime clock can step between send and receive, never report a negative RTT
+            reply.rttUs = std::max<int64_t>(0, (receivedNs - it->second.sentRealtimeNs) / 1000);
+        }
+        callback = std::move(it->second.callback);
+        pending.erase(it);
+    }
+
+    reply.sequence = sequence;
+    if (callback) {
+        callback(reply);
+    }
+}
+
+void IcmpEngine::expireProbes(std::chrono::steady_clock::time_point now) {
+    std::vector<std::pair<uint16_t, Callback>> expired;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.deadline <= now) {
+                expired.emplace_back(it->first, std::move(it->second.callback));
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& entry : expired) {
+        Reply reply;
+        reply.sequence = entry.first;
+        reply.error = "Request timed out";
+        if (entry.second) entry.second(reply);
+    }
+}
+
+void IcmpEngine::failAllProbes(const std::string& message) {
+    std::map<uint16_t, PendingProbe> failed;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        failed.swap(pending);
+    }
+
+    for (auto& entry : failed) {
+        Reply reply;
+        reply.sequence = entry.first;
+        reply.error = message;
+        if (entry.second.callback) entry.second.callback(reply);
+    }
+}
+
+int IcmpEngine::nextTimeoutMs() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pending.empty()) {
+        return -1;
+    }
+
+    auto earliest = pending.begin()->second.deadline;
+    for (const auto& entry : pending) {
+        earliest = std::min(earliest, entry.second.deadline);
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        earliest - std::chrono::steady_clock::now()).count();
+    // Round up so the probe has expired by the time epoll returns
+    return remaining < 0 ? 0 : static_cast<int>(remaining) + 1;
+}
+
+void IcmpEngine::wakeIoThread() {
+    if (wakeFd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        setLastError("Failed to wake ICMP I/O thread: " + std::string(strerror(errno)));
+    }
+}
+
+void IcmpEngine::setLastError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    lastErrorMessage = error;
+}
+
+#else // !__linux__
+
+IcmpEngine::IcmpEngine() {
+}
+
+IcmpEngine::~IcmpEngine() {
+}
+
+std::shared_ptr<IcmpEngine> IcmpEngine::shared(std::string* error) {
+    if (error) *error = "ICMP sockets are only supported on Linux";
+    return nullptr;
+}
+
+bool IcmpEngine::open() {
+    setLastError("ICMP sockets are only supported on Linux");
+    return false;
+}
+
+void IcmpEngine::close() {
+}
+
+bool IcmpEngine::isOpen() const {
+    return false;
+}
+
+IcmpEngine::SocketType IcmpEngine::socketType() const {
+    return SocketType::None;
+}
+
+std::string IcmpEngine::lastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastErrorMessage;
+}
+
+bool IcmpEngine::resolve(const std::string&, in_addr&) {
+    return false;
+}
+
+uint16_t IcmpEngine::probe(const in_addr&, int, Callback callback) {
+    Reply reply;
+    reply.error = "ICMP engine not open";
+    if (callback) callback(reply);
+    return 0;
+}
+
+IcmpEngine::Reply IcmpEngine::probeSync(const in_addr&, int) {
+    Reply reply;
+    reply.error = "ICMP engine not open";
+    return reply;
+}
+
+size_t IcmpEngine::pendingProbes() {
+    return 0;
+}
+
+void IcmpEngine::setLastError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    lastErrorMessage = error;
+}
+
+#endif
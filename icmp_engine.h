@@ -0,0 +1,143 @@
+#ifndef ICMP_ENGINE_H
+#define ICMP_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+#else
+    #include <winsock2.h>
+#endif
+
+/**
+ * In-process ICMP echo engine
+ *
+ * Sends echo requests and matches the replies without starting a ping process. One socket and
+ * one I/O thread serve every host: probes are matched to replies by ICMP sequence number, so any
+ * number of them can be in flight at once.
+ *
+ * The socket is an unprivileged ICMP datagram socket when the kernel allows it
+ * (net.ipv4.ping_group_range covers our group), a raw socket otherwise, which needs CAP_NET_RAW
+ * (see grant-permissions.sh). Replies carry the kernel receive timestamp, so round trip times do
+ * not include the time the reply waited for the I/O thread.
+ *
+ * Linux only, open() fails elsewhere and callers fall back to the ping utility.
+ */
+class IcmpEngine {
+public:
+    enum class SocketType {
+        None,
+        Datagram,   // SOCK_DGRAM / IPPROTO_ICMP, the kernel sets the identifier and filters replies
+        Raw         // SOCK_RAW, sees every ICMP packet for the host
+    };
+
+    struct Reply {
+        bool success = false;
+        int64_t rttUs = -1;             // round trip in microseconds, -1 unless successful
+        bool kernelTimestamp = false;   // rttUs ends at the kernel receive timestamp
+        uint16_t sequence = 0;
+        std::string error;
+    };
+
+    using Callback = std::function<void(const Reply&)>;
+
+    IcmpEngine();
+    ~IcmpEngine();
+
+    IcmpEngine(const IcmpEngine&) = delete;
+    IcmpEngine& operator=(const IcmpEngine&) = delete;
+
+    /**
+     * The engine shared by everything in the process, opened on first use and closed when the
+     * last user lets go of it
+     * @param error Set to the reason when no ICMP socket can be opened (optional)
+     * @return The engine, empty if it cannot be opened
+     */
+    static std::shared_ptr<IcmpEngine> shared(std::string* error = nullptr);
+
+    /**
+     * Open the socket and start the I/O thread
+     * @return false if neither socket type is permitted
+     */
+    bool open();
+
+    /**
+     * Close the socket. Outstanding probes fail with "Engine closed". Must not be called from a
+     * completion callback.
+     */
+    void close();
+
+    bool isOpen() const;
+    SocketType socketType() const;
+    std::string lastError() const;
+
+    /**
+     * Resolve a host name or dotted IPv4 address
+     * @return false if the host cannot be resolved
+     */
+    static bool resolve(const std::string& host, in_addr& address);
+
+    /**
+     * Send one echo request. The callback runs exactly once, on the I/O thread for replies and
+     * timeouts, or on the calling thread if the probe cannot be sent. It must not block.
+     * @return sequence number of the probe, 0 if it could not be sent
+     */
+    uint16_t probe(const in_addr& address, int timeoutMs, Callback callback);
+
+    /**
+     * Send one echo request and wait for the reply or the timeout
+     */
+    Reply probeSync(const in_addr& address, int timeoutMs);
+
+    size_t pendingProbes();
+
+private:
+    struct PendingProbe {
+        Callback callback;
+        uint32_t address;                                // network byte order
+        int64_t sentRealtimeNs;                          // same clock as the kernel timestamps
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void ioLoop();
+    void receivePackets();
+    void receiveErrors();
+    // An ICMP message (without IP header) from `from`, network byte order
+    void handleMessage(const uint8_t* data, size_t len, uint32_t from, int64_t receivedNs, bool kernelTimestamp);
+    // Completes the probe if it was sent to `address`, replies from anywhere else are stray
+    void complete(uint16_t sequence, uint32_t address, Reply reply, int64_t receivedNs);
+    void expireProbes(std::chrono::steady_clock::time_point now);
+    void failAllProbes(const std::string& message);
+    int nextTimeoutMs();
+    void wakeIoThread();
+    void setLastError(const std::string& error);
+
+    int socketFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::atomic<SocketType> type{SocketType::None};
+    uint16_t identifier = 0;   // raw sockets only, datagram sockets get theirs from the kernel
+
+    // Outstanding probes by sequence number, guarded by pendingMutex
+    std::map<uint16_t, PendingProbe> pending;
+    uint16_t nextSequence = 1;
+    std::mutex pendingMutex;
+
+    std::thread ioThread;
+    std::atomic<bool> ioRunning{false};
+    std::mutex lifecycleMutex;
+
+    std::string lastErrorMessage;
+    mutable std::mutex errorMutex;
+};
+
+#endif // ICMP_ENGINE_H
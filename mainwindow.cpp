@@ -423,6 +423,14 @@ QDockWidget[floating="true"] {
             this, &MainWindow::onCameraError);
     connect(vr, &VideoReceiver::videoCharacteristicsUpdated,
             this, &MainWindow::setVideoCharacteristics);
+    connect(vr, &VideoReceiver::latencyUpdated,
+            this, &MainWindow::setVideoLatency);
+    connect(vr, &VideoReceiver::recordingStarted,
+            this, &MainWindow::onRecordingStarted);
+    connect(vr, &VideoReceiver::recordingStopped,
+            this, &MainWindow::onRecordingStopped);
+    connect(vr, &VideoReceiver::recordingError,
+            this, &MainWindow::onRecordingError);
 
     QTimer *cameraPoll = new QTimer(this);
     connect(cameraPoll, &QTimer::timeout, this, &MainWindow::refreshAllCameraStatus);
@@ -588,9 +596,11 @@ QDockWidget[floating="true"] {
     // thread->start();
 
     // // 2) expose a signal so we can tell the worker "new position!"
+    // //    Direct: setPosition() only fills the worker's latest-target mailbox, queuing would
+    // //    replay stale positions
     // connect(this, &MainWindow::servoPositionChanged,
     //         worker, &ServoWorker::setPosition,
-    //         Qt::QueuedConnection);
+    //         Qt::DirectConnection);
 
     // // 3) initialize value (if you like)
     // emit servoPositionChanged(_servoPosition);
@@ -1886,6 +1896,9 @@ void MainWindow::updateConfigDisplay()
     // Add video characteristics if available
     if (!videoCharacteristics.isEmpty() && cameraController && cameraController->isRunning()) {
         displayText += QString("\n---\n[Video Stream Analysis]\n%1").arg(videoCharacteristics);
+        if (!videoLatency.isEmpty()) {
+            displayText += QString("\n%1").arg(videoLatency);
+        }
     }
     
     // Show Servo config if present (legacy)
@@ -2019,6 +2032,17 @@ void MainWindow::setVideoCharacteristics(const QString& characteristics)
     }
 }
 
+void MainWindow::setVideoLatency(double receiverMs, double glassToGlassMs)
+{
+    videoLatency = QString("Receiver Latency: %1 ms").arg(receiverMs, 0, 'f', 1);
+    if (glassToGlassMs >= 0.) {
+        videoLatency += QString("\nGlass-to-Glass Latency: %1 ms").arg(glassToGlassMs, 0, 'f', 1);
+    }
+    if (showConfigOverlay) {
+        updateConfigDisplay();
+    }
+}
+
 
 void MainWindow::saveDefaultConfig() {
     // Default configuration values:
@@ -2217,8 +2241,18 @@ void MainWindow::onCameraError(const QString &message) {
     ui->lineEditCameraStatus->setText(message);
     ui->lineEditCameraStatus->setStyleSheet(
         "background-color: #ff4444; color: white;");
+    // The stream failing is often the first sign of a link going down, check it right away
+    if (pingWatcher) {
+        QString currentVideoSource = getCurrentVideoSource();
+        for (const QString& name : pingWatcher->hostNames()) {
+            if (name.toLower() == currentVideoSource) {
+                pingWatcher->probeNow(name);
+            }
+        }
+    }
     // Clear video characteristics when stream stops
     videoCharacteristics.clear();
+    videoLatency.clear();
     if (showConfigOverlay) {
         updateConfigDisplay();
     }
@@ -2345,76 +2379,50 @@ void MainWindow::refreshAllCameraStatus() {
     initializePingWatcher();
 }
 
-#include <signal.h>  // for SIGINT
-#include <unistd.h>  // for ::kill
-
 void MainWindow::on_RecordButton_clicked()
 {
+    auto *vr = videoWidget->getReceiver();
+
     // 0) if the camera isn’t active, warn and bail
-    if (auto *vr = videoWidget->getReceiver()) {
-        if (!vr->isPlaying()) {
-            QMessageBox::warning(
-                this,
-                tr("Recording unavailable"),
-                tr("The camera stream is not active.\nRecording is unavailable.")
-                );
-            return;
-        }
+    if (recordState == RecordState::Idle && (!vr || !vr->isPlaying())) {
+        QMessageBox::warning(
+            this,
+            tr("Recording unavailable"),
+            tr("The camera stream is not active.\nRecording is unavailable.")
+            );
+        return;
     }
 
-    // 1) Trim any stray newline
-    QString uri = rtspUri.trimmed();
-
     if (recordState == RecordState::Idle) {
         // ── START RECORDING ──
 
-        // 2) prepare path
+        // 1) prepare path
         QString dir = QDir::homePath() + "/Hexa5CameraRecordedVideos";
         QDir().mkpath(dir);
         QString fn = QDateTime::currentDateTime()
                          .toString("yyyyMMdd_hhmmss") + ".mp4";
         lastRecordPath = dir + "/" + fn;
 
-        // 3) launch ffmpeg
-        QStringList args = {
-            "-rtsp_transport", "tcp",
-            "-i",              uri,
-            "-c",              "copy",
-            "-y",
-            lastRecordPath
-        };
-        qDebug() << "[Record] will run: ffmpeg" << args;
-
-        delete recordProcess;
-        recordProcess = new QProcess(this);
-        recordProcess->setProcessChannelMode(QProcess::MergedChannels);
-        connect(recordProcess, &QProcess::readyReadStandardError, [this]() {
-            auto err = recordProcess->readAllStandardError();
-            qDebug() << "[ffmpeg]" << err.trimmed();
-        });
-        recordProcess->start("ffmpeg", args);
-
-        // 4) wait up to 2 s for it to actually start
-        if (!recordProcess->waitForStarted(2000) ||
-            recordProcess->state() != QProcess::Running)
-        {
+        // 2) tap the stream we are already receiving, the file starts with the receiver's
+        //    pre-roll (or at the next keyframe without one), the REC clock counts it too
+        qDebug() << "[Record] recording to" << lastRecordPath;
+        recordOffsetMs = vr->recordingPrerollMs();
+        if (!vr->startRecording(lastRecordPath)) {
             QMessageBox::warning(
                 this,
                 tr("Recording"),
-                tr("Could not start ffmpeg — check your URI and network.")
+                tr("Could not start recording — no H.264/H.265 video received yet.")
                 );
-            delete recordProcess;
-            recordProcess = nullptr;
             return;
         }
 
-        // 5) update UI
+        // 3) update UI
         recordOverlay->setFixedWidth(videoWidget->width());
         recordOverlay->move(0, 0);
         recordState = RecordState::Recording;
         ui->RecordButton->setText(tr("Stop Recording"));
         recordClock.start();
-        recordOverlay->setText(tr("● REC   00:00"));
+        updateRecordTime();
         recordOverlay->show();
         recordUiTimer->start();
         statusBar()->showMessage(tr("🔴 Recording started"), 2000);
@@ -2422,38 +2430,53 @@ void MainWindow::on_RecordButton_clicked()
     } else {
         // ── STOP RECORDING ──
 
-        recordUiTimer->stop();
+        // The receiver finishes the file in the background, onRecordingStopped reports it
+        if (vr) vr->stopRecording();
+        resetRecordUi();
+        statusBar()->showMessage(tr("Finishing recording…"), 2000);
+    }
+}
 
-        if (recordProcess) {
-            // ask ffmpeg to finish cleanly (SIGINT == Ctrl+C)
-            qint64 pid = recordProcess->processId();
-            if (pid > 0) ::kill(pid, SIGINT);
+void MainWindow::resetRecordUi()
+{
+    recordUiTimer->stop();
+    recordOverlay->hide();
+    recordState = RecordState::Idle;
+    ui->RecordButton->setText(tr("Start Recording"));
+}
 
-            // give it up to 5 s to write the trailer
-            if (!recordProcess->waitForFinished(5000)) {
-                recordProcess->kill();
-                recordProcess->waitForFinished();
-            }
+void MainWindow::onRecordingStarted(const QString &path)
+{
+    Q_UNUSED(path);
+    // The first keyframe is in the file, count from here plus the pre-roll before it
+    recordClock.start();
+}
 
-            delete recordProcess;
-            recordProcess = nullptr;
-        }
+void MainWindow::onRecordingStopped(const QString &path)
+{
+    // Also ends when the stream is stopped or switched
+    if (recordState == RecordState::Recording && path == lastRecordPath) {
+        resetRecordUi();
+    }
+    statusBar()->showMessage(
+        tr("Recording saved to:\n%1").arg(path),
+        5000
+        );
+}
 
-        // restore UI
-        recordOverlay->hide();
-        recordState = RecordState::Idle;
-        ui->RecordButton->setText(tr("Start Recording"));
-        statusBar()->showMessage(
-            tr("Recording saved to:\n%1").arg(lastRecordPath),
-            5000
-            );
+void MainWindow::onRecordingError(const QString &message)
+{
+    qWarning() << "[Record] recording failed:" << message;
+    if (recordState == RecordState::Recording) {
+        resetRecordUi();
     }
+    statusBar()->showMessage(tr("Recording failed: %1").arg(message), 5000);
 }
 
 
 void MainWindow::updateRecordTime()
 {
-    int total = recordClock.elapsed() / 1000;
+    int total = int((recordClock.elapsed() + recordOffsetMs) / 1000);
     int m = (total / 60) % 60;
     int s = total % 60;
     recordOverlay->setText(
@@ -2499,21 +2522,31 @@ void MainWindow::on_ScreenshotButton_clicked()
                      .toString("yyyyMMdd_hhmmss") + ".png";
     QString fullPath = dir + "/" + fn;
 
-    // 2) grab the X11 window that xvimagesink is drawing into
-    QScreen *screen = QGuiApplication::primaryScreen();
-    if (!screen) {
-        statusBar()->showMessage("📸 No screen available!", 3000);
-        return;
-    }
+    // 2) take the decoded frame from the receiver's frame tap, full stream resolution and
+    //    no window grab; fall back to the X11 window xvimagesink is drawing into
+    QImage frame = videoWidget->getReceiver() ? videoWidget->getReceiver()->grabFrame() : QImage();
+    if (!frame.isNull()) {
+        // 3) save to disk
+        if (!frame.save(fullPath, "PNG")) {
+            statusBar()->showMessage("📸 Screenshot failed!", 3000);
+            return;
+        }
+    } else {
+        QScreen *screen = QGuiApplication::primaryScreen();
+        if (!screen) {
+            statusBar()->showMessage("📸 No screen available!", 3000);
+            return;
+        }
 
-    // videoWidget is your VideoRecorderWidget* embedded in the UI
-    WId videoXid = this->videoWidget->winId();
-    QPixmap pix = screen->grabWindow(videoXid);
+        // videoWidget is your VideoRecorderWidget* embedded in the UI
+        WId videoXid = this->videoWidget->winId();
+        QPixmap pix = screen->grabWindow(videoXid);
 
-    // 3) save to disk
-    if (!pix.save(fullPath, "PNG")) {
-        statusBar()->showMessage("📸 Screenshot failed!", 3000);
-        return;
+        // 3) save to disk
+        if (!pix.save(fullPath, "PNG")) {
+            statusBar()->showMessage("📸 Screenshot failed!", 3000);
+            return;
+        }
     }
 
     // 4) feedback
@@ -2877,9 +2910,11 @@ void MainWindow::initializePingWatcher() {
     // Create new ping watcher
     pingWatcher = new ContinuousPingWatcher(this);
     
-    // Configure ping settings
-    pingWatcher->setPingInterval(3000); // Ping every 3 seconds
-    pingWatcher->setTimeout(1000);      // 1 second timeout per ping
+    // Configure ping settings: every second, backing off to 4 s on a stable link and down to
+    // 200 ms right after a lost ping
+    pingWatcher->setPingInterval(1000);
+    pingWatcher->setAdaptiveIntervals(200, 4000);
+    pingWatcher->setTimeout(1000);      // 1 second timeout per ping, less once RTTs are known
     
     // Connect signals
     connect(pingWatcher, &ContinuousPingWatcher::hostStatusChanged,
@@ -2979,19 +3014,23 @@ void MainWindow::onConnectivityScoreUpdated(const QString& name, const HostConne
     QString tooltip = QString("Host: %1 (%2)\n"
                              "Status: %3\n"
                              "Overall Score: %4/100\n"
-                             "Reliability: %5% (%6/%7 pings)\n"
-                             "Performance: %8% (Avg RTT: %9ms)\n"
-                             "Stability: %10% (%11 consecutive %12)\n"
-                             "Last seen: %13")
+                             "Reliability: %5% (%6/%7 recent pings, %8 total)\n"
+                             "Performance: %9% (RTT avg %10 / p50 %11 / p95 %12 ms, jitter %13 ms)\n"
+                             "Stability: %14% (%15 consecutive %16)\n"
+                             "Last seen: %17")
                     .arg(score.hostName)
                     .arg(score.hostAddress)
                     .arg(score.isReachable ? "Reachable" : "Unreachable")
                     .arg(score.overallScore)
                     .arg(score.reliabilityScore)
-                    .arg(score.successfulPings)
+                    .arg(score.windowPings - score.windowLost)
+                    .arg(score.windowPings)
                     .arg(score.totalPings)
                     .arg(score.performanceScore)
-                    .arg(score.averageRtt)
+                    .arg(score.windowMeanRttMs, 0, 'f', 2)
+                    .arg(score.windowRttPercentileMs(50), 0, 'f', 2)
+                    .arg(score.windowRttPercentileMs(95), 0, 'f', 2)
+                    .arg(score.jitterMs, 0, 'f', 2)
                     .arg(score.stabilityScore)
                     .arg(score.isReachable ? score.consecutiveSuccesses : score.consecutiveFailures)
                     .arg(score.isReachable ? "successes" : "failures")
@@ -3180,15 +3219,18 @@ void MainWindow::updateConnectivityDisplay() {
         tooltip += QString("\n%1 (%2):\n"
                           "  Status: %3\n"
                           "  Score: %4%\n"
-                          "  Success Rate: %5%\n"
-                          "  Avg RTT: %6ms\n"
-                          "  Total Pings: %7")
+                          "  Success Rate: %5% (last %6 pings)\n"
+                          "  RTT: avg %7ms, p95 %8ms, jitter %9ms\n"
+                          "  Total Pings: %10")
                    .arg(cameraType)
                    .arg(cameraIp)
                    .arg(statusDetail)
                    .arg(score.overallScore)
                    .arg(score.reliabilityScore)
-                   .arg(score.averageRtt)
+                   .arg(score.windowPings)
+                   .arg(score.windowMeanRttMs, 0, 'f', 1)
+                   .arg(score.windowRttPercentileMs(95), 0, 'f', 1)
+                   .arg(score.jitterMs, 0, 'f', 1)
                    .arg(score.totalPings);
     }
     
@@ -81,6 +81,9 @@ private slots:
     void on_RecordButton_clicked();
     void updateRecordTime();
     void onRecordingFinished(int exitCode, QProcess::ExitStatus status);
+    void onRecordingStarted(const QString &path);
+    void onRecordingStopped(const QString &path);
+    void onRecordingError(const QString &message);
     void on_ScreenshotButton_clicked();
     void onFullUp();
     void onFullDown();
@@ -107,6 +110,7 @@ private slots:
     void updateConfigDisplay();
     void onShowConfigToggled(bool enabled);
     void setVideoCharacteristics(const QString& characteristics);
+    void setVideoLatency(double receiverMs, double glassToGlassMs);
 
 
 signals:
@@ -174,8 +178,9 @@ private:
 
     enum class RecordState { Idle, Recording };
     RecordState recordState{RecordState::Idle};
-    QProcess*   recordProcess = nullptr;
+    void resetRecordUi();
     QElapsedTimer       recordClock;
+    qint64      recordOffsetMs = 0;     // pre-roll in front of the button press
     QTimer*     recordUiTimer = nullptr;
     QLabel*     recordOverlay = nullptr;
     QString     lastRecordPath;
@@ -212,6 +217,7 @@ private:
     
     // Video characteristics from stream analysis
     QString videoCharacteristics;
+    QString videoLatency;
 
     // Right panel hover expansion
     QTimer* m_hoverTimer = nullptr;
@@ -1,4 +1,5 @@
 #include "ping.h"
+#include "icmp_engine.h"
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QDebug>
 #include <QtCore/QProcess>
@@ -8,10 +9,17 @@
 #include <QtCore/QThread>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
-#include <QtNetwork/QHostAddress>
-#include <QtNetwork/QHostInfo>
+#include <algorithm>
+#include <future>
+#include <vector>
 
 Ping::Ping(QObject *parent) : QObject(parent) {
+    // One ICMP socket for the whole process, shared by every Ping
+    std::string error;
+    engine = IcmpEngine::shared(&error);
+    if (!engine) {
+        qWarning() << "[PING] No ICMP socket, falling back to the ping utility:" << QString::fromStdString(error);
+    }
 }
 
 Ping::~Ping() {
@@ -22,6 +30,59 @@ Ping::PingResult Ping::pingHost(const QString& host, int timeoutMs) {
 }
 
 Ping::PingResult Ping::pingHostWithStats(const QString& host, int count, int timeoutMs) {
+    if (engine) {
+        return pingHostWithEngine(host, count, timeoutMs);
+    }
+    return pingHostWithProcess(host, count, timeoutMs);
+}
+
+Ping::PingResult Ping::pingHostWithEngine(const QString& host, int count, int timeoutMs) {
+    in_addr address;
+    if (!IcmpEngine::resolve(host.toStdString(), address)) {
+        return PingResult(false, -1, "Unknown host " + host);
+    }
+    
+    // All echo requests go out at once and share the timeout
+    std::vector<std::future<IcmpEngine::Reply>> replies;
+    for (int i = 0; i < count; ++i) {
+        auto promise = std::make_shared<std::promise<IcmpEngine::Reply>>();
+        replies.push_back(promise->get_future());
+        engine->probe(address, timeoutMs, [promise](const IcmpEngine::Reply& reply) {
+            promise->set_value(reply);
+        });
+    }
+    
+    PingResult result;
+    result.packetsTransmitted = count;
+    qint64 minUs = -1, maxUs = 0, sumUs = 0;
+    for (auto& future : replies) {
+        IcmpEngine::Reply reply = future.get();
+        if (!reply.success) {
+            result.errorMessage = QString::fromStdString(reply.error);
+            continue;
+        }
+        result.packetsReceived++;
+        sumUs += reply.rttUs;
+        minUs = minUs < 0 ? reply.rttUs : std::min<qint64>(minUs, reply.rttUs);
+        maxUs = std::max<qint64>(maxUs, reply.rttUs);
+    }
+    
+    result.packetLoss = count > 0 ? 100.0 * (count - result.packetsReceived) / count : 100.0;
+    result.success = result.packetsReceived > 0;
+    if (result.success) {
+        result.errorMessage.clear();
+        result.roundTripTimeUs = sumUs / result.packetsReceived;
+        result.roundTripTime = static_cast<int>(result.roundTripTimeUs / 1000);
+        result.statistics = QStringLiteral("%1 packets transmitted, %2 received, %3% packet loss\n"
+                                           "rtt min/avg/max = %4/%5/%6 ms")
+                                .arg(count).arg(result.packetsReceived).arg(result.packetLoss, 0, 'f', 0)
+                                .arg(minUs / 1000.0, 0, 'f', 3).arg(result.roundTripTimeUs / 1000.0, 0, 'f', 3)
+                                .arg(maxUs / 1000.0, 0, 'f', 3);
+    }
+    return result;
+}
+
+Ping::PingResult Ping::pingHostWithProcess(const QString& host, int count, int timeoutMs) {
     QProcess pingProcess;
     QStringList arguments;
     
@@ -200,17 +261,52 @@ void PingWorker::pingHost(const QString& host, int timeoutMs, int requestId) {
 }
 
 // ContinuousPingWatcher implementation
+struct ContinuousPingWatcher::ProbeSink {
+    QMutex mutex;
+    ContinuousPingWatcher* watcher = nullptr;  // cleared by the watcher's destructor
+
+    void deliver(int requestId, bool success, qint64 roundTripTimeUs, const QString& error) {
+        QMutexLocker locker(&mutex);
+        if (!watcher) {
+            return;
+        }
+        // Queued to the watcher's thread, Qt drops it if the watcher is deleted before it runs
+        ContinuousPingWatcher* target = watcher;
+        QMetaObject::invokeMethod(target, [target, requestId, success, roundTripTimeUs, error]() {
+            target->onPingResult(requestId, success, roundTripTimeUs, error);
+        }, Qt::QueuedConnection);
+    }
+};
+
 ContinuousPingWatcher::ContinuousPingWatcher(QObject *parent)
-    : QObject(parent), pingTimer(new QTimer(this)), workerThread(new QThread(this)),
-      pingWorker(nullptr), pingInterval(3000), pingTimeout(1000), watching(false), nextRequestId(0) {
-    
+    : QObject(parent), pingTimer(new QTimer(this)), workerThread(nullptr),
+      pingWorker(nullptr), sink(std::make_shared<ProbeSink>()), pingInterval(3000), fastInterval(250),
+      maxInterval(3000), pingTimeout(1000), watching(false), nextRequestId(0) {
+    
+    sink->watcher = this;
+    clock.start();
+    // Armed for whichever host is due next, see scheduleNextProbe()
+    pingTimer->setSingleShot(true);
     connect(pingTimer, &QTimer::timeout, this, &ContinuousPingWatcher::performPingCycle);
     
-    // Set up worker thread
+    // Every host is probed at once on the shared ICMP socket, no thread of our own needed
+    std::string error;
+    engine = IcmpEngine::shared(&error);
+    if (engine) {
+        return;
+    }
+    
+    // Without an ICMP socket, run the ping utility on a worker thread
+    qWarning() << "[PING_WATCHER] No ICMP socket, pinging one host at a time with the ping utility:"
+               << QString::fromStdString(error);
+    workerThread = new QThread(this);
     pingWorker = new PingWorker();
     pingWorker->moveToThread(workerThread);
     
-    connect(pingWorker, &PingWorker::pingResult, this, &ContinuousPingWatcher::onPingResult);
+    connect(pingWorker, &PingWorker::pingResult, this,
+            [this](int requestId, const QString&, bool success, int roundTripTime, const QString& error) {
+        onPingResult(requestId, success, roundTripTime >= 0 ? qint64(roundTripTime) * 1000 : -1, error);
+    });
     connect(workerThread, &QThread::started, []() {
         qDebug() << "[PING_WATCHER] Worker thread started";
     });
@@ -221,36 +317,46 @@ ContinuousPingWatcher::ContinuousPingWatcher(QObject *parent)
 ContinuousPingWatcher::~ContinuousPingWatcher() {
     stopWatching();
     
+    // Probes still in flight complete into the sink and are dropped there
+    {
+        QMutexLocker locker(&sink->mutex);
+        sink->watcher = nullptr;
+    }
+    
     if (pingWorker) {
         pingWorker->deleteLater();
         pingWorker = nullptr;
     }
     
-    workerThread->quit();
-    workerThread->wait(5000);
+    if (workerThread) {
+        workerThread->quit();
+        workerThread->wait(5000);
+    }
 }
 
 void ContinuousPingWatcher::addHost(const QString& name, const QString& host) {
     QMutexLocker locker(&hostsMutex);
     
     if (hosts.contains(name)) {
-        // Update existing host
-        hosts[name].host = host;
-        hosts[name].score.reset();
-        hosts[name].lastStatus = false;
-        hosts[name].lastRtt = -1;
-        hosts[name].pendingRequestId = -1;
-    } else {
-        // Add new host
-        HostInfo hostInfo;
-        hostInfo.name = name;
+        // Update existing host, a probe still in flight no longer matches and is dropped
+        HostInfo& hostInfo = hosts[name];
         hostInfo.host = host;
         hostInfo.score.reset();
         hostInfo.lastStatus = false;
         hostInfo.lastRtt = -1;
         hostInfo.pendingRequestId = -1;
+        hostInfo.intervalMs = pingInterval;
+        hostInfo.nextProbeMs = clock.elapsed();
+        resolveHost(hostInfo);
+    } else {
+        // Add new host, probed right away
+        HostInfo hostInfo(name, host);
+        hostInfo.intervalMs = pingInterval;
+        hostInfo.nextProbeMs = clock.elapsed();
+        resolveHost(hostInfo);
         hosts[name] = hostInfo;
     }
+    scheduleNextProbe();
     
     LOG_PING_WATCHER() << "Added host" << name << "at" << host;
 }
@@ -263,12 +369,29 @@ void ContinuousPingWatcher::removeHost(const QString& name) {
     }
 }
 
+QStringList ContinuousPingWatcher::hostNames() const {
+    QMutexLocker locker(&hostsMutex);
+    return hosts.keys();
+}
+
 void ContinuousPingWatcher::setPingInterval(int intervalMs) {
+    QMutexLocker locker(&hostsMutex);
     pingInterval = intervalMs;
     
-    if (watching) {
-        pingTimer->start(pingInterval);
+    // Hosts probed at the old base interval move to the new one
+    qint64 now = clock.elapsed();
+    for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+        HostInfo& hostInfo = it.value();
+        hostInfo.intervalMs = pingInterval;
+        hostInfo.nextProbeMs = qMin(hostInfo.nextProbeMs, now + pingInterval);
     }
+    scheduleNextProbe();
+}
+
+void ContinuousPingWatcher::setAdaptiveIntervals(int fastIntervalMs, int maxIntervalMs) {
+    QMutexLocker locker(&hostsMutex);
+    fastInterval = fastIntervalMs;
+    maxInterval = maxIntervalMs;
 }
 
 void ContinuousPingWatcher::setTimeout(int timeoutMs) {
@@ -281,10 +404,22 @@ void ContinuousPingWatcher::startWatching() {
     }
     
     watching = true;
-    pingTimer->start(pingInterval);
-    qDebug() << "[PING_WATCHER] Started continuous monitoring in background thread";
-    qDebug() << "[PING_WATCHER] Main thread ID:" << QThread::currentThreadId();
-    qDebug() << "[PING_WATCHER] Worker thread ID:" << workerThread->thread();
+    {
+        // Every host is probed right away, then on its own schedule
+        QMutexLocker locker(&hostsMutex);
+        qint64 now = clock.elapsed();
+        for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+            it.value().nextProbeMs = now;
+        }
+        scheduleNextProbe();
+    }
+    if (engine) {
+        qDebug() << "[PING_WATCHER] Started continuous monitoring, all hosts probed concurrently";
+    } else {
+        qDebug() << "[PING_WATCHER] Started continuous monitoring in background thread";
+        qDebug() << "[PING_WATCHER] Main thread ID:" << QThread::currentThreadId();
+        qDebug() << "[PING_WATCHER] Worker thread ID:" << workerThread->thread();
+    }
 }
 
 void ContinuousPingWatcher::stopWatching() {
@@ -298,68 +433,195 @@ void ContinuousPingWatcher::stopWatching() {
 }
 
 HostConnectivityScore ContinuousPingWatcher::getConnectivityScore(const QString& name) const {
-    if (hosts.contains(name)) {
-        return hosts[name].score;
+    QMutexLocker locker(&hostsMutex);
+    auto it = hosts.constFind(name);
+    if (it != hosts.cend()) {
+        return it->score;
     }
     return HostConnectivityScore(); // Return empty score if host not found
 }
 
+bool ContinuousPingWatcher::resolveHost(HostInfo& hostInfo) {
+    in_addr address;
+    hostInfo.resolved = IcmpEngine::resolve(hostInfo.host.toStdString(), address);
+    hostInfo.address = hostInfo.resolved ? address.s_addr : 0;
+    return hostInfo.resolved;
+}
+
+void ContinuousPingWatcher::probeNow(const QString& name) {
+    // Stopped means stopped, also for callers such as a stream error
+    if (!watching) {
+        return;
+    }
+    {
+        QMutexLocker locker(&hostsMutex);
+        auto it = hosts.find(name);
+        if (it == hosts.end()) {
+            return;
+        }
+        // A probe already in flight answers soon enough, the fast interval follows it
+        it.value().intervalMs = fastInterval;
+        it.value().nextProbeMs = clock.elapsed();
+    }
+    performPingCycle();
+}
+
+void ContinuousPingWatcher::probeAllNow() {
+    if (!watching) {
+        return;
+    }
+    {
+        QMutexLocker locker(&hostsMutex);
+        qint64 now = clock.elapsed();
+        for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+            it.value().intervalMs = fastInterval;
+            it.value().nextProbeMs = now;
+        }
+    }
+    performPingCycle();
+}
+
 void ContinuousPingWatcher::performPingCycle() {
-    // Queue all pings to be executed in the worker thread
+    if (!watching) {
+        return;
+    }
+    QMutexLocker locker(&hostsMutex);
+    
+    // Every due host goes out at once and answers (or times out) on its own, so hosts that are
+    // down never hold up the others
+    qint64 now = clock.elapsed();
     for (auto it = hosts.begin(); it != hosts.end(); ++it) {
-        QString hostName = it.key();
-        QString hostAddress = it.value().host;
+        HostInfo& hostInfo = it.value();
+        if (hostInfo.pendingRequestId >= 0 || hostInfo.nextProbeMs > now) {
+            continue;
+        }
+        
         int requestId = ++nextRequestId;
+        hostInfo.pendingRequestId = requestId;
+        pendingRequests.insert(requestId, hostInfo.name);
+        startProbe(hostInfo, requestId);
         
-        // Update pending request ID
-        {
-            QMutexLocker locker(&hostsMutex);
-            if (hosts.contains(hostName)) {
-                hosts[hostName].pendingRequestId = requestId;
-            }
+        LOG_PING_WATCHER() << "Sent ping for" << hostInfo.name << "with ID" << requestId
+                           << "interval" << hostInfo.intervalMs << "ms";
+    }
+    scheduleNextProbe();
+}
+
+void ContinuousPingWatcher::scheduleNextProbe() {
+    if (!watching) {
+        return;
+    }
+    
+    // Hosts with a probe in flight are rescheduled by its result
+    qint64 next = -1;
+    for (auto it = hosts.cbegin(); it != hosts.cend(); ++it) {
+        if (it->pendingRequestId < 0 && (next < 0 || it->nextProbeMs < next)) {
+            next = it->nextProbeMs;
         }
-        
+    }
+    if (next < 0) {
+        pingTimer->stop();
+        return;
+    }
+    pingTimer->start(static_cast<int>(qMax<qint64>(0, next - clock.elapsed())));
+}
+
+void ContinuousPingWatcher::adaptInterval(HostInfo& hostInfo, bool success) const {
+    const HostConnectivityScore& score = hostInfo.score;
+    if (success) {
+        // Stable links back off step by step, anything less is probed at the base interval
+        hostInfo.intervalMs = score.consecutiveSuccesses >= STABLE_SUCCESSES
+                              ? qMin(qMax(hostInfo.intervalMs, pingInterval) * 2, qMax(maxInterval, pingInterval))
+                              : pingInterval;
+    } else {
+        // Confirm or dismiss a loss quickly, then watch a host that is down for its return
+        hostInfo.intervalMs = score.consecutiveFailures < DOWN_FAILURES ? fastInterval : pingInterval;
+    }
+}
+
+int ContinuousPingWatcher::probeTimeout(const HostInfo& hostInfo) const {
+    // Once the host has answered a few times, a reply later than 4x its p95 RTT is a loss
+    const HostConnectivityScore& score = hostInfo.score;
+    double p95 = score.windowRttPercentileMs(95);
+    if (score.windowPings - score.windowLost < STABLE_SUCCESSES || p95 < 0) {
+        return pingTimeout;
+    }
+    return qBound(qMin(MIN_PROBE_TIMEOUT_MS, pingTimeout), static_cast<int>(p95 * 4.0), pingTimeout);
+}
+
+void ContinuousPingWatcher::startProbe(HostInfo& hostInfo, int requestId) {
+    if (!engine) {
         // Queue ping in worker thread
         QMetaObject::invokeMethod(pingWorker, "pingHost", Qt::QueuedConnection,
-                                  Q_ARG(QString, hostAddress),
-                                  Q_ARG(int, pingTimeout),
+                                  Q_ARG(QString, hostInfo.host),
+                                  Q_ARG(int, probeTimeout(hostInfo)),
                                   Q_ARG(int, requestId));
-        
-        qDebug() << "[PING_WATCHER] Queued ping for" << hostName << "with ID" << requestId;
+        return;
     }
+    
+    // Host names that did not resolve when added may have since
+    if (!hostInfo.resolved && !resolveHost(hostInfo)) {
+        sink->deliver(requestId, false, -1, "Unknown host " + hostInfo.host);
+        return;
+    }
+    
+    in_addr address;
+    address.s_addr = hostInfo.address;
+    std::shared_ptr<ProbeSink> target = sink;
+    engine->probe(address, probeTimeout(hostInfo), [target, requestId](const IcmpEngine::Reply& reply) {
+        target->deliver(requestId, reply.success, reply.rttUs, QString::fromStdString(reply.error));
+    });
 }
 
-void ContinuousPingWatcher::onPingResult(int requestId, const QString& host, bool success, int roundTripTime, const QString& error) {
-    QMutexLocker locker(&hostsMutex);
-    
-    // Find the host with matching request ID
-    for (auto it = hosts.begin(); it != hosts.end(); ++it) {
-        HostInfo& hostInfo = it.value();
+void ContinuousPingWatcher::onPingResult(int requestId, bool success, qint64 roundTripTimeUs, const QString& error) {
+    QString name;
+    int roundTripTime = success && roundTripTimeUs >= 0 ? static_cast<int>(roundTripTimeUs / 1000) : -1;
+    bool statusChanged = false;
+    HostConnectivityScore score;
+    {
+        QMutexLocker locker(&hostsMutex);
         
-        if (hostInfo.pendingRequestId == requestId) {
-            bool statusChanged = (hostInfo.lastStatus != success);
-            hostInfo.lastStatus = success;
-            hostInfo.lastRtt = roundTripTime;
-            hostInfo.pendingRequestId = -1; // Clear pending request
-            
-            // Update connectivity score
-            hostInfo.score.updatePing(success, roundTripTime, error);
-            
-            // Emit signals
-            emit hostStatusChanged(hostInfo.name, success, roundTripTime);
-            
-            if (statusChanged) {
-                qDebug() << "[PING_WATCHER]" << hostInfo.name << "camera status:" 
-                         << (success ? "REACHABLE" : "UNREACHABLE") << "RTT:" << roundTripTime << "ms";
-                emit hostError(hostInfo.name, success ? "" : "Host unreachable");
-            }
-            
-            emit connectivityScoreUpdated(hostInfo.name, hostInfo.score);
-            
-            qDebug() << "[PING_WATCHER] Ping result for" << hostInfo.name << ":" 
-                     << (success ? "SUCCESS" : "FAILED") << "ID:" << requestId
-                     << "Score:" << hostInfo.score.overallScore;
-            break;
+        // Results for hosts that were removed or re-added since the probe went out are dropped
+        auto pendingIt = pendingRequests.find(requestId);
+        if (pendingIt == pendingRequests.end()) {
+            return;
         }
+        name = pendingIt.value();
+        pendingRequests.erase(pendingIt);
+        
+        auto hostIt = hosts.find(name);
+        if (hostIt == hosts.end() || hostIt.value().pendingRequestId != requestId) {
+            return;
+        }
+        HostInfo& hostInfo = hostIt.value();
+        
+        statusChanged = (hostInfo.lastStatus != success);
+        hostInfo.lastStatus = success;
+        hostInfo.lastRtt = roundTripTime;
+        hostInfo.pendingRequestId = -1; // Clear pending request
+        
+        // Update connectivity score
+        hostInfo.score.updatePing(success, roundTripTime, error, success ? roundTripTimeUs : -1);
+        score = hostInfo.score;
+        
+        // Next probe one interval after this result, not after the send
+        adaptInterval(hostInfo, success);
+        hostInfo.nextProbeMs = clock.elapsed() + hostInfo.intervalMs;
+        scheduleNextProbe();
+        
+        qDebug() << "[PING_WATCHER] Ping result for" << name << ":" 
+                 << (success ? "SUCCESS" : "FAILED") << "ID:" << requestId
+                 << "Score:" << score.overallScore << "Next in:" << hostInfo.intervalMs << "ms";
     }
+    
+    // Emit signals without the lock, slots call back into getConnectivityScore()
+    emit hostStatusChanged(name, success, roundTripTime);
+    
+    if (statusChanged) {
+        qDebug() << "[PING_WATCHER]" << name << "camera status:" 
+                 << (success ? "REACHABLE" : "UNREACHABLE") << "RTT:" << roundTripTime << "ms";
+        emit hostError(name, success ? "" : "Host unreachable");
+    }
+    
+    emit connectivityScoreUpdated(name, score);
 }
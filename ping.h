@@ -8,11 +8,19 @@
 #include <QtCore/QThread>
 #include <QtCore/QMutex>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QDateTime>
 #include <QtCore/QtGlobal>
 #include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
 #include <memory>
 #include <climits>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+class IcmpEngine;
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -42,6 +50,9 @@ struct PingResult {
 };
 
 struct HostConnectivityScore {
+    // Probes the windowed statistics (and the scores) are computed over
+    static constexpr int WINDOW_SIZE = 32;
+
     QString hostName;
     QString hostAddress;
     
@@ -50,17 +61,24 @@ struct HostConnectivityScore {
     int currentRtt;
     QString lastError;
     
-    // Historical data for scoring
+    // Lifetime counters
     int totalPings;
     int successfulPings;
     int consecutiveFailures;
     int consecutiveSuccesses;
-    int averageRtt;
+    int averageRtt;          // windowed mean, rounded to milliseconds
     int minRtt;
     int maxRtt;
     qint64 lastSeen;
     qint64 firstSeen;
     
+    // Recent link quality over the last WINDOW_SIZE probes
+    int windowPings;         // probes in the window, up to WINDOW_SIZE
+    int windowLost;
+    double windowLossPercent;
+    double windowMeanRttMs;  // successful probes only, -1 if none
+    double jitterMs;         // RFC 3550 interarrival jitter of the round trip times
+    
     // Calculated scores (0-100)
     int reliabilityScore;    // Based on success rate
     int performanceScore;    // Based on RTT consistency
@@ -84,13 +102,23 @@ struct HostConnectivityScore {
         maxRtt = 0;
         lastSeen = 0;
         firstSeen = 0;
+        windowPings = 0;
+        windowLost = 0;
+        windowLossPercent = 0.0;
+        windowMeanRttMs = -1.0;
+        jitterMs = 0.0;
+        windowHead = 0;
+        windowRttSumUs = 0;
+        jitterUs = 0.0;
+        lastRttUs = -1;
         reliabilityScore = 0;
         performanceScore = 0;
         stabilityScore = 0;
         overallScore = 0;
     }
     
-    void updatePing(bool success, int rtt, const QString& error = QString()) {
+    // rttUs refines rtt (milliseconds) when the prober measures microseconds
+    void updatePing(bool success, int rtt, const QString& error = QString(), qint64 rttUs = -1) {
         qint64 now = QDateTime::currentMSecsSinceEpoch();
         
         if (firstSeen == 0) {
@@ -113,44 +141,104 @@ struct HostConnectivityScore {
                 if (minRtt == INT_MAX) minRtt = rtt;
                 if (rtt < minRtt) minRtt = rtt;
                 if (rtt > maxRtt) maxRtt = rtt;
-                
-                // Calculate running average
-                averageRtt = ((averageRtt * (successfulPings - 1)) + rtt) / successfulPings;
             }
         } else {
             consecutiveFailures++;
             consecutiveSuccesses = 0;
         }
         
+        if (rttUs < 0 && rtt >= 0) {
+            rttUs = qint64(rtt) * 1000;
+        }
+        addToWindow(success && rttUs >= 0 ? rttUs : -1);
+        
         calculateScores();
     }
     
+    // RTT percentile (0-100) over the successful probes in the window in milliseconds, -1 if none
+    double windowRttPercentileMs(double percentile) const {
+        std::array<qint64, WINDOW_SIZE> rtts;
+        int count = 0;
+        for (int i = 0; i < windowPings; ++i) {
+            if (windowRttUs[i] >= 0) rtts[count++] = windowRttUs[i];
+        }
+        if (count == 0) {
+            return -1.0;
+        }
+        // Nearest rank
+        int rank = qBound(0, int(percentile / 100.0 * count + 0.999999) - 1, count - 1);
+        std::nth_element(rtts.begin(), rtts.begin() + rank, rtts.begin() + count);
+        return rtts[rank] / 1000.0;
+    }
+    
 private:
+    // Ring of the last WINDOW_SIZE round trips in microseconds, -1 for lost probes. Running sums
+    // keep every update O(1).
+    std::array<qint64, WINDOW_SIZE> windowRttUs;
+    int windowHead;
+    qint64 windowRttSumUs;
+    double jitterUs;
+    qint64 lastRttUs;
+    
+    void addToWindow(qint64 rttUs) {
+        if (windowPings == WINDOW_SIZE) {
+            // Evict the oldest probe
+            qint64 evicted = windowRttUs[windowHead];
+            if (evicted < 0) windowLost--;
+            else windowRttSumUs -= evicted;
+        } else {
+            windowPings++;
+        }
+        windowRttUs[windowHead] = rttUs;
+        windowHead = (windowHead + 1) % WINDOW_SIZE;
+        
+        if (rttUs < 0) {
+            windowLost++;
+        } else {
+            windowRttSumUs += rttUs;
+            // J += (|D| - J) / 16 with D the change between consecutive round trips
+            if (lastRttUs >= 0) {
+                jitterUs += (std::llabs(rttUs - lastRttUs) - jitterUs) / 16.0;
+            }
+            lastRttUs = rttUs;
+        }
+        
+        int received = windowPings - windowLost;
+        windowLossPercent = 100.0 * windowLost / windowPings;
+        windowMeanRttMs = received > 0 ? windowRttSumUs / 1000.0 / received : -1.0;
+        jitterMs = jitterUs / 1000.0;
+        averageRtt = received > 0 ? int(windowMeanRttMs + 0.5) : 0;
+    }
+    
     void calculateScores() {
-        // Use the new RTT-based scoring system
-        if (totalPings > 0 && successfulPings > 0) {
-            // Base score from average RTT (calculated by Ping::calculateScore)
-            if (averageRtt <= 5) overallScore = 100;        // Excellent - <5ms
-            else if (averageRtt <= 10) overallScore = 95;   // Very Good - 5-10ms
-            else if (averageRtt <= 20) overallScore = 85;   // Good - 10-20ms
-            else if (averageRtt <= 35) overallScore = 75;   // Fair - 20-35ms
-            else if (averageRtt <= 50) overallScore = 65;   // Acceptable - 35-50ms
-            else if (averageRtt <= 75) overallScore = 50;   // Poor - 50-75ms
-            else if (averageRtt <= 100) overallScore = 35;  // Very Poor - 75-100ms
-            else if (averageRtt <= 150) overallScore = 20;  // Critical - 100-150ms
-            else if (averageRtt <= 200) overallScore = 10;  // Severe - 150-200ms
-            else overallScore = 5;                           // Unusable - >200ms
+        // Recent probes only, so the score follows the link rather than its whole history
+        int received = windowPings - windowLost;
+        if (windowPings > 0 && received > 0) {
+            // Base score from the mean RTT of the window
+            if (windowMeanRttMs <= 5) overallScore = 100;        // Excellent - <5ms
+            else if (windowMeanRttMs <= 10) overallScore = 95;   // Very Good - 5-10ms
+            else if (windowMeanRttMs <= 20) overallScore = 85;   // Good - 10-20ms
+            else if (windowMeanRttMs <= 35) overallScore = 75;   // Fair - 20-35ms
+            else if (windowMeanRttMs <= 50) overallScore = 65;   // Acceptable - 35-50ms
+            else if (windowMeanRttMs <= 75) overallScore = 50;   // Poor - 50-75ms
+            else if (windowMeanRttMs <= 100) overallScore = 35;  // Very Poor - 75-100ms
+            else if (windowMeanRttMs <= 150) overallScore = 20;  // Critical - 100-150ms
+            else if (windowMeanRttMs <= 200) overallScore = 10;  // Severe - 150-200ms
+            else overallScore = 5;                               // Unusable - >200ms
             
             // Apply packet loss penalty
-            double packetLossPercent = ((double)(totalPings - successfulPings) / totalPings) * 100.0;
-            if (packetLossPercent > 0) {
-                if (packetLossPercent <= 10) overallScore -= 5;      // Minor loss
-                else if (packetLossPercent <= 25) overallScore -= 10; // Moderate loss
-                else if (packetLossPercent <= 50) overallScore -= 15; // Significant loss
-                else if (packetLossPercent <= 75) overallScore -= 25; // Severe loss
+            if (windowLossPercent > 0) {
+                if (windowLossPercent <= 10) overallScore -= 5;      // Minor loss
+                else if (windowLossPercent <= 25) overallScore -= 10; // Moderate loss
+                else if (windowLossPercent <= 50) overallScore -= 15; // Significant loss
+                else if (windowLossPercent <= 75) overallScore -= 25; // Severe loss
                 else overallScore -= 30;                              // Critical loss
             }
             
+            // Apply jitter penalty, a jittery link stutters video even at a good mean RTT
+            if (jitterMs > 30) overallScore -= 10;
+            else if (jitterMs > 10) overallScore -= 5;
+            
             // Apply consecutive failure penalty
             if (consecutiveFailures >= 3) {
                 overallScore -= qMin(20, consecutiveFailures * 5);
@@ -164,7 +252,7 @@ private:
             overallScore = qBound(0, overallScore, 100);
             
             // Set individual scores for compatibility
-            reliabilityScore = (successfulPings * 100) / totalPings;
+            reliabilityScore = (received * 100) / windowPings;
             performanceScore = overallScore;
             stabilityScore = consecutiveSuccesses >= 3 ? 100 : 
                            (consecutiveFailures >= 3 ? 0 : 50);
@@ -187,27 +275,36 @@ public:
     struct PingResult {
         bool success;
         int roundTripTime;
+        qint64 roundTripTimeUs;  // average, -1 when only whole milliseconds are known
         QString errorMessage;
         int packetsTransmitted;
         int packetsReceived;
         double packetLoss;
         QString statistics;
         
-        PingResult() : success(false), roundTripTime(-1), packetsTransmitted(0), packetsReceived(0), packetLoss(100.0) {}
+        PingResult() : success(false), roundTripTime(-1), roundTripTimeUs(-1), packetsTransmitted(0), packetsReceived(0), packetLoss(100.0) {}
         PingResult(bool success, int rtt, const QString& error = QString(), 
                   int transmitted = 1, int received = 0, double loss = 100.0, 
                   const QString& stats = QString()) 
-            : success(success), roundTripTime(rtt), errorMessage(error), 
+            : success(success), roundTripTime(rtt), roundTripTimeUs(-1), errorMessage(error), 
               packetsTransmitted(transmitted), packetsReceived(received), 
               packetLoss(loss), statistics(stats) {}
     };
 
     PingResult pingHost(const QString& host, int timeoutMs = 1000);
+    // In-process ICMP echo when an ICMP socket can be opened, the ping utility otherwise
     PingResult pingHostWithStats(const QString& host, int count = 3, int timeoutMs = 1000);
+    // Always through the ping utility
+    PingResult pingHostWithProcess(const QString& host, int count = 3, int timeoutMs = 1000);
+
+    bool usesIcmpEngine() const { return engine != nullptr; }
 
 private:
+    PingResult pingHostWithEngine(const QString& host, int count, int timeoutMs);
     PingResult parsePingOutput(const QString& output, int exitCode);
     int calculateScore(const PingResult& result);
+
+    std::shared_ptr<IcmpEngine> engine;
 };
 
 class PingWorker : public QObject {
@@ -236,13 +333,23 @@ public:
 
     void addHost(const QString& name, const QString& host);
     void removeHost(const QString& name);
+    QStringList hostNames() const;
+    // Interval of a host that is neither stable nor losing probes
     void setPingInterval(int intervalMs);
+    // Interval right after a lost probe, and the most a stable host backs off to
+    void setAdaptiveIntervals(int fastIntervalMs, int maxIntervalMs);
+    // Longest a probe waits for its reply, shorter once the host's RTTs are known
     void setTimeout(int timeoutMs);
     void startWatching();
     void stopWatching();
     bool isWatching() const { return watching; }
     HostConnectivityScore getConnectivityScore(const QString& name) const;
 
+public slots:
+    // Probe now and keep probing fast until the result is clear, e.g. when a stream fails
+    void probeNow(const QString& name);
+    void probeAllNow();
+
 signals:
     void hostStatusChanged(const QString& name, bool reachable, int roundTripTime);
     void hostError(const QString& name, const QString& error);
@@ -250,31 +357,61 @@ signals:
 
 private slots:
     void performPingCycle();
-    void onPingResult(int requestId, const QString& host, bool success, int roundTripTime, const QString& error);
+    void onPingResult(int requestId, bool success, qint64 roundTripTimeUs, const QString& error);
 
 private:
     struct HostInfo {
         QString name;
         QString host;
+        quint32 address;        // IPv4, network byte order, valid if resolved
+        bool resolved;
         bool lastStatus;
         int lastRtt;
         int pendingRequestId;
+        int intervalMs;         // current probe interval, adapted after every result
+        qint64 nextProbeMs;     // on the watcher's clock
         HostConnectivityScore score;
             
-        HostInfo() : lastStatus(false), lastRtt(-1), pendingRequestId(-1) {}
+        HostInfo() : address(0), resolved(false), lastStatus(false), lastRtt(-1), pendingRequestId(-1),
+                     intervalMs(0), nextProbeMs(0) {}
         HostInfo(const QString& n, const QString& h) 
-            : name(n), host(h), lastStatus(false), lastRtt(-1), pendingRequestId(-1) {
+            : name(n), host(h), address(0), resolved(false), lastStatus(false), lastRtt(-1), pendingRequestId(-1),
+              intervalMs(0), nextProbeMs(0) {
             score.hostName = n;
             score.hostAddress = h;
         }
     };
 
+    // Hands engine completions (on its I/O thread) to the watcher's thread, outlives the watcher
+    struct ProbeSink;
+
+    // Send one probe for the host, its result arrives through onPingResult. hostsMutex held.
+    void startProbe(HostInfo& hostInfo, int requestId);
+    static bool resolveHost(HostInfo& hostInfo);
+    // Arm the timer for the host due first. hostsMutex held.
+    void scheduleNextProbe();
+    void adaptInterval(HostInfo& hostInfo, bool success) const;
+    int probeTimeout(const HostInfo& hostInfo) const;
+
+    // A host this many successes in a row is stable and backs off
+    static constexpr int STABLE_SUCCESSES = 5;
+    // Fast probing stops after this many failures in a row, the host is down by then
+    static constexpr int DOWN_FAILURES = 5;
+    // Adaptive timeouts never go below this
+    static constexpr int MIN_PROBE_TIMEOUT_MS = 200;
+
     QMap<QString, HostInfo> hosts;
+    QHash<int, QString> pendingRequests;  // request ID -> host name, guarded by hostsMutex
     mutable QMutex hostsMutex;
     QTimer* pingTimer;
-    QThread* workerThread;
+    QThread* workerThread;                // only without an ICMP socket, for the ping utility
     PingWorker* pingWorker;
+    std::shared_ptr<IcmpEngine> engine;
+    std::shared_ptr<ProbeSink> sink;
+    QElapsedTimer clock;
     int pingInterval;
+    int fastInterval;
+    int maxInterval;
     int pingTimeout;
     bool watching;
     int nextRequestId;
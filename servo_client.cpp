@@ -1,17 +1,43 @@
 #include "servo_client.hpp"
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <endian.h>
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <sstream>
-#include <regex>
+#include <limits>
+#include <vector>
 
 namespace ServoControl {
 
+    namespace {
+        // "/dev/gpiochipN" -> N, false for chip names the compact format cannot carry
+        bool gpioChipNumber(const std::string& chip, uint16_t& number) {
+            static const char prefix[] = "/dev/gpiochip";
+            constexpr size_t prefix_len = sizeof(prefix) - 1;
+            if (chip.size() <= prefix_len || chip.compare(0, prefix_len, prefix) != 0) {
+                return false;
+            }
+            uint32_t value = 0;
+            for (size_t i = prefix_len; i < chip.size(); ++i) {
+                if (chip[i] < '0' || chip[i] > '9') return false;
+                value = value * 10 + static_cast<uint32_t>(chip[i] - '0');
+                if (value > 0xffff) return false;
+            }
+            number = static_cast<uint16_t>(value);
+            return true;
+        }
+    }
+
     ServoClient::ServoClient(const std::string& ip, int port, int timeout_ms)
-        : server_ip(ip), server_port(port), socket_fd(-1), timeout_ms(timeout_ms), connected(false) {
+        : server_ip(ip), server_port(port), socket_fd(-1), epoll_fd(-1), wake_fd(-1), timeout_ms(timeout_ms),
+          preferred_format(WireFormat::COMPACT), wire_format(WireFormat::JSON), next_request_id(1),
+          closed(true), io_running(false), connected(false) {
         server_addr = std::make_unique<sockaddr_in>();
         memset(server_addr.get(), 0, sizeof(sockaddr_in));
         server_addr->sin_family = AF_INET;
@@ -24,39 +50,70 @@ namespace ServoControl {
     }
 
     bool ServoClient::connect() {
+        std::lock_guard<std::mutex> lock(lifecycle_mutex);
         if (connected) {
             return true;
         }
         
-        socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        std::unique_lock<std::shared_mutex> sockets(socket_mutex);
+        // Nonblocking, the I/O thread drains the socket whenever epoll reports it readable
+        socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
         if (socket_fd < 0) {
-            last_error = "Failed to create socket: " + std::string(strerror(errno));
+            setLastError("Failed to create socket: " + std::string(strerror(errno)));
             return false;
         }
         
-        // Set socket timeout
-        struct timeval timeout;
-        timeout.tv_sec = timeout_ms / 1000;
-        timeout.tv_usec = (timeout_ms % 1000) * 1000;
-        
-        if (setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
-            last_error = "Failed to set socket timeout: " + std::string(strerror(errno));
-            close(socket_fd);
-            socket_fd = -1;
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        bool registered = epoll_fd >= 0 && wake_fd >= 0;
+        for (int fd : {socket_fd, wake_fd}) {
+            if (!registered) break;
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            registered = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+        }
+        if (!registered) {
+            setLastError("Failed to set up socket polling: " + std::string(strerror(errno)));
+            for (int* fd : {&socket_fd, &epoll_fd, &wake_fd}) {
+                if (*fd >= 0) close(*fd);
+                *fd = -1;
+            }
             return false;
         }
         
+        sockets.unlock();
+        
+        // Open for requests before the thread starts, whose failAllRequests() closes it again
+        {
+            std::lock_guard<std::mutex> pending_lock(pending_mutex);
+            closed = false;
+        }
+        io_running = true;
+        io_thread = std::thread([this]() { ioLoop(); });
+        
         connected = true;
-        last_error.clear();
+        setLastError("");
         return true;
     }
 
     void ServoClient::disconnect() {
-        if (socket_fd >= 0) {
-            close(socket_fd);
-            socket_fd = -1;
-        }
+        std::lock_guard<std::mutex> lock(lifecycle_mutex);
         connected = false;
+        if (io_thread.joinable()) {
+            io_running = false;
+            wakeIoThread();
+            io_thread.join();
+        }
+        
+        // A sender that registered before the I/O thread closed the table may still be sending
+        std::unique_lock<std::shared_mutex> sockets(socket_mutex);
+        for (int* fd : {&socket_fd, &epoll_fd, &wake_fd}) {
+            if (*fd >= 0) close(*fd);
+            *fd = -1;
+        }
+        // The server may be a different one on reconnect, negotiate again
+        wire_format = WireFormat::JSON;
     }
 
     bool ServoClient::isConnected() const {
@@ -73,65 +130,278 @@ namespace ServoControl {
         return sendRequest(request);
     }
 
+    uint32_t ServoClient::setPositionAsync(int position, Callback callback, const GpioDefinition& gpio) {
+        ServoRequest request(RequestType::SET_NEW_POSITION, position, gpio);
+        return sendRequestAsync(request, std::move(callback));
+    }
+
     ServoResponse ServoClient::sendRequest(const ServoRequest& request) {
-        ServoResponse response;
+        return sendRequestAsync(request).get();
+    }
+
+    std::future<ServoResponse> ServoClient::sendRequestAsync(const ServoRequest& request) {
+        auto promise = std::make_shared<std::promise<ServoResponse>>();
+        std::future<ServoResponse> future = promise->get_future();
+        sendRequestAsync(request, [promise](const ServoResponse& response) {
+            promise->set_value(response);
+        });
+        return future;
+    }
+
+    uint32_t ServoClient::sendRequestAsync(const ServoRequest& request, Callback callback) {
+        auto fail = [&callback](const std::string& message) {
+            ServoResponse response;
+            response.response_message = message;
+            if (callback) callback(response);
+            return 0u;
+        };
         
+        // No reconnect from here: completion callbacks run on the I/O thread, which disconnect()
+        // joins while holding lifecycle_mutex. This is only the fast path, registration below
+        // decides
         if (!connected) {
-            if (!connect()) {
-                response.response_message = "Not connected to server: " + last_error;
-                return response;
-            }
+            return fail("Not connected to server");
         }
         
-        // Serialize request
-        std::string json_request = serializeRequest(request);
-        if (json_request.empty()) {
-            response.response_message = "Failed to serialize request";
-            return response;
+        uint32_t request_id;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            request_id = next_request_id++;
+            if (next_request_id == 0) next_request_id = 1;
         }
         
-        // Send request
-        if (!sendUdpMessage(json_request)) {
-            response.response_message = "Failed to send request: " + last_error;
-            return response;
+        // Serialize in compact when it is negotiated and can carry this request, in JSON otherwise
+        std::string payload;
+        bool compact = wire_format == WireFormat::COMPACT && serializeCompactRequest(request, request_id, payload);
+        if (!compact) {
+            payload = serializeRequest(request, request_id);
         }
-        
-        // Receive response
-        std::string json_response = receiveUdpMessage();
-        if (json_response.empty()) {
-            response.response_message = "Failed to receive response: " + last_error;
-            return response;
+        if (payload.empty()) {
+            return fail("Failed to serialize request");
         }
         
-        // Deserialize response
-        response = deserializeResponse(json_response);
-        return response;
+        // Register before sending so the reply cannot beat us to the table. Once registered, the
+        // I/O thread completes the request: by reply, by timeout or in failAllRequests()
+        bool wake = true;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            if (closed) {
+                return fail("Not connected to server");
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms.load());
+            // The I/O thread sleeps until the earliest deadline, wake it if this one is earlier
+            for (const auto& entry : pending) {
+                if (entry.second.deadline <= deadline) {
+                    wake = false;
+                    break;
+                }
+            }
+            pending.emplace(request_id, PendingRequest{std::move(callback), deadline, compact});
+        }
+        bool sent;
+        {
+            std::shared_lock<std::shared_mutex> sockets(socket_mutex);
+            if (wake) {
+                wakeIoThread();
+            }
+            sent = sendUdpMessage(payload);
+        }
+        if (!sent) {
+            Callback failed;
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                auto it = pending.find(request_id);
+                if (it != pending.end()) {
+                    failed = std::move(it->second.callback);
+                    pending.erase(it);
+                }
+            }
+            callback = std::move(failed);
+            return fail("Failed to send request: " + getLastError());
+        }
+        return request_id;
+    }
+
+    size_t ServoClient::pendingRequests() {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        return pending.size();
     }
 
     void ServoClient::setTimeout(int timeout_ms) {
         this->timeout_ms = timeout_ms;
-        
-        if (connected && socket_fd >= 0) {
-            struct timeval timeout;
-            timeout.tv_sec = timeout_ms / 1000;
-            timeout.tv_usec = (timeout_ms % 1000) * 1000;
-            setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    void ServoClient::setPreferredWireFormat(WireFormat format) {
+        preferred_format = format;
+        if (format == WireFormat::JSON) {
+            wire_format = WireFormat::JSON;
         }
     }
 
+    WireFormat ServoClient::getWireFormat() const {
+        return wire_format;
+    }
+
     std::string ServoClient::getLastError() const {
+        std::lock_guard<std::mutex> lock(error_mutex);
         return last_error;
     }
 
-    std::string ServoClient::serializeRequest(const ServoRequest& request) {
+    void ServoClient::setLastError(const std::string& error) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        last_error = error;
+    }
+
+    void ServoClient::ioLoop() {
+        char buffer[1024];
+        while (io_running) {
+            struct epoll_event events[2];
+            int count = epoll_wait(epoll_fd, events, 2, nextTimeoutMs());
+            if (count < 0 && errno != EINTR) {
+                setLastError("Failed to poll socket: " + std::string(strerror(errno)));
+                break;
+            }
+            
+            for (int i = 0; i < count; ++i) {
+                if (events[i].data.fd == wake_fd) {
+                    uint64_t value;
+                    while (read(wake_fd, &value, sizeof(value)) > 0) {}
+                    continue;
+                }
+                
+                // Drain every datagram that arrived
+                while (true) {
+                    ssize_t received = recvfrom(socket_fd, buffer, sizeof(buffer), 0, nullptr, nullptr);
+                    if (received < 0) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            setLastError("Failed to receive UDP message: " + std::string(strerror(errno)));
+                        }
+                        if (errno != EINTR) break;
+                        continue;
+                    }
+                    // Compact replies contain zero bytes, keep the length
+                    handleReply(std::string(buffer, static_cast<size_t>(received)));
+                }
+            }
+            
+            expireRequests(std::chrono::steady_clock::now());
+        }
+        
+        failAllRequests("Disconnected");
+    }
+
+    void ServoClient::handleReply(const std::string& data) {
+        if (data.empty()) {
+            return;
+        }
+        
+        // Compact replies are recognised by their length and magic, anything else has to be a JSON
+        // object. Whatever is neither (garbage, stray datagrams) is dropped, it answers nothing.
+        ServoResponse response;
+        bool compact_reply = deserializeCompactResponse(data, response);
+        if (!compact_reply) {
+            size_t start = data.find_first_not_of(" \t\r\n");
+            if (start == std::string::npos || data[start] != '{' || !deserializeResponse(data, response)) {
+                return;
+            }
+        }
+        
+        // Match by request_id, or for JSON servers that do not echo it the oldest request. Late
+        // replies to requests that already timed out are dropped.
+        Callback callback;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            bool by_id = compact_reply || response.request_id != 0;
+            auto it = by_id ? pending.find(response.request_id) : pending.begin();
+            if (it == pending.end()) {
+                return;
+            }
+            
+            // A JSON answer to a compact request means the server no longer speaks compact
+            // (restarted with an older version), deserializeResponse renegotiates
+            if (it->second.compact && !compact_reply && wire_format == WireFormat::COMPACT) {
+                wire_format = WireFormat::JSON;
+            }
+            callback = std::move(it->second.callback);
+            pending.erase(it);
+        }
+        if (callback) {
+            callback(response);
+        }
+    }
+
+    void ServoClient::expireRequests(std::chrono::steady_clock::time_point now) {
+        std::vector<Callback> expired;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->second.deadline <= now) {
+                    expired.push_back(std::move(it->second.callback));
+                    it = pending.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        
+        ServoResponse response;
+        response.response_message = "Failed to receive response: Timeout waiting for response";
+        for (const Callback& callback : expired) {
+            if (callback) callback(response);
+        }
+    }
+
+    void ServoClient::failAllRequests(const std::string& message) {
+        std::map<uint32_t, PendingRequest> failed;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            failed.swap(pending);
+            closed = true;
+        }
+        
+        ServoResponse response;
+        response.response_message = message;
+        for (const auto& entry : failed) {
+            if (entry.second.callback) entry.second.callback(response);
+        }
+    }
+
+    int ServoClient::nextTimeoutMs() {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if (pending.empty()) {
+            return -1;
+        }
+        
+        auto earliest = pending.begin()->second.deadline;
+        for (const auto& entry : pending) {
+            earliest = std::min(earliest, entry.second.deadline);
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            earliest - std::chrono::steady_clock::now()).count();
+        // Round up so the request has expired by the time epoll returns
+        return remaining < 0 ? 0 : static_cast<int>(remaining) + 1;
+    }
+
+    void ServoClient::wakeIoThread() {
+        if (wake_fd < 0) {
+            return;
+        }
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            setLastError("Failed to wake I/O thread: " + std::string(strerror(errno)));
+        }
+    }
+
+    std::string ServoClient::serializeRequest(const ServoRequest& request, uint32_t request_id) {
         cJSON* json = cJSON_CreateObject();
         if (!json) {
-            last_error = "Failed to create JSON object";
+            setLastError("Failed to create JSON object");
             return "";
         }
         
         // Add request type
         cJSON_AddNumberToObject(json, "request_type", static_cast<int>(request.request_type));
+        cJSON_AddNumberToObject(json, "request_id", request_id);
         
         // Add new_value if it's a SET_NEW_POSITION request
         if (request.request_type == RequestType::SET_NEW_POSITION) {
@@ -147,7 +417,13 @@ namespace ServoControl {
             cJSON_AddItemToObject(json, "gpio_definition", gpio_def);
         }
         
-        char* json_string = cJSON_Print(json);
+        // Offer the compact format until the server takes it
+        if (preferred_format == WireFormat::COMPACT && wire_format == WireFormat::JSON) {
+            cJSON_AddStringToObject(json, "accept_wire_format", Wire::COMPACT_NAME);
+        }
+        
+        // Unformatted, the server does not need the whitespace
+        char* json_string = cJSON_PrintUnformatted(json);
         std::string result;
         if (json_string) {
             result = json_string;
@@ -158,13 +434,16 @@ namespace ServoControl {
         return result;
     }
 
-    ServoResponse ServoClient::deserializeResponse(const std::string& json_str) {
-        ServoResponse response;
+    bool ServoClient::deserializeResponse(const std::string& json_str, ServoResponse& response) {
+        response = ServoResponse();
         
         cJSON* json = cJSON_Parse(json_str.c_str());
         if (!json) {
-            response.response_message = "Failed to parse JSON response";
-            return response;
+            return false;
+        }
+        if (!cJSON_IsObject(json)) {
+            cJSON_Delete(json);
+            return false;
         }
         
         // Parse response type
@@ -179,46 +458,76 @@ namespace ServoControl {
             response.response_message = response_message->valuestring;
         }
         
+        cJSON* request_id = cJSON_GetObjectItem(json, "request_id");
+        if (request_id && cJSON_IsNumber(request_id) && request_id->valuedouble > 0) {
+            response.request_id = static_cast<uint32_t>(request_id->valuedouble);
+        }
+        
+        // Server accepted the compact format, use it from the next request on
+        cJSON* accepted = cJSON_GetObjectItem(json, "wire_format");
+        if (preferred_format == WireFormat::COMPACT && accepted && cJSON_IsString(accepted) &&
+            strcmp(accepted->valuestring, Wire::COMPACT_NAME) == 0) {
+            wire_format = WireFormat::COMPACT;
+        }
+        
         cJSON_Delete(json);
-        return response;
+        return true;
     }
 
-    bool ServoClient::sendUdpMessage(const std::string& message) {
-        ssize_t sent = sendto(socket_fd, message.c_str(), message.length(), 0,
-                             (struct sockaddr*)server_addr.get(), sizeof(sockaddr_in));
-        
-        if (sent < 0) {
-            last_error = "Failed to send UDP message: " + std::string(strerror(errno));
+    bool ServoClient::serializeCompactRequest(const ServoRequest& request, uint32_t request_id, std::string& out) {
+        Wire::CompactRequest packet{};
+        if (!gpioChipNumber(request.gpio_def.gpio_chip, packet.gpio_chip) ||
+            request.gpio_def.gpio_line < 0 || request.gpio_def.gpio_line > 0xffff) {
             return false;
         }
         
-        if (static_cast<size_t>(sent) != message.length()) {
-            last_error = "Incomplete message sent";
+        packet.magic = htole16(Wire::REQUEST_MAGIC);
+        packet.version = Wire::VERSION;
+        packet.request_type = static_cast<uint8_t>(request.request_type);
+        packet.request_id = htole32(request_id);
+        packet.new_value = static_cast<int32_t>(htole32(static_cast<uint32_t>(request.new_value)));
+        packet.gpio_chip = htole16(packet.gpio_chip);
+        packet.gpio_line = htole16(static_cast<uint16_t>(request.gpio_def.gpio_line));
+        
+        out.assign(reinterpret_cast<const char*>(&packet), sizeof(packet));
+        return true;
+    }
+
+    bool ServoClient::deserializeCompactResponse(const std::string& data, ServoResponse& response) {
+        Wire::CompactResponse packet;
+        if (data.size() != sizeof(packet)) {
+            return false;
+        }
+        memcpy(&packet, data.data(), sizeof(packet));
+        if (le16toh(packet.magic) != Wire::RESPONSE_MAGIC || packet.version != Wire::VERSION) {
             return false;
         }
         
+        response = ServoResponse();
+        response.response_type = static_cast<ResponseType>(packet.response_type);
+        response.request_id = le32toh(packet.request_id);
+        response.position = static_cast<int32_t>(le32toh(static_cast<uint32_t>(packet.position)));
+        if (response.response_type != ResponseType::SUCCESS) {
+            response.response_message = "Server reported failure";
+        }
         return true;
     }
 
-    std::string ServoClient::receiveUdpMessage() {
-        char buffer[1024];
-        sockaddr_in from_addr;
-        socklen_t from_len = sizeof(from_addr);
+    bool ServoClient::sendUdpMessage(const std::string& message) {
+        ssize_t sent = sendto(socket_fd, message.c_str(), message.length(), 0,
+                             (struct sockaddr*)server_addr.get(), sizeof(sockaddr_in));
         
-        ssize_t received = recvfrom(socket_fd, buffer, sizeof(buffer) - 1, 0,
-                                   (struct sockaddr*)&from_addr, &from_len);
+        if (sent < 0) {
+            setLastError("Failed to send UDP message: " + std::string(strerror(errno)));
+            return false;
+        }
         
-        if (received < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                last_error = "Timeout waiting for response";
-            } else {
-                last_error = "Failed to receive UDP message: " + std::string(strerror(errno));
-            }
-            return "";
+        if (static_cast<size_t>(sent) != message.length()) {
+            setLastError("Incomplete message sent");
+            return false;
         }
         
-        buffer[received] = '\0';
-        return std::string(buffer);
+        return true;
     }
 
     // Utility functions
@@ -228,19 +537,51 @@ namespace ServoControl {
                 return -1;
             }
             
-            // Use regex to extract position from message like "Current servo position: 90"
-            std::regex position_regex(R"(.*position.*?(\d+))");
-            std::smatch match;
+            // Compact replies carry the position as a number
+            if (response.position >= 0) {
+                return response.position;
+            }
+            
+            return parsePosition(response.response_message).value_or(-1);
+        }
+        
+        std::optional<int> parsePosition(std::string_view message) {
+            static constexpr std::string_view keyword = "position";
             
-            if (std::regex_search(response.response_message, match, position_regex)) {
-                try {
-                    return std::stoi(match[1].str());
-                } catch (const std::exception&) {
-                    return -1;
+            // Like the regex this replaces: the first line with a match decides, and on that line
+            // the last "position" followed by a number
+            std::optional<int> position;
+            bool matched = false;  // a number followed "position" on this line
+            bool armed = false;    // "position" seen on this line, no number after it yet
+            size_t i = 0;
+            while (i < message.size()) {
+                char c = message[i];
+                if (c == keyword[0] && message.compare(i, keyword.size(), keyword) == 0) {
+                    armed = true;
+                    i += keyword.size();
+                } else if (armed && c >= '0' && c <= '9') {
+                    // The whole run of digits, an out of range number is no position
+                    long long value = 0;
+                    bool fits = true;
+                    for (; i < message.size() && message[i] >= '0' && message[i] <= '9'; ++i) {
+                        value = value * 10 + (message[i] - '0');
+                        if (value > std::numeric_limits<int>::max()) {
+                            fits = false;
+                            value = 0;
+                        }
+                    }
+                    position = fits ? std::optional<int>(static_cast<int>(value)) : std::nullopt;
+                    matched = true;
+                    armed = false;
+                } else {
+                    if (c == '\n' || c == '\r') {
+                        if (matched) return position;
+                        armed = false;
+                    }
+                    ++i;
                 }
             }
-            
-            return -1;
+            return position;
         }
         
         bool isSuccessResponse(const ServoResponse& response) {
@@ -251,6 +592,9 @@ namespace ServoControl {
             std::ostringstream oss;
             oss << "Response Type: " << (response.response_type == ResponseType::SUCCESS ? "SUCCESS" : "FAILED") << "\n";
             oss << "Message: " << response.response_message;
+            if (response.position >= 0) {
+                oss << "\nPosition: " << response.position;
+            }
             return oss.str();
         }
     }
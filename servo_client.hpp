@@ -1,8 +1,19 @@
 #ifndef SERVO_CLIENT_HPP
 #define SERVO_CLIENT_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <thread>
 #include "cJSON.h"
 
 // Forward declarations
@@ -27,6 +38,55 @@ namespace ServoControl {
         FAILED = 1
     };
 
+    /**
+     * Wire formats understood by the client.
+     *
+     * JSON is what every server speaks. COMPACT is a fixed-layout binary format: a client that
+     * prefers it adds "accept_wire_format": "compact_v1" to its JSON requests, and a server that
+     * supports it answers with "wire_format": "compact_v1". From then on both sides exchange
+     * Wire::CompactRequest / Wire::CompactResponse. Older servers ignore the offer and the client
+     * stays on JSON.
+     *
+     * Every request carries a request_id (the "request_id" key in JSON) that the server echoes so
+     * replies can be matched while several requests are in flight. Replies without one are matched
+     * to the oldest outstanding request.
+     */
+    enum class WireFormat {
+        JSON = 0,
+        COMPACT = 1
+    };
+
+    namespace Wire {
+        constexpr const char* COMPACT_NAME = "compact_v1";
+        constexpr uint16_t REQUEST_MAGIC = 0x5153;   // "SQ" on the wire
+        constexpr uint16_t RESPONSE_MAGIC = 0x5253;  // "SR" on the wire
+        constexpr uint8_t VERSION = 1;
+
+        // All fields little endian. gpio_chip is N of /dev/gpiochipN, the consumer label is
+        // only carried by JSON requests.
+        struct CompactRequest {
+            uint16_t magic;
+            uint8_t version;
+            uint8_t request_type;
+            uint32_t request_id;
+            int32_t new_value;
+            uint16_t gpio_chip;
+            uint16_t gpio_line;
+        };
+        static_assert(sizeof(CompactRequest) == 16, "CompactRequest must have no padding");
+
+        // position is the servo position after the request, -1 if the server could not read it
+        struct CompactResponse {
+            uint16_t magic;
+            uint8_t version;
+            uint8_t response_type;
+            uint32_t request_id;
+            int32_t position;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(CompactResponse) == 16, "CompactResponse must have no padding");
+    }
+
     struct GpioDefinition {
         std::string consumer;
         std::string gpio_chip;
@@ -53,23 +113,67 @@ namespace ServoControl {
     struct ServoResponse {
         ResponseType response_type;
         std::string response_message;
+        int position;  // Filled from compact replies, -1 otherwise
+        uint32_t request_id;  // Echoed by the server, 0 if it did not
         
-        ServoResponse() : response_type(ResponseType::FAILED) {}
+        ServoResponse() : response_type(ResponseType::FAILED), position(-1), request_id(0) {}
     };
 
+    /**
+     * Requests are sent from the calling thread. One I/O thread per connected client receives the
+     * replies, matches them by request_id and enforces each request's timeout, so any number of
+     * requests can be in flight and a lost datagram only fails its own request.
+     */
     class ServoClient {
+    public:
+        using Callback = std::function<void(const ServoResponse&)>;
+        
     private:
+        struct PendingRequest {
+            Callback callback;
+            std::chrono::steady_clock::time_point deadline;
+            bool compact;
+        };
+        
         std::string server_ip;
         int server_port;
+        // Set up by connect() and closed by disconnect() under an exclusive socket_mutex; senders
+        // hold it shared while they use socket_fd and wake_fd, the I/O thread runs in between
         int socket_fd;
+        int epoll_fd;
+        int wake_fd;
+        std::shared_mutex socket_mutex;
         std::unique_ptr<sockaddr_in> server_addr;
-        int timeout_ms;
+        std::atomic<int> timeout_ms;
+        std::atomic<WireFormat> preferred_format;
+        std::atomic<WireFormat> wire_format;
+        
+        // Outstanding requests by request_id, guarded by pending_mutex
+        std::map<uint32_t, PendingRequest> pending;
+        uint32_t next_request_id;
+        bool closed;  // no I/O thread will complete new entries, registration fails
+        std::mutex pending_mutex;
+        
+        std::thread io_thread;
+        std::atomic<bool> io_running;
+        std::mutex lifecycle_mutex;
         
         // Internal helper methods
-        std::string serializeRequest(const ServoRequest& request);
-        ServoResponse deserializeResponse(const std::string& json_str);
+        std::string serializeRequest(const ServoRequest& request, uint32_t request_id);
+        // False for anything that is not a reply in that format
+        bool deserializeResponse(const std::string& json_str, ServoResponse& response);
+        bool serializeCompactRequest(const ServoRequest& request, uint32_t request_id, std::string& out);
+        bool deserializeCompactResponse(const std::string& data, ServoResponse& response);
         bool sendUdpMessage(const std::string& message);
-        std::string receiveUdpMessage();
+        void setLastError(const std::string& error);
+        
+        // I/O thread: receive replies, complete and expire pending requests
+        void ioLoop();
+        void handleReply(const std::string& data);
+        void expireRequests(std::chrono::steady_clock::time_point now);
+        void failAllRequests(const std::string& message);
+        int nextTimeoutMs();
+        void wakeIoThread();
         
     public:
         /**
@@ -86,13 +190,14 @@ namespace ServoControl {
         ~ServoClient();
         
         /**
-         * Connect to the servo server
+         * Connect to the servo server: create the socket and start the I/O thread
          * @return true if connection successful, false otherwise
          */
         bool connect();
         
         /**
-         * Disconnect from the servo server
+         * Disconnect from the servo server. Outstanding requests fail with "Disconnected".
+         * Must not be called from a completion callback.
          */
         void disconnect();
         
@@ -118,18 +223,65 @@ namespace ServoControl {
         ServoResponse setPosition(int position, const GpioDefinition& gpio = GpioDefinition());
         
         /**
-         * Send custom request to server
+         * Send custom request to server and wait for its reply
          * @param request Custom servo request
          * @return ServoResponse from server
          */
         ServoResponse sendRequest(const ServoRequest& request);
         
         /**
-         * Set timeout for UDP operations
+         * Send a request without waiting. The callback runs exactly once, on the I/O thread for
+         * replies and timeouts, or on the calling thread if the request cannot be sent. It must
+         * not block. Requests fail with "Not connected to server" unless connect() succeeded;
+         * nothing reconnects implicitly.
+         * @param request Custom servo request
+         * @param callback Completion callback
+         * @return request_id of the request, 0 if it could not be sent
+         */
+        uint32_t sendRequestAsync(const ServoRequest& request, Callback callback);
+        
+        /**
+         * Send a request without waiting
+         * @param request Custom servo request
+         * @return Future for the reply, or for the error if the request fails or times out
+         */
+        std::future<ServoResponse> sendRequestAsync(const ServoRequest& request);
+        
+        /**
+         * Set servo to new position without waiting for the reply
+         * @param position New position (0-180 degrees)
+         * @param callback Completion callback, may be empty
+         * @param gpio GPIO configuration (optional)
+         * @return request_id of the request, 0 if it could not be sent
+         */
+        uint32_t setPositionAsync(int position, Callback callback = Callback(),
+                                  const GpioDefinition& gpio = GpioDefinition());
+        
+        /**
+         * Number of requests waiting for a reply
+         * @return Requests in flight
+         */
+        size_t pendingRequests();
+        
+        /**
+         * Set the timeout of requests sent from now on
          * @param timeout_ms Timeout in milliseconds
          */
         void setTimeout(int timeout_ms);
         
+        /**
+         * Choose whether to offer the compact binary format to the server (default: COMPACT).
+         * JSON turns the offer off and switches back to JSON right away.
+         * @param format Preferred wire format
+         */
+        void setPreferredWireFormat(WireFormat format);
+        
+        /**
+         * Wire format currently used with the server
+         * @return COMPACT once the server accepted it, JSON otherwise
+         */
+        WireFormat getWireFormat() const;
+        
         /**
          * Get last error message
          * @return Error message string
@@ -138,7 +290,8 @@ namespace ServoControl {
         
     private:
         std::string last_error;
-        bool connected;
+        mutable std::mutex error_mutex;
+        std::atomic<bool> connected;
     };
 
     /**
@@ -146,12 +299,21 @@ namespace ServoControl {
      */
     namespace Utils {
         /**
-         * Extract position value from response message
+         * Extract position value from a response, the compact position field or the message text
          * @param response ServoResponse to parse
          * @return Position value, or -1 if not found
          */
         int extractPositionFromResponse(const ServoResponse& response);
         
+        /**
+         * Parse the position out of a reply text like "Current servo position: 90" in one pass,
+         * without allocating. The number is the first one after the last "position" on the same
+         * line that has one.
+         * @param message Response message
+         * @return Position value, or nothing if there is none or it does not fit in an int
+         */
+        std::optional<int> parsePosition(std::string_view message);
+        
         /**
          * Check if response indicates success
          * @param response ServoResponse to check
@@ -0,0 +1,32 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+
+// Keep the compiler from optimizing away a benchmarked result
+template<typename T>
+inline void do_not_optimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Run fn iterations times and return the mean time per call in nanoseconds
+template<typename Fn>
+double time_per_op_ns(size_t iterations, Fn &&fn) {
+    // Warm up caches and branch predictors
+    for (size_t i = 0; i < iterations / 10 + 1; i++) fn();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) fn();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / double(iterations);
+}
+
+inline void print_result(const char *name, double ns_per_op, double baseline_ns = 0.) {
+    if (baseline_ns > 0.) std::printf("  %-36s %10.1f ns/op  (%5.1fx)\n", name, ns_per_op, baseline_ns / ns_per_op);
+    else std::printf("  %-36s %10.1f ns/op\n", name, ns_per_op);
+}
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,95 @@
+// Compares the hex string codec against the binary codec used by SIYI_SDK
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "message.h"
+
+namespace {
+
+std::vector<uint8_t> hex_to_vector(const std::string &hex) {
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < hex.length(); i += 2)
+        bytes.push_back(static_cast<uint8_t>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    return bytes;
+}
+
+// Both codecs must put the same bytes on the wire while the sequence fits in one byte
+bool check_encoders_match() {
+    SIYI_Message str_codec;
+    SIYI_Message bin_codec;
+    for (int i = 0; i < 200; i++) {
+        int yaw = (i * 7) % 201 - 100;
+        int pitch = 100 - (i * 3) % 201;
+        std::vector<uint8_t> expected = hex_to_vector(str_codec.gimbal_speed_msg(yaw, pitch));
+        SIYI_Packet packet = bin_codec.gimbal_speed_packet(yaw, pitch);
+        if (expected.size() != packet.size || std::memcmp(expected.data(), packet.bytes, packet.size) != 0) {
+            std::printf("encoder mismatch at iteration %d\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const size_t iterations = 200000;
+
+    if (!check_encoders_match()) return EXIT_FAILURE;
+
+    SIYI_Message codec;
+
+    std::printf("encode gimbal speed command\n");
+    double str_encode = time_per_op_ns(iterations, [&] {
+        std::string msg = codec.gimbal_speed_msg(40, -20);
+        do_not_optimize(msg);
+    });
+    double bin_encode = time_per_op_ns(iterations, [&] {
+        SIYI_Packet packet = codec.gimbal_speed_packet(40, -20);
+        do_not_optimize(packet);
+    });
+    print_result("hex string (gimbal_speed_msg)", str_encode);
+    print_result("binary (gimbal_speed_packet)", bin_encode, str_encode);
+
+    std::printf("encode attitude request\n");
+    double str_request = time_per_op_ns(iterations, [&] {
+        std::string msg = codec.gimbal_attitude_msg();
+        do_not_optimize(msg);
+    });
+    double bin_request = time_per_op_ns(iterations, [&] {
+        SIYI_Packet packet = codec.gimbal_attitude_packet();
+        do_not_optimize(packet);
+    });
+    print_result("hex string (gimbal_attitude_msg)", str_request);
+    print_result("binary (gimbal_attitude_packet)", bin_request, str_request);
+
+    // An attitude reply: 12 bytes of yaw/pitch/roll and their speeds
+    const uint8_t attitude[] = {0x10, 0x00, 0xf6, 0xff, 0x05, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00};
+    SIYI_Packet reply;
+    codec.encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, attitude, sizeof(attitude), reply);
+    std::string reply_hex;
+    for (size_t i = 0; i < reply.size; i++) {
+        char byte[3];
+        std::snprintf(byte, sizeof(byte), "%02x", reply.bytes[i]);
+        reply_hex += byte;
+    }
+
+    std::printf("decode attitude reply\n");
+    double str_decode = time_per_op_ns(iterations, [&] {
+        auto decoded = codec.decode_msg(reply_hex);
+        do_not_optimize(decoded);
+    });
+    double bin_decode = time_per_op_ns(iterations, [&] {
+        SIYI_Frame frame;
+        bool ok = SIYI_Message::decode_packet(reply.bytes, reply.size, frame);
+        do_not_optimize(ok);
+        do_not_optimize(frame);
+    });
+    print_result("hex string (decode_msg)", str_decode);
+    print_result("binary (decode_packet)", bin_decode, str_decode);
+
+    return EXIT_SUCCESS;
+}
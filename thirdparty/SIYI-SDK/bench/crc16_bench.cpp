@@ -0,0 +1,101 @@
+// Checks every CRC16 kernel against the bytewise reference and compares their throughput
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "crc16.h"
+
+namespace {
+
+// Previous compute_str_swap: hex decode into a vector, format through a stringstream, swap bytes
+std::string legacy_str_swap(const std::string &val) {
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < val.length(); i += 2)
+        data.push_back(static_cast<uint8_t>(strtol(val.substr(i, 2).c_str(), nullptr, 16)));
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(4) << std::setfill('0') << CRC16::update_bytewise(0, data.data(), data.size());
+    std::string crc_str = ss.str();
+    return crc_str.substr(2) + crc_str.substr(0, 2);
+}
+
+bool check_kernels(std::mt19937 &rng) {
+    std::vector<uint8_t> buf(1024 + 16);
+    for (auto &b : buf) b = static_cast<uint8_t>(rng());
+
+    for (int i = 0; i < 20000; i++) {
+        size_t len = rng() % 1025;
+        size_t offset = rng() % 16;
+        auto crc = static_cast<uint16_t>(rng());
+        const uint8_t *data = buf.data() + offset;
+
+        uint16_t expected = CRC16::update_bytewise(crc, data, len);
+        if (CRC16::update_slice8(crc, data, len) != expected ||
+            CRC16::update(crc, data, len) != expected ||
+            (CRC16::has_clmul() && CRC16::update_clmul(crc, data, len) != expected)) {
+            std::printf("kernel mismatch: len=%zu offset=%zu init=0x%04x\n", len, offset, crc);
+            return false;
+        }
+    }
+
+    // The string wrapper must still produce the bytes SIYI expects
+    for (int i = 0; i < 2000; i++) {
+        std::string hex;
+        size_t len = rng() % 80;
+        for (size_t j = 0; j < len; j++) {
+            char byte[3];
+            std::snprintf(byte, sizeof(byte), "%02x", static_cast<unsigned>(rng() & 0xff));
+            hex += byte;
+        }
+        if (CRC16::compute_str_swap(hex) != legacy_str_swap(hex)) {
+            std::printf("compute_str_swap mismatch for %s\n", hex.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(1234);
+    if (!check_kernels(rng)) return EXIT_FAILURE;
+    std::printf("kernels agree with the bytewise reference (clmul %s)\n",
+                CRC16::has_clmul() ? "available" : "not available");
+
+    // SIYI frames are 10..42 bytes, larger sizes show the folding kernel's throughput
+    for (size_t len : {10, 42, 256, 4096}) {
+        std::vector<uint8_t> data(len);
+        for (auto &b : data) b = static_cast<uint8_t>(rng());
+        size_t iterations = 40000000 / (len + 16);
+
+        std::printf("\n%zu bytes\n", len);
+        double bytewise = time_per_op_ns(iterations, [&] {
+            do_not_optimize(CRC16::update_bytewise(0, data.data(), data.size()));
+        });
+        print_result("bytewise", bytewise);
+        print_result("slice-by-8", time_per_op_ns(iterations, [&] {
+            do_not_optimize(CRC16::update_slice8(0, data.data(), data.size()));
+        }), bytewise);
+        if (CRC16::has_clmul() && len >= 32)
+            print_result("pclmul fold", time_per_op_ns(iterations, [&] {
+                do_not_optimize(CRC16::update_clmul(0, data.data(), data.size()));
+            }), bytewise);
+        print_result("dispatched update()", time_per_op_ns(iterations, [&] {
+            do_not_optimize(CRC16::update(0, data.data(), data.size()));
+        }), bytewise);
+    }
+
+    std::string frame_hex = "556601040000000e0000ff";
+    std::printf("\nhex string frame\n");
+    double legacy = time_per_op_ns(500000, [&] { do_not_optimize(legacy_str_swap(frame_hex)); });
+    print_result("legacy compute_str_swap", legacy);
+    print_result("compute_str_swap", time_per_op_ns(500000, [&] {
+        do_not_optimize(CRC16::compute_str_swap(frame_hex));
+    }), legacy);
+    return EXIT_SUCCESS;
+}
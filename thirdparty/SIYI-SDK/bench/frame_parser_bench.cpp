@@ -0,0 +1,163 @@
+// Replays captured SIYI datagrams through the legacy hex string receive path and the frame parser
+//
+// Usage: siyi-frame-parser-bench [capture.txt]
+// The capture file holds one received datagram per line as hex bytes (whitespace allowed, '#' starts
+// a comment). Without a capture, one second of synthetic telemetry at 100 Hz is replayed.
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "sdk.h"
+
+namespace {
+
+using Datagram = std::vector<uint8_t>;
+
+std::vector<Datagram> load_capture(const char *path) {
+    std::vector<Datagram> capture;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::string hex;
+        for (char c: line)
+            if (!std::isspace(static_cast<unsigned char>(c))) hex += c;
+        if (hex.empty()) continue;
+
+        Datagram datagram;
+        for (size_t i = 0; i + 1 < hex.length(); i += 2)
+            datagram.push_back(static_cast<uint8_t>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+        capture.push_back(datagram);
+    }
+    return capture;
+}
+
+void append(Datagram &datagram, const SIYI_Packet &packet) {
+    datagram.insert(datagram.end(), packet.bytes, packet.bytes + packet.size);
+}
+
+// One second of gimbal telemetry as the SDK sees it: attitude replies at 100 Hz, the 1 Hz info
+// replies, some replies coalesced into one datagram and the odd burst of line noise
+std::vector<Datagram> synthetic_capture() {
+    SIYI_Message codec;
+    std::vector<Datagram> capture;
+
+    const uint8_t firmware[] = {0x6e, 0x03, 0x01, 0x00, 0x2c, 0x02, 0x03, 0x00, 0x10, 0x05, 0x05, 0x00};
+    const uint8_t hardware_id[] = {0x37, 0x33, 0x41, 0x42, 0x43, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+    const uint8_t gimbal_info[] = {0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00};
+    const uint8_t zoom[] = {0x1e, 0x00};
+
+    for (int i = 0; i < 100; i++) {
+        int16_t yaw = int16_t(i * 13 - 600), pitch = int16_t(-i * 3), roll = int16_t(i % 7);
+        const uint8_t attitude[] = {uint8_t(yaw & 0xff), uint8_t(yaw >> 8), uint8_t(pitch & 0xff), uint8_t(pitch >> 8),
+                                    uint8_t(roll & 0xff), uint8_t(roll >> 8), 0x10, 0x00, 0xf0, 0xff, 0x00, 0x00};
+        SIYI_Packet packet;
+        codec.encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, attitude, sizeof(attitude), packet);
+
+        Datagram datagram;
+        if (i % 25 == 3) datagram.insert(datagram.end(), {0x00, 0x13, 0x55, 0x01});
+        append(datagram, packet);
+
+        if (i == 10) {
+            codec.encode_packet(CMD_ACQUIRE_FIRMWARE_VERSION, firmware, sizeof(firmware), packet);
+            append(datagram, packet);
+            codec.encode_packet(CMD_ACQUIRE_GIMBAL_INFO, gimbal_info, sizeof(gimbal_info), packet);
+            append(datagram, packet);
+        } else if (i == 20) {
+            codec.encode_packet(CMD_ACQUIRE_HARDWARE_ID, hardware_id, sizeof(hardware_id), packet);
+            append(datagram, packet);
+        } else if (i % 10 == 5) {
+            codec.encode_packet(CMD_MANUAL_ZOOM, zoom, sizeof(zoom), packet);
+            append(datagram, packet);
+        }
+        capture.push_back(datagram);
+    }
+    return capture;
+}
+
+// The receive path as it was before the frame parser, minus the socket read
+void legacy_receive(SIYI_SDK &sdk, const Datagram &datagram) {
+    std::stringstream ss;
+    ss << std::hex << std::uppercase << std::setfill('0');
+    for (uint8_t byte: datagram) ss << std::setw(2) << (int) byte;
+
+    std::string buff_str = ss.str();
+    for (char &i: buff_str) i = char(tolower(i));
+
+    const size_t minimum_length = 20;
+    while (buff_str.length() >= minimum_length) {
+        if (buff_str.substr(0, 4) != "5566") {
+            buff_str = buff_str.substr(2);
+            continue;
+        }
+
+        int data_len = std::stoi(buff_str.substr(8, 2) + buff_str.substr(6, 2), nullptr, 16);
+        if (buff_str.length() < minimum_length + data_len * 2) break;
+
+        std::string packet = buff_str.substr(0, minimum_length + data_len * 2);
+        buff_str = buff_str.substr(minimum_length + data_len * 2);
+
+        std::tuple<std::string, int, std::string, int> decoded = sdk.msg.decode_msg(packet);
+        if (std::get<0>(decoded).empty()) continue;
+
+        const std::string &data = std::get<0>(decoded);
+        const std::string &cmd_id = std::get<2>(decoded);
+        int seq = std::get<3>(decoded);
+        if (cmd_id == ACQUIRE_GIMBAL_ATTITUDE) sdk.parse_gimbal_attitude_msg(data, seq);
+        else if (cmd_id == ACQUIRE_GIMBAL_INFO) sdk.parse_gimbal_info_msg(data, seq);
+        else if (cmd_id == MANUAL_ZOOM) sdk.parse_manual_zoom_msg(data, seq);
+        else if (cmd_id == ACQUIRE_FIRMWARE_VERSION) sdk.parse_firmware_version_msg(data, seq);
+        else if (cmd_id == ACQUIRE_HARDWARE_ID) sdk.parse_hardware_id_msg(data, seq);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<Datagram> capture = argc > 1 ? load_capture(argv[1]) : synthetic_capture();
+    if (capture.empty()) {
+        std::printf("no datagrams to replay\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t total_bytes = 0;
+    for (const Datagram &datagram: capture) total_bytes += datagram.size();
+
+    // Nothing listens on the discard port, and with the periodic requests off nothing ever arrives
+    // on the SDK's socket, so only this thread feeds its parser
+    SIYI_SDK sdk("127.0.0.1", 9);
+    for (uint8_t cmd_id: {CMD_ACQUIRE_GIMBAL_ATTITUDE, CMD_ACQUIRE_GIMBAL_INFO, CMD_ACQUIRE_FIRMWARE_VERSION,
+                          CMD_ACQUIRE_HARDWARE_ID})
+        sdk.set_request_rate(cmd_id, 0.);
+
+    // The frame parser must see every frame the capture holds
+    SIYI_FrameParser parser;
+    uint64_t frames = 0;
+    for (const Datagram &datagram: capture) {
+        parser.push(datagram.data(), datagram.size());
+        SIYI_Frame frame;
+        while (parser.next(frame)) frames++;
+    }
+    std::printf("replaying %zu datagrams, %zu bytes, %llu frames (%llu bytes skipped, %llu CRC errors)\n",
+                capture.size(), total_bytes, (unsigned long long) frames,
+                (unsigned long long) parser.stats().skipped_bytes, (unsigned long long) parser.stats().crc_errors);
+
+    const size_t iterations = 200;
+    double legacy = time_per_op_ns(iterations, [&] {
+        for (const Datagram &datagram: capture) legacy_receive(sdk, datagram);
+    });
+    double streaming = time_per_op_ns(iterations, [&] {
+        for (const Datagram &datagram: capture) sdk.handle_datagram(datagram.data(), datagram.size());
+    });
+
+    std::printf("per datagram, including dispatch to parse_* handlers\n");
+    print_result("hex string slicing", legacy / double(capture.size()));
+    print_result("frame parser", streaming / double(capture.size()), legacy / double(capture.size()));
+    std::printf("throughput: %.1f MB/s legacy, %.1f MB/s frame parser\n",
+                double(total_bytes) * 1e3 / legacy, double(total_bytes) * 1e3 / streaming);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+// Checks LatencyHistogram percentiles against exact ones and measures the cost of recording
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "latency_histogram.h"
+
+namespace {
+
+// Round trips in microseconds: a few ms over the link with a long tail of retransmits and stalls
+std::vector<uint64_t> sample_latencies(size_t count, std::mt19937 &rng) {
+    std::lognormal_distribution<double> link(std::log(3000.), 0.4);
+    std::exponential_distribution<double> stall(1. / 40000.);
+    std::uniform_real_distribution<double> chance(0., 1.);
+
+    std::vector<uint64_t> values(count);
+    for (uint64_t &value: values) {
+        double us = link(rng);
+        if (chance(rng) < 0.02) us += stall(rng);
+        value = static_cast<uint64_t>(us);
+    }
+    return values;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<uint64_t> values = sample_latencies(200000, rng);
+
+    LatencyHistogram histogram;
+    for (uint64_t value: values) histogram.record(value);
+
+    std::vector<uint64_t> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Reported percentiles are the top of a bucket, never below the exact value and at most 1/16 above
+    bool ok = histogram.count() == values.size() && histogram.max() == sorted.back() && histogram.min() == sorted.front();
+    std::printf("percentile      exact   histogram\n");
+    for (double percentile: {50., 90., 99., 99.9, 100.}) {
+        size_t rank = std::max<size_t>(size_t(std::ceil(percentile / 100. * double(sorted.size()))), 1) - 1;
+        uint64_t exact = sorted[rank];
+        uint64_t reported = histogram.value_at_percentile(percentile);
+        bool within = reported >= exact && double(reported - exact) <= double(exact) / 16. + 1.;
+        ok = ok && within;
+        std::printf("  %6.1f %10llu  %10llu%s\n", percentile, (unsigned long long) exact,
+                    (unsigned long long) reported, within ? "" : "  <- out of bounds");
+    }
+    if (!ok) return EXIT_FAILURE;
+
+    size_t i = 0;
+    std::printf("\n");
+    print_result("record()", time_per_op_ns(10000000, [&] {
+        histogram.record(values[i++ % values.size()]);
+    }));
+    print_result("value_at_percentile(99)", time_per_op_ns(100000, [&] {
+        do_not_optimize(histogram.value_at_percentile(99.));
+    }));
+    return EXIT_SUCCESS;
+}
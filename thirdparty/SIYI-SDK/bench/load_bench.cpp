@@ -0,0 +1,106 @@
+// Drives SIYI_SDK against the simulator at increasing command rates
+//
+// Usage: siyi-load-bench [latency-ms] [jitter-ms] [loss]
+// Each round issues acknowledged commands (absolute zoom and gimbal angles, alternating) at a fixed
+// rate for one second, on top of the SDK's own 100 Hz attitude requests, and reports how many were
+// answered and how long the answers took.
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "sdk.h"
+#include "simulator.h"
+
+namespace {
+
+struct Round {
+    double issued_per_s;
+    double replies_per_s;
+    uint64_t timeouts;
+    uint64_t direct_sends;
+    double p50_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+Round run_round(SIYI_SDK &sdk, int rate, std::chrono::milliseconds duration) {
+    sdk.reset_command_latencies();
+    SIYI_SDK::TxStats before = sdk.get_tx_stats();
+
+    // Sleeps are coarse, so each wake-up issues whatever the rate calls for by then
+    uint64_t issued = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= duration) break;
+        auto due = uint64_t(std::chrono::duration<double>(elapsed).count() * rate);
+        for (; issued < due; issued++) {
+            if (issued % 2) sdk.set_absolute_zoom(int(issued % 30) + 1, int(issued % 10));
+            else sdk.set_gimbal_angles(float(issued % 90) - 45.f, -float(issued % 60));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Let the last replies arrive and the stragglers time out
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+    Round round{};
+    double seconds = std::chrono::duration<double>(duration).count();
+    round.issued_per_s = double(issued) / seconds;
+
+    for (uint8_t cmd_id: {CMD_ABSOLUTE_ZOOM, CMD_CONTROL_ANGLE}) {
+        SIYI_SDK::CommandLatency latency = sdk.get_command_latency(cmd_id);
+        round.replies_per_s += double(latency.replies) / seconds;
+        round.timeouts += latency.timeouts;
+        round.p50_ms = std::max(round.p50_ms, latency.p50_ms);
+        round.p99_ms = std::max(round.p99_ms, latency.p99_ms);
+        round.max_ms = std::max(round.max_ms, latency.max_ms);
+    }
+    round.direct_sends = sdk.get_tx_stats().direct_sends - before.direct_sends;
+    return round;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    SIYI_Simulator::Config config;
+    config.port = 0;
+    config.latency_us = int((argc > 1 ? std::atof(argv[1]) : 2.) * 1000.);
+    config.jitter_us = int((argc > 2 ? std::atof(argv[2]) : 0.5) * 1000.);
+    config.loss = argc > 3 ? std::atof(argv[3]) : 0.005;
+
+    SIYI_Simulator simulator(config);
+    if (!simulator.start()) return EXIT_FAILURE;
+
+    SIYI_SDK sdk("127.0.0.1", simulator.port());
+    sdk.set_ack_timeout(250);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::printf("simulated link: %.1f ms latency, +-%.1f ms jitter, %.1f %% loss\n\n", config.latency_us / 1000.,
+                config.jitter_us / 1000., config.loss * 100.);
+    std::printf("  %10s %10s %9s %8s %8s %8s %8s\n", "issued/s", "acked/s", "timeouts", "direct", "p50 ms",
+                "p99 ms", "max ms");
+
+    bool answered = true;
+    for (int rate: {20, 50, 100, 200, 500, 1000, 2000, 4000}) {
+        Round round = run_round(sdk, rate, std::chrono::milliseconds(1000));
+        std::printf("  %10.0f %10.0f %9llu %8llu %8.2f %8.2f %8.2f\n", round.issued_per_s, round.replies_per_s,
+                    (unsigned long long) round.timeouts, (unsigned long long) round.direct_sends, round.p50_ms,
+                    round.p99_ms, round.max_ms);
+        if (round.replies_per_s == 0.) answered = false;
+    }
+
+    SIYI_SDK::CommandLatency attitude = sdk.get_command_latency(CMD_ACQUIRE_GIMBAL_ATTITUDE);
+    std::printf("\nattitude requests during the last round: %llu sent, %llu answered, p50 %.2f ms, p99 %.2f ms\n",
+                (unsigned long long) attitude.sent, (unsigned long long) attitude.replies, attitude.p50_ms,
+                attitude.p99_ms);
+
+    sdk.stop();
+    simulator.stop();
+    SIYI_Simulator::Stats stats = simulator.stats();
+    std::printf("simulator: %llu requests, %llu replies, %llu dropped\n", (unsigned long long) stats.requests,
+                (unsigned long long) stats.replies, (unsigned long long) stats.dropped);
+
+    // With the simulator on the same host every round must get answers
+    return answered ? EXIT_SUCCESS : EXIT_FAILURE;
+}
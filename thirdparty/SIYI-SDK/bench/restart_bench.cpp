@@ -0,0 +1,91 @@
+// Restarts SIYI_SDK against the simulator and checks that nothing is left behind
+//
+// Usage: siyi-restart-bench [restarts]
+// Every cycle connects, sends a few commands, parks a thread in the legacy receive loop the way
+// older callers do, then tears everything down. Threads and file descriptors are counted from /proc
+// before and after, any growth means a restart leaks.
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <thread>
+
+#include "latency_histogram.h"
+#include "sdk.h"
+#include "simulator.h"
+
+namespace {
+
+size_t count_entries(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir == nullptr) return 0;
+    size_t count = 0;
+    while (struct dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.') count++;
+    closedir(dir);
+    return count;
+}
+
+size_t thread_count() { return count_entries("/proc/self/task"); }
+
+// The directory stream itself holds one descriptor while it is read, the same for every call
+size_t fd_count() { return count_entries("/proc/self/fd"); }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int restarts = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    SIYI_Simulator::Config config;
+    config.port = 0;
+    SIYI_Simulator simulator(config);
+    if (!simulator.start()) return EXIT_FAILURE;
+
+    // Silence the SDK's connect/close messages, a thousand of each say nothing
+    std::streambuf *cout_buffer = std::cout.rdbuf(nullptr);
+
+    size_t threads_before = thread_count();
+    size_t fds_before = fd_count();
+
+    LatencyHistogram stop_us;
+    LatencyHistogram cycle_us;
+    for (int i = 0; i < restarts; i++) {
+        auto cycle_start = std::chrono::steady_clock::now();
+        auto sdk = std::make_unique<SIYI_SDK>("127.0.0.1", simulator.port());
+        sdk->request_firmware_version();
+        sdk->set_gimbal_speed(i % 50, -(i % 50));
+        sdk->set_absolute_zoom(i % 30 + 1, 0);
+
+        bool connected = true;
+        std::thread legacy([&] { sdk->receive_message_loop(connected); });
+
+        auto stop_start = std::chrono::steady_clock::now();
+        sdk->stop();
+        legacy.join();
+        sdk.reset();
+        auto end = std::chrono::steady_clock::now();
+
+        stop_us.record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(end - stop_start).count()));
+        cycle_us.record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(end - cycle_start).count()));
+    }
+
+    size_t threads_after = thread_count();
+    size_t fds_after = fd_count();
+    std::cout.rdbuf(cout_buffer);
+
+    simulator.stop();
+    SIYI_Simulator::Stats stats = simulator.stats();
+
+    std::printf("%d restarts, simulator saw %llu requests\n", restarts, (unsigned long long) stats.requests);
+    std::printf("  %-22s p50 %6llu us  p99 %6llu us  max %6llu us\n", "stop + join",
+                (unsigned long long) stop_us.value_at_percentile(50.),
+                (unsigned long long) stop_us.value_at_percentile(99.), (unsigned long long) stop_us.max());
+    std::printf("  %-22s p50 %6llu us  p99 %6llu us  max %6llu us\n", "construct to destroyed",
+                (unsigned long long) cycle_us.value_at_percentile(50.),
+                (unsigned long long) cycle_us.value_at_percentile(99.), (unsigned long long) cycle_us.max());
+    std::printf("  threads %zu -> %zu, file descriptors %zu -> %zu\n", threads_before, threads_after, fds_before,
+                fds_after);
+
+    bool leaked = threads_after > threads_before || fds_after > fds_before;
+    if (leaked) std::printf("restarts leaked threads or file descriptors\n");
+    return leaked || stats.requests == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+// Reads the gimbal telemetry snapshot while another thread feeds attitude replies into the SDK
+//
+// Every reply carries yaw = -pitch = roll, so a torn snapshot would show up as a mismatch.
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "sdk.h"
+
+namespace {
+
+std::vector<SIYI_Packet> attitude_replies() {
+    SIYI_Message codec;
+    std::vector<SIYI_Packet> replies;
+    for (int i = 0; i < 1000; i++) {
+        auto angle = int16_t(i - 500);
+        auto pitch = int16_t(-angle);
+        // The SDK reverses yaw, so send -angle to read back angle
+        const uint8_t attitude[] = {uint8_t(pitch & 0xff), uint8_t(pitch >> 8), uint8_t(pitch & 0xff), uint8_t(pitch >> 8),
+                                    uint8_t(angle & 0xff), uint8_t(angle >> 8), uint8_t(angle & 0xff), uint8_t(angle >> 8),
+                                    uint8_t(angle & 0xff), uint8_t(angle >> 8), uint8_t(angle & 0xff), uint8_t(angle >> 8)};
+        SIYI_Packet packet;
+        codec.encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, attitude, sizeof(attitude), packet);
+        replies.push_back(packet);
+    }
+    return replies;
+}
+
+bool consistent(const SIYI_SDK::GimbalTelemetry &telemetry) {
+    return telemetry.yaw == -telemetry.pitch && telemetry.yaw == telemetry.roll &&
+           telemetry.yaw == telemetry.yaw_speed && telemetry.yaw == telemetry.pitch_speed &&
+           telemetry.yaw == telemetry.roll_speed;
+}
+
+} // namespace
+
+int main() {
+    // No periodic requests: only the writer thread below feeds the parser
+    SIYI_SDK sdk("127.0.0.1", 9);
+    for (uint8_t cmd_id: {CMD_ACQUIRE_GIMBAL_ATTITUDE, CMD_ACQUIRE_GIMBAL_INFO, CMD_ACQUIRE_FIRMWARE_VERSION,
+                          CMD_ACQUIRE_HARDWARE_ID})
+        sdk.set_request_rate(cmd_id, 0.);
+
+    const std::vector<SIYI_Packet> replies = attitude_replies();
+    const size_t iterations = 2000000;
+
+    std::printf("get_telemetry() per call\n");
+    double idle = time_per_op_ns(iterations, [&] { do_not_optimize(sdk.get_telemetry()); });
+    print_result("no writer", idle);
+
+    // Same copy behind a mutex the writer also takes, as a lock-based snapshot would be
+    std::mutex baseline_mutex;
+    SIYI_SDK::GimbalTelemetry baseline{};
+
+    std::atomic<bool> writing{true};
+    std::atomic<uint64_t> written{0};
+    std::thread writer([&] {
+        for (size_t i = 0; writing; i++) {
+            const SIYI_Packet &packet = replies[i % replies.size()];
+            sdk.handle_datagram(packet.bytes, packet.size);
+            {
+                std::lock_guard<std::mutex> lock(baseline_mutex);
+                baseline.sequence++;
+            }
+            written++;
+        }
+    });
+
+    uint64_t torn = 0;
+    uint64_t last_sequence = 0;
+    uint64_t regressions = 0;
+    double loaded = time_per_op_ns(iterations, [&] {
+        SIYI_SDK::GimbalTelemetry telemetry = sdk.get_telemetry();
+        if (!consistent(telemetry)) torn++;
+        if (telemetry.sequence < last_sequence) regressions++;
+        last_sequence = telemetry.sequence;
+    });
+    double locked = time_per_op_ns(iterations, [&] {
+        std::lock_guard<std::mutex> lock(baseline_mutex);
+        do_not_optimize(baseline);
+    });
+
+    writing = false;
+    writer.join();
+
+    print_result("concurrent writer, mutex copy", locked);
+    print_result("concurrent writer, seqlock", loaded, locked);
+    std::printf("%llu updates written, %llu torn snapshots, %llu sequence regressions\n",
+                (unsigned long long) written.load(), (unsigned long long) torn, (unsigned long long) regressions);
+
+    return torn == 0 && regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+// Compares the compile-time packet templates with the generic binary encoder and the hex string codec
+#include <cstdlib>
+#include <cstring>
+
+#include "bench_util.h"
+#include "message.h"
+#include "message_templates.h"
+
+namespace {
+
+bool same_bytes(const SIYI_Packet &a, const SIYI_Packet &b) {
+    return a.size == b.size && std::memcmp(a.bytes, b.bytes, a.size) == 0;
+}
+
+// Every speed pair, zoom level and a sweep of angles must encode exactly as encode_packet() does,
+// across the full 16-bit sequence range
+bool check_templates() {
+    SIYI_Message generic;
+    SIYI_Message templated;
+    SIYI_Packet expected;
+
+    for (int yaw = -100; yaw <= 100; yaw++) {
+        for (int pitch = -100; pitch <= 100; pitch++) {
+            const uint8_t data[] = {static_cast<uint8_t>(yaw & 0xff), static_cast<uint8_t>(pitch & 0xff)};
+            generic.encode_packet(CMD_GIMBAL_ROTATION, data, sizeof(data), expected);
+            if (!same_bytes(expected, templated.gimbal_speed_packet(yaw, pitch))) {
+                std::printf("gimbal speed mismatch at %d, %d\n", yaw, pitch);
+                return false;
+            }
+        }
+    }
+
+    for (int integer = 1; integer <= 30; integer++) {
+        for (int fractional = 0; fractional <= 9; fractional++) {
+            const uint8_t data[] = {static_cast<uint8_t>(integer), static_cast<uint8_t>(fractional)};
+            generic.encode_packet(CMD_ABSOLUTE_ZOOM, data, sizeof(data), expected);
+            if (!same_bytes(expected, templated.absolute_zoom_packet(integer, fractional))) {
+                std::printf("absolute zoom mismatch at %d.%d\n", integer, fractional);
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < 30000; i++) {
+        float yaw = float(i % 2701) / 10.f - 135.f;
+        float pitch = float(i % 1151) / 10.f - 90.f;
+        auto control_yaw = static_cast<int16_t>(-yaw * 10);
+        auto control_pitch = static_cast<int16_t>(pitch * 10);
+        const uint8_t data[] = {static_cast<uint8_t>(control_yaw & 0xff), static_cast<uint8_t>((control_yaw >> 8) & 0xff),
+                                static_cast<uint8_t>(control_pitch & 0xff),
+                                static_cast<uint8_t>((control_pitch >> 8) & 0xff)};
+        generic.encode_packet(CMD_CONTROL_ANGLE, data, sizeof(data), expected);
+        if (!same_bytes(expected, templated.gimbal_angles_packet(yaw, pitch))) {
+            std::printf("gimbal angles mismatch at %.1f, %.1f\n", yaw, pitch);
+            return false;
+        }
+
+        generic.encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, nullptr, 0, expected);
+        if (!same_bytes(expected, templated.gimbal_attitude_packet())) {
+            std::printf("gimbal attitude mismatch at iteration %d\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    if (!check_templates()) return EXIT_FAILURE;
+    std::printf("templates match encode_packet() for all checked commands\n");
+
+    const size_t iterations = 2000000;
+    SIYI_Message codec;
+    int i = 0;
+
+    std::printf("\ngimbal speed command\n");
+    double strings = time_per_op_ns(iterations / 20, [&] {
+        i++;
+        do_not_optimize(codec.gimbal_speed_msg(i % 201 - 100, 100 - i % 201));
+    });
+    print_result("hex string (gimbal_speed_msg)", strings);
+    print_result("encode_packet", time_per_op_ns(iterations, [&] {
+        i++;
+        const uint8_t data[] = {static_cast<uint8_t>(i % 201 - 100), static_cast<uint8_t>(100 - i % 201)};
+        SIYI_Packet packet;
+        codec.encode_packet(CMD_GIMBAL_ROTATION, data, sizeof(data), packet);
+        do_not_optimize(packet);
+    }), strings);
+    print_result("template (gimbal_speed_packet)", time_per_op_ns(iterations, [&] {
+        i++;
+        do_not_optimize(codec.gimbal_speed_packet(i % 201 - 100, 100 - i % 201));
+    }), strings);
+
+    std::printf("\ngimbal attitude request\n");
+    strings = time_per_op_ns(iterations / 20, [&] { do_not_optimize(codec.gimbal_attitude_msg()); });
+    print_result("hex string (gimbal_attitude_msg)", strings);
+    print_result("encode_packet", time_per_op_ns(iterations, [&] {
+        SIYI_Packet packet;
+        codec.encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, nullptr, 0, packet);
+        do_not_optimize(packet);
+    }), strings);
+    print_result("template (gimbal_attitude_packet)", time_per_op_ns(iterations, [&] {
+        do_not_optimize(codec.gimbal_attitude_packet());
+    }), strings);
+
+    std::printf("\nabsolute zoom command\n");
+    strings = time_per_op_ns(iterations / 20, [&] {
+        i++;
+        do_not_optimize(codec.absolute_zoom_msg(i % 30 + 1, i % 10));
+    });
+    print_result("hex string (absolute_zoom_msg)", strings);
+    print_result("template (absolute_zoom_packet)", time_per_op_ns(iterations, [&] {
+        i++;
+        do_not_optimize(codec.absolute_zoom_packet(i % 30 + 1, i % 10));
+    }), strings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+// Drives the SDK's transmit path like the UI does and reports what reaches the socket
+//
+// A local UDP socket stands in for the gimbal. While the reactor sends its periodic requests, a
+// control thread updates the gimbal speed at joystick event rate and asks for zoom now and then.
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <fcntl.h>
+
+#include "sdk.h"
+
+int main() {
+    const int port = 47261;
+    int gimbal = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = htons(port);
+    int rcvbuf = 4 << 20;
+    setsockopt(gimbal, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (gimbal < 0 || bind(gimbal, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        std::printf("cannot bind the stand-in gimbal socket on port %d\n", port);
+        return EXIT_FAILURE;
+    }
+    fcntl(gimbal, F_SETFL, O_NONBLOCK);
+
+    SIYI_SDK sdk("127.0.0.1", port);
+
+    const auto duration = std::chrono::seconds(2);
+    const int speed_updates_per_second = 250;
+    uint64_t requests = 0;
+    int last_yaw = 0;
+    int last_pitch = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; std::chrono::steady_clock::now() - start < duration; i++) {
+        last_yaw = i % 201 - 100;
+        last_pitch = 100 - (i * 7) % 201;
+        sdk.set_gimbal_speed(last_yaw, last_pitch);
+        requests++;
+        if (i % 50 == 0) {
+            sdk.request_zoom_in();
+            requests++;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(1000000 / speed_updates_per_second));
+    }
+    sdk.stop();
+
+    // Without the queue every control call and every periodic request was its own sendto
+    SIYI_SDK::TxStats stats = sdk.get_tx_stats();
+    uint64_t legacy_sends = stats.packets + stats.superseded;
+
+    uint64_t received = 0;
+    uint64_t speed_commands = 0;
+    uint8_t last_speed_data[2] = {0, 0};
+    uint8_t buff[256];
+    ssize_t len;
+    while ((len = recv(gimbal, buff, sizeof(buff), 0)) > 0) {
+        SIYI_Frame frame;
+        if (!SIYI_Message::decode_packet(buff, size_t(len), frame)) continue;
+        received++;
+        if (frame.cmd_id == CMD_GIMBAL_ROTATION && frame.data_len == 2) {
+            speed_commands++;
+            last_speed_data[0] = frame.data[0];
+            last_speed_data[1] = frame.data[1];
+        }
+    }
+    close(gimbal);
+
+    std::printf("%llu control calls in %lld s, %llu packets received (%llu gimbal speed)\n",
+                (unsigned long long) requests, (long long) duration.count(), (unsigned long long) received,
+                (unsigned long long) speed_commands);
+    std::printf("ticks %llu, packets %llu, sendmmsg calls %llu, max batch %u, superseded speed commands %llu, "
+                "direct sends %llu, errors %llu\n",
+                (unsigned long long) stats.ticks, (unsigned long long) stats.packets, (unsigned long long) stats.batches,
+                stats.max_batch, (unsigned long long) stats.superseded, (unsigned long long) stats.direct_sends,
+                (unsigned long long) stats.send_errors);
+    std::printf("reactor syscalls per tick: %.2f average, %u last tick\n",
+                double(stats.syscalls) / double(stats.ticks ? stats.ticks : 1), stats.last_tick_syscalls);
+    std::printf("send syscalls: %llu with one sendto per request, %llu batched (%.1fx fewer)\n",
+                (unsigned long long) legacy_sends, (unsigned long long) stats.batches,
+                double(legacy_sends) / double(stats.batches ? stats.batches : 1));
+
+    // The newest speed must be the last one on the wire
+    if (speed_commands == 0 || int8_t(last_speed_data[0]) != last_yaw || int8_t(last_speed_data[1]) != last_pitch) {
+        std::printf("last gimbal speed on the wire is not the newest one (%d, %d expected)\n", last_yaw, last_pitch);
+        return EXIT_FAILURE;
+    }
+    if (stats.packets + stats.direct_sends < received) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+// Stand-alone SIYI gimbal simulator
+//
+// Usage: siyi-simulator [--bind IP] [--port N] [--latency-ms X] [--jitter-ms X] [--loss P]
+//                       [--telemetry-hz R] [--seed S]
+// Point the SDK (or the application, with an rtsp://127.0.0.1/... URI) at it and stop with Ctrl-C.
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "simulator.h"
+
+namespace {
+
+void usage(const char *name) {
+    std::printf("usage: %s [--bind IP] [--port N] [--latency-ms X] [--jitter-ms X] [--loss P] "
+                "[--telemetry-hz R] [--seed S]\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    SIYI_Simulator::Config config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        const char *value = argv[++i];
+        if (arg == "--bind") config.bind_ip = value;
+        else if (arg == "--port") config.port = std::atoi(value);
+        else if (arg == "--latency-ms") config.latency_us = int(std::atof(value) * 1000.);
+        else if (arg == "--jitter-ms") config.jitter_us = int(std::atof(value) * 1000.);
+        else if (arg == "--loss") config.loss = std::atof(value);
+        else if (arg == "--telemetry-hz") config.telemetry_rate_hz = std::atof(value);
+        else if (arg == "--seed") config.seed = uint32_t(std::strtoul(value, nullptr, 10));
+        else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Signals are taken synchronously below, the simulator thread must not see them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SIYI_Simulator simulator(config);
+    if (!simulator.start()) return EXIT_FAILURE;
+    std::printf("SIYI simulator on %s:%d (latency %.1f ms, jitter %.1f ms, loss %.1f %%, telemetry %.0f Hz)\n",
+                config.bind_ip.c_str(), simulator.port(), config.latency_us / 1000., config.jitter_us / 1000.,
+                config.loss * 100., config.telemetry_rate_hz);
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    simulator.stop();
+
+    SIYI_Simulator::Stats stats = simulator.stats();
+    std::printf("%llu requests, %llu replies, %llu dropped, %llu telemetry pushes, %llu unknown commands\n",
+                (unsigned long long) stats.requests, (unsigned long long) stats.replies,
+                (unsigned long long) stats.dropped, (unsigned long long) stats.telemetry,
+                (unsigned long long) stats.unknown_commands);
+    return EXIT_SUCCESS;
+}
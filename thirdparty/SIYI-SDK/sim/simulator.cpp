@@ -0,0 +1,308 @@
+#include "simulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+
+int64_t monotonic_ns() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void write_int16(uint8_t *data, int value) {
+    auto v = static_cast<int16_t>(value);
+    data[0] = static_cast<uint8_t>(v & 0xff);
+    data[1] = static_cast<uint8_t>((v >> 8) & 0xff);
+}
+
+// Degrees per second at full speed command (100), in tenths as everything else
+constexpr double FULL_SPEED_TENTHS_PER_S = 900.;
+
+} // namespace
+
+SIYI_Simulator::SIYI_Simulator(Config config) : config_(std::move(config)), rng_(config_.seed) {}
+
+SIYI_Simulator::~SIYI_Simulator() {
+    stop();
+}
+
+bool SIYI_Simulator::start() {
+    if (running_) return true;
+
+    sockfd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(config_.bind_ip.c_str());
+    addr.sin_port = htons(config_.port);
+    socklen_t addr_len = sizeof(addr);
+
+    bool ok = sockfd_ >= 0 && epoll_fd_ >= 0 && timer_fd_ >= 0 && wake_fd_ >= 0 &&
+              bind(sockfd_, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+              getsockname(sockfd_, (struct sockaddr *) &addr, &addr_len) == 0;
+    for (int fd: {sockfd_, timer_fd_, wake_fd_}) {
+        if (!ok) break;
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        ok = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+    if (!ok) {
+        std::cout << "Error, simulator failed to bind " << config_.bind_ip << ":" << config_.port << std::endl;
+        for (int *fd: {&sockfd_, &epoll_fd_, &timer_fd_, &wake_fd_}) {
+            if (*fd >= 0) close(*fd);
+            *fd = -1;
+        }
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    int64_t now = monotonic_ns();
+    state_.updated_ns = now;
+    next_telemetry_ns_ = now;
+    arm_timer(now);
+
+    running_ = true;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void SIYI_Simulator::stop() {
+    if (!running_.exchange(false)) return;
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) std::cout << "Error, failed to wake the simulator" << std::endl;
+    if (thread_.joinable()) thread_.join();
+
+    for (int *fd: {&sockfd_, &epoll_fd_, &timer_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+int SIYI_Simulator::port() const {
+    return port_;
+}
+
+SIYI_Simulator::Stats SIYI_Simulator::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+void SIYI_Simulator::run() {
+    struct epoll_event events[4];
+    uint8_t buff[1024];
+
+    while (running_) {
+        int count = epoll_wait(epoll_fd_, events, 4, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "Error, simulator epoll_wait failed" << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            uint64_t value;
+            if (fd == timer_fd_ || fd == wake_fd_) {
+                while (read(fd, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+
+            while (true) {
+                struct sockaddr_in from{};
+                socklen_t from_len = sizeof(from);
+                ssize_t bytes = recvfrom(sockfd_, buff, sizeof(buff), 0, (struct sockaddr *) &from, &from_len);
+                if (bytes <= 0) break;
+
+                // Every datagram stands alone, a partial frame never continues in the next one
+                parser_.reset();
+                parser_.push(buff, size_t(bytes));
+                SIYI_Frame frame;
+                int64_t now = monotonic_ns();
+                while (parser_.next(frame)) handle_request(frame, from, now);
+            }
+        }
+
+        int64_t now = monotonic_ns();
+        send_due_replies(now);
+
+        if (config_.telemetry_rate_hz > 0. && have_client_ && next_telemetry_ns_ <= now) {
+            uint8_t data[12];
+            size_t len = encode_attitude(data);
+            SIYI_Packet packet;
+            SIYI_Message::encode_packet(CMD_ACQUIRE_GIMBAL_ATTITUDE, telemetry_seq_++, data, len, packet);
+            sendto(sockfd_, packet.bytes, packet.size, 0, (struct sockaddr *) &last_client_, sizeof(last_client_));
+            next_telemetry_ns_ = std::max(next_telemetry_ns_ + int64_t(1e9 / config_.telemetry_rate_hz), now);
+
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.telemetry++;
+        }
+        arm_timer(now);
+    }
+}
+
+void SIYI_Simulator::handle_request(const SIYI_Frame &frame, const struct sockaddr_in &from, int64_t now_ns) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.requests++;
+    }
+    last_client_ = from;
+    have_client_ = true;
+    advance_state(now_ns);
+
+    const uint8_t ack[] = {0x01};
+    uint8_t data[12] = {};
+    switch (frame.cmd_id) {
+        case CMD_ACQUIRE_FIRMWARE_VERSION: {
+            const uint8_t firmware[] = {0x6e, 0x03, 0x01, 0x00, 0x2c, 0x02, 0x03, 0x00, 0x10, 0x05, 0x05, 0x00};
+            schedule_reply(frame.cmd_id, frame.seq, firmware, sizeof(firmware), from, now_ns);
+            break;
+        }
+        case CMD_ACQUIRE_HARDWARE_ID: {
+            const uint8_t id[] = {'7', '3', 'S', 'I', 'M', '0', '0', '0', '0', '0', '0', '1'};
+            schedule_reply(frame.cmd_id, frame.seq, id, sizeof(id), from, now_ns);
+            break;
+        }
+        case CMD_AUTOFOCUS:
+        case CMD_MANUAL_FOCUS:
+            schedule_reply(frame.cmd_id, frame.seq, ack, sizeof(ack), from, now_ns);
+            break;
+        case CMD_MANUAL_ZOOM:
+            if (frame.data_len >= 1) {
+                auto direction = static_cast<int8_t>(frame.data[0]);
+                state_.zoom = std::min(300, std::max(10, state_.zoom + (direction > 0) - (direction < 0)));
+            }
+            write_int16(data, state_.zoom);
+            schedule_reply(frame.cmd_id, frame.seq, data, 2, from, now_ns);
+            break;
+        case CMD_ABSOLUTE_ZOOM:
+            if (frame.data_len >= 2) state_.zoom = std::min(300, std::max(10, frame.data[0] * 10 + frame.data[1]));
+            schedule_reply(frame.cmd_id, frame.seq, ack, sizeof(ack), from, now_ns);
+            break;
+        case CMD_ACQUIRE_MAX_ZOOM: {
+            const uint8_t max_zoom[] = {30, 0};
+            schedule_reply(frame.cmd_id, frame.seq, max_zoom, sizeof(max_zoom), from, now_ns);
+            break;
+        }
+        case CMD_GIMBAL_ROTATION:
+            if (frame.data_len >= 2) {
+                state_.yaw_speed = static_cast<int8_t>(frame.data[0]);
+                state_.pitch_speed = static_cast<int8_t>(frame.data[1]);
+            }
+            schedule_reply(frame.cmd_id, frame.seq, ack, sizeof(ack), from, now_ns);
+            break;
+        case CMD_CENTER:
+            state_.yaw = 0.;
+            state_.pitch = 0.;
+            schedule_reply(frame.cmd_id, frame.seq, ack, sizeof(ack), from, now_ns);
+            break;
+        case CMD_ACQUIRE_GIMBAL_INFO:
+            // Recording off, follow mode, normal mounting
+            data[3] = 0;
+            data[4] = 1;
+            data[5] = 0;
+            schedule_reply(frame.cmd_id, frame.seq, data, 8, from, now_ns);
+            break;
+        case CMD_ACQUIRE_GIMBAL_ATTITUDE:
+            schedule_reply(frame.cmd_id, frame.seq, data, encode_attitude(data), from, now_ns);
+            break;
+        case CMD_CONTROL_ANGLE:
+            if (frame.data_len >= 4) {
+                state_.yaw = static_cast<int16_t>(frame.data[0] | (frame.data[1] << 8));
+                state_.pitch = static_cast<int16_t>(frame.data[2] | (frame.data[3] << 8));
+            }
+            write_int16(data, int(state_.yaw));
+            write_int16(data + 2, int(state_.pitch));
+            write_int16(data + 4, 0);
+            schedule_reply(frame.cmd_id, frame.seq, data, 6, from, now_ns);
+            break;
+        case CMD_PHOTO_VIDEO:
+        case CMD_FUNCTION_FEEDBACK_INFO:
+            // The camera does not answer these
+            break;
+        default: {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.unknown_commands++;
+            break;
+        }
+    }
+}
+
+void SIYI_Simulator::schedule_reply(uint8_t cmd_id, uint16_t seq, const uint8_t *data, size_t len,
+                                    const struct sockaddr_in &to, int64_t now_ns) {
+    if (config_.loss > 0. && std::uniform_real_distribution<double>(0., 1.)(rng_) < config_.loss) {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.dropped++;
+        return;
+    }
+
+    int64_t delay_us = config_.latency_us;
+    if (config_.jitter_us > 0)
+        delay_us += std::uniform_int_distribution<int>(-config_.jitter_us, config_.jitter_us)(rng_);
+
+    PendingReply reply{};
+    reply.due_ns = now_ns + std::max<int64_t>(delay_us, 0) * 1000;
+    reply.to = to;
+    SIYI_Message::encode_packet(cmd_id, seq, data, len, reply.packet);
+    pending_.push(reply);
+}
+
+void SIYI_Simulator::send_due_replies(int64_t now_ns) {
+    uint64_t sent = 0;
+    while (!pending_.empty() && pending_.top().due_ns <= now_ns) {
+        const PendingReply &reply = pending_.top();
+        sendto(sockfd_, reply.packet.bytes, reply.packet.size, 0, (struct sockaddr *) &reply.to, sizeof(reply.to));
+        pending_.pop();
+        sent++;
+    }
+    if (sent == 0) return;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.replies += sent;
+}
+
+void SIYI_Simulator::advance_state(int64_t now_ns) {
+    double seconds = double(now_ns - state_.updated_ns) / 1e9;
+    state_.updated_ns = now_ns;
+
+    state_.yaw = std::min(1350., std::max(-1350., state_.yaw + state_.yaw_speed / 100. * FULL_SPEED_TENTHS_PER_S * seconds));
+    state_.pitch = std::min(250., std::max(-900., state_.pitch + state_.pitch_speed / 100. * FULL_SPEED_TENTHS_PER_S * seconds));
+}
+
+size_t SIYI_Simulator::encode_attitude(uint8_t *data) {
+    write_int16(data, int(state_.yaw));
+    write_int16(data + 2, int(state_.pitch));
+    write_int16(data + 4, 0);
+    write_int16(data + 6, int(state_.yaw_speed / 100. * FULL_SPEED_TENTHS_PER_S));
+    write_int16(data + 8, int(state_.pitch_speed / 100. * FULL_SPEED_TENTHS_PER_S));
+    write_int16(data + 10, 0);
+    return 12;
+}
+
+void SIYI_Simulator::arm_timer(int64_t now_ns) {
+    int64_t next = 0;
+    if (!pending_.empty()) next = pending_.top().due_ns;
+    if (config_.telemetry_rate_hz > 0. && have_client_ && (next == 0 || next_telemetry_ns_ < next))
+        next = next_telemetry_ns_;
+
+    struct itimerspec spec{};
+    if (next > 0) {
+        next = std::max(next, now_ns + 1);
+        spec.it_value.tv_sec = next / 1000000000;
+        spec.it_value.tv_nsec = next % 1000000000;
+    }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
@@ -0,0 +1,112 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_parser.h"
+#include "message.h"
+
+// A SIYI gimbal on a UDP socket, for testing SIYI_SDK and its users without the camera.
+// Replies carry the request's sequence number and can be delayed, jittered and dropped. The
+// simulated gimbal turns at the commanded speed and zooms, so attitude and zoom replies move.
+class SIYI_Simulator {
+public:
+    struct Config {
+        std::string bind_ip = "127.0.0.1";
+        int port = 37260;                   // 0 picks a free port, see port()
+        int latency_us = 0;                 // added before every reply
+        int jitter_us = 0;                  // reply latency varies uniformly by +- this much
+        double loss = 0.;                   // probability that a reply is dropped
+        double telemetry_rate_hz = 0.;      // unsolicited attitude pushes to the last client, 0 disables
+        uint32_t seed = 1;
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t replies = 0;
+        uint64_t dropped = 0;
+        uint64_t telemetry = 0;
+        uint64_t unknown_commands = 0;
+    };
+
+    explicit SIYI_Simulator(Config config);
+
+    ~SIYI_Simulator();
+
+    // Bind the socket and start answering, false if the socket cannot be set up
+    bool start();
+
+    void stop();
+
+    [[nodiscard]] int port() const;
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct PendingReply {
+        int64_t due_ns;
+        SIYI_Packet packet;
+        struct sockaddr_in to;
+
+        bool operator>(const PendingReply &other) const { return due_ns > other.due_ns; }
+    };
+
+    // Simulated gimbal state, angles and zoom in the units of the protocol (tenths)
+    struct GimbalState {
+        double yaw = 0.;
+        double pitch = 0.;
+        int yaw_speed = 0;
+        int pitch_speed = 0;
+        int zoom = 10;
+        int zoom_direction = 0;
+        int64_t updated_ns = 0;
+    };
+
+    void run();
+
+    void handle_request(const SIYI_Frame &frame, const struct sockaddr_in &from, int64_t now_ns);
+
+    void schedule_reply(uint8_t cmd_id, uint16_t seq, const uint8_t *data, size_t len,
+                        const struct sockaddr_in &to, int64_t now_ns);
+
+    void send_due_replies(int64_t now_ns);
+
+    void advance_state(int64_t now_ns);
+
+    size_t encode_attitude(uint8_t *data);
+
+    void arm_timer(int64_t now_ns);
+
+    Config config_;
+    GimbalState state_;
+    std::mt19937 rng_;
+    SIYI_FrameParser parser_;
+    std::priority_queue<PendingReply, std::vector<PendingReply>, std::greater<PendingReply>> pending_;
+
+    struct sockaddr_in last_client_{};
+    bool have_client_ = false;
+    int64_t next_telemetry_ns_ = 0;
+    uint16_t telemetry_seq_ = 0;
+
+    int sockfd_ = -1;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int wake_fd_ = -1;
+    int port_ = 0;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    Stats stats_;
+    mutable std::mutex stats_mutex_;
+};
+
+#endif // SIMULATOR_H
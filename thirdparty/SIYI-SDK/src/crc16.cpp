@@ -34,44 +34,202 @@ const uint16_t table[256] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x6
                              0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0xed1, 0x1ef0};
 
 
-uint16_t CRC16::compute_crc16(const std::vector<uint8_t> &data) {
-    uint16_t crc = 0x0;
-    for (uint8_t byte: data) crc = ((crc << 8) & 0xff00) ^ table[((crc >> 8) & 0xff) ^ byte];
-    return crc & 0xffff;
+namespace {
+
+// Polynomial x^16 + x^12 + x^5 + 1 (0x1021), non-reflected, zero initial value
+constexpr uint32_t POLY = 0x11021;
+
+struct SliceTables {
+    uint16_t t[8][256];
+};
+
+// t[k][v] is the CRC of byte v followed by k zero bytes
+constexpr SliceTables make_slice_tables() {
+    SliceTables tables{};
+    for (uint32_t v = 0; v < 256; v++) {
+        uint32_t crc = v << 8;
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ POLY : crc << 1;
+        tables.t[0][v] = static_cast<uint16_t>(crc);
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int v = 0; v < 256; v++) {
+            uint16_t prev = tables.t[k - 1][v];
+            tables.t[k][v] = static_cast<uint16_t>((prev << 8) ^ tables.t[0][prev >> 8]);
+        }
+    }
+    return tables;
 }
 
-std::string CRC16::compute_str_swap(const std::string &val) {
-    std::stringstream ss;
-    std::string crc_str;
+constexpr SliceTables slice = make_slice_tables();
 
-    // Convert given hex string to bytes
-    std::vector<uint8_t> data;
-    for (size_t i = 0; i < val.length(); i += 2) {
-        std::string byte_str = val.substr(i, 2);
-        auto byte = (uint8_t) strtol(byte_str.c_str(), nullptr, 16);
-        data.push_back(byte);
+uint16_t slice8(uint16_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        crc = slice.t[7][(crc >> 8) ^ p[0]] ^ slice.t[6][(crc & 0xff) ^ p[1]] ^
+              slice.t[5][p[2]] ^ slice.t[4][p[3]] ^ slice.t[3][p[4]] ^ slice.t[2][p[5]] ^
+              slice.t[1][p[6]] ^ slice.t[0][p[7]];
+        p += 8;
+        len -= 8;
     }
+    while (len--) crc = static_cast<uint16_t>((crc << 8) ^ slice.t[0][(crc >> 8) ^ *p++]);
+    return crc;
+}
 
-    // Convert CRC integer value to hex string
-    uint16_t crc_int = compute_crc16(data);
-    ss << std::hex << std::setw(4) << std::setfill('0') << crc_int;
-    crc_str = ss.str();
+} // namespace
 
-    // Just a sanity check
-    if (crc_str.length() > 4) {
-        crc_str = "ffff";
-        return crc_str;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC16_HAVE_CLMUL 1
+#include <immintrin.h>
+
+namespace {
+
+// x^n mod P, used as folding constants
+constexpr uint64_t xpow_mod(unsigned n) {
+    uint32_t r = 1;
+    for (unsigned i = 0; i < n; i++) {
+        r <<= 1;
+        if (r & 0x10000) r ^= POLY;
     }
+    return r;
+}
 
-    // Make sure hex string is 4 characters (2 for each byte) with swapped bytes
-    if (crc_str.length() == 3) crc_str = "0" + crc_str;
-    else if (crc_str.length() == 2) crc_str = "00" + crc_str;
-    else if (crc_str.length() == 1) crc_str = "000" + crc_str;
+constexpr uint64_t K_128 = xpow_mod(128);
+constexpr uint64_t K_192 = xpow_mod(192);
+constexpr uint64_t K_512 = xpow_mod(512);
+constexpr uint64_t K_576 = xpow_mod(576);
 
-    // Reverse bytes, according to SIYI built-in SDK
-    std::string low_byte = crc_str.substr(2);
-    std::string high_byte = crc_str.substr(0, 2);
-    crc_str = low_byte + high_byte;
+// Multiply the 128-bit polynomial x by x^distance mod P, where k holds the constants for the
+// high (x^(distance+64)) and low (x^distance) halves. The result is congruent, at most 80 bits wide
+__attribute__((target("pclmul,ssse3")))
+inline __m128i fold(__m128i x, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+// Bytes are loaded big-endian so that bit i of the register is the coefficient of x^i
+__attribute__((target("pclmul,ssse3")))
+inline __m128i load_be(const uint8_t *src) {
+    const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), bswap);
+}
+
+__attribute__((target("pclmul,ssse3")))
+uint16_t clmul_fold(uint16_t crc, const uint8_t *p, size_t len) {
+    if (len < 32) return slice8(crc, p, len);
+
+    const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    // A non-zero starting CRC is the same as XOR-ing it into the first two message bytes
+    __m128i x0 = _mm_xor_si128(load_be(p), _mm_set_epi64x(static_cast<int64_t>(uint64_t(crc) << 48), 0));
+    p += 16;
+    len -= 16;
+
+    // Four independent lanes, each folded forward by 512 bits per iteration
+    if (len >= 112) {
+        const __m128i k512 = _mm_set_epi64x(K_576, K_512);
+        const __m128i k128 = _mm_set_epi64x(K_192, K_128);
+        __m128i x1 = load_be(p);
+        __m128i x2 = load_be(p + 16);
+        __m128i x3 = load_be(p + 32);
+        p += 48;
+        len -= 48;
+        while (len >= 64) {
+            x0 = _mm_xor_si128(fold(x0, k512), load_be(p));
+            x1 = _mm_xor_si128(fold(x1, k512), load_be(p + 16));
+            x2 = _mm_xor_si128(fold(x2, k512), load_be(p + 32));
+            x3 = _mm_xor_si128(fold(x3, k512), load_be(p + 48));
+            p += 64;
+            len -= 64;
+        }
+        x1 = _mm_xor_si128(fold(x0, k128), x1);
+        x2 = _mm_xor_si128(fold(x1, k128), x2);
+        x0 = _mm_xor_si128(fold(x2, k128), x3);
+    }
+
+    const __m128i k128 = _mm_set_epi64x(K_192, K_128);
+    while (len >= 16) {
+        x0 = _mm_xor_si128(fold(x0, k128), load_be(p));
+        p += 16;
+        len -= 16;
+    }
+
+    // The folded value has the CRC of everything consumed so far, finish it and the tail with tables
+    alignas(16) uint8_t rest[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(rest), _mm_shuffle_epi8(x0, bswap));
+    return slice8(slice8(0, rest, sizeof(rest)), p, len);
+}
 
+bool detect_clmul() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+} // namespace
+#endif
+
+uint16_t CRC16::update(uint16_t crc, const uint8_t *data, size_t len) {
+    static const bool use_clmul = has_clmul();
+    if (use_clmul && len >= CLMUL_MIN_LENGTH) return update_clmul(crc, data, len);
+    return slice8(crc, data, len);
+}
+
+uint16_t CRC16::update_bytewise(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) crc = ((crc << 8) & 0xff00) ^ table[((crc >> 8) & 0xff) ^ data[i]];
+    return crc & 0xffff;
+}
+
+uint16_t CRC16::update_slice8(uint16_t crc, const uint8_t *data, size_t len) {
+    return slice8(crc, data, len);
+}
+
+uint16_t CRC16::update_clmul(uint16_t crc, const uint8_t *data, size_t len) {
+#ifdef CRC16_HAVE_CLMUL
+    return clmul_fold(crc, data, len);
+#else
+    return slice8(crc, data, len);
+#endif
+}
+
+bool CRC16::has_clmul() {
+#ifdef CRC16_HAVE_CLMUL
+    static const bool supported = detect_clmul();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint16_t CRC16::compute_crc16(const std::vector<uint8_t> &data) {
+    return compute(data.data(), data.size());
+}
+
+std::string CRC16::compute_str_swap(const std::string &val) {
+    auto nibble = [](char c) -> uint8_t {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return 0;
+    };
+
+    // Decode the hex string in stack-sized chunks and feed them to the byte kernel
+    uint8_t chunk[64];
+    size_t chunk_len = 0;
+    uint16_t crc = 0;
+    for (size_t i = 0; i < val.length(); i += 2) {
+        if (i + 1 < val.length()) chunk[chunk_len++] = static_cast<uint8_t>((nibble(val[i]) << 4) | nibble(val[i + 1]));
+        else chunk[chunk_len++] = nibble(val[i]);
+
+        if (chunk_len == sizeof(chunk)) {
+            crc = update(crc, chunk, chunk_len);
+            chunk_len = 0;
+        }
+    }
+    crc = update(crc, chunk, chunk_len);
+
+    // Low byte first, according to SIYI built-in SDK
+    static const char digits[] = "0123456789abcdef";
+    std::string crc_str(4, '0');
+    crc_str[0] = digits[(crc >> 4) & 0x0f];
+    crc_str[1] = digits[crc & 0x0f];
+    crc_str[2] = digits[(crc >> 12) & 0x0f];
+    crc_str[3] = digits[(crc >> 8) & 0x0f];
     return crc_str;
-}
\ No newline at end of file
+}
@@ -1,14 +1,41 @@
 #ifndef CRC16_H
 #define CRC16_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <iomanip>
+#include <string>
 
 class CRC16 {
 public:
+    // Continue a CRC16 computation over raw bytes, starting from the given CRC value.
+    // Dispatches at runtime to the fastest kernel available on this CPU
+    static uint16_t update(uint16_t crc, const uint8_t *data, size_t len);
+
+    static uint16_t compute(const uint8_t *data, size_t len) { return update(0, data, len); }
+
     static uint16_t compute_crc16(const std::vector<uint8_t> &data);
 
     static std::string compute_str_swap(const std::string &val);
+
+    /////////////
+    // KERNELS //
+    /////////////
+
+    // Reference byte-at-a-time table loop
+    static uint16_t update_bytewise(uint16_t crc, const uint8_t *data, size_t len);
+
+    // Eight table lookups per eight input bytes
+    static uint16_t update_slice8(uint16_t crc, const uint8_t *data, size_t len);
+
+    // Carry-less multiplication folding, only callable when has_clmul() is true
+    static uint16_t update_clmul(uint16_t crc, const uint8_t *data, size_t len);
+
+    static bool has_clmul();
+
+    // Below this many bytes update() always uses the table kernel, folding does not pay off
+    static constexpr size_t CLMUL_MIN_LENGTH = 64;
 };
 
 #endif // CRC16_H
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "frame_parser.h"
+
+#include <cstring>
+
+void SIYI_FrameParser::push(const uint8_t *data, size_t len) {
+    // Only the newest CAPACITY bytes can ever be kept
+    if (len > CAPACITY) {
+        stats_.dropped_bytes += len - CAPACITY;
+        data += len - CAPACITY;
+        len = CAPACITY;
+    }
+
+    size_t free_space = CAPACITY - buffered();
+    if (len > free_space) {
+        stats_.dropped_bytes += len - free_space;
+        consume(len - free_space);
+    }
+
+    // Copy in at most two chunks around the end of the ring
+    size_t pos = tail_ & MASK;
+    size_t first = len < CAPACITY - pos ? len : CAPACITY - pos;
+    std::memcpy(ring_ + pos, data, first);
+    std::memcpy(ring_, data + first, len - first);
+    tail_ += len;
+}
+
+bool SIYI_FrameParser::next(SIYI_Frame &frame) {
+    while (buffered() >= SIYI_Packet::FRAME_OVERHEAD) {
+        // Resynchronize on the header
+        if (at(0) != 0x55 || at(1) != 0x66) {
+            consume(1);
+            stats_.skipped_bytes++;
+            continue;
+        }
+
+        size_t data_len = at(3) | (at(4) << 8);
+        size_t frame_len = SIYI_Packet::FRAME_OVERHEAD + data_len;
+        if (frame_len > MAX_FRAME_SIZE) {
+            // Not a plausible frame, the header bytes were part of something else
+            consume(1);
+            stats_.skipped_bytes++;
+            continue;
+        }
+
+        // Wait for the rest of the frame
+        if (buffered() < frame_len) return false;
+
+        const uint8_t *buf = contiguous(frame_len);
+        uint16_t crc = CRC16::compute(buf, 8 + data_len);
+        uint16_t msg_crc = buf[8 + data_len] | (buf[9 + data_len] << 8);
+        if (crc != msg_crc) {
+            consume(1);
+            stats_.crc_errors++;
+            stats_.skipped_bytes++;
+            continue;
+        }
+
+        frame.seq = static_cast<uint16_t>(buf[5] | (buf[6] << 8));
+        frame.cmd_id = buf[7];
+        frame.data = buf + 8;
+        frame.data_len = data_len;
+        consume(frame_len);
+        stats_.frames++;
+        return true;
+    }
+    return false;
+}
+
+void SIYI_FrameParser::reset() {
+    head_ = tail_ = 0;
+    stats_ = Stats();
+}
+
+const uint8_t *SIYI_FrameParser::contiguous(size_t len) {
+    size_t pos = head_ & MASK;
+    if (pos + len <= CAPACITY) return ring_ + pos;
+
+    size_t first = CAPACITY - pos;
+    std::memcpy(scratch_, ring_ + pos, first);
+    std::memcpy(scratch_ + first, ring_, len - first);
+    return scratch_;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "message.h"
+
+// Incremental SIYI frame parser over a fixed ring buffer. Received bytes are pushed as they arrive,
+// complete frames are located by their 0x55 0x66 header and validated (length and CRC16) in place.
+class SIYI_FrameParser {
+public:
+    static constexpr size_t CAPACITY = 4096;  // must be a power of two
+    static constexpr size_t MAX_FRAME_SIZE = 256;
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t crc_errors = 0;
+        uint64_t skipped_bytes = 0;
+        uint64_t dropped_bytes = 0;
+    };
+
+    // Append received bytes. If the buffer is full the oldest bytes are dropped
+    void push(const uint8_t *data, size_t len);
+
+    // Extract the next valid frame. frame.data stays valid until the next call to push() or next()
+    bool next(SIYI_Frame &frame);
+
+    void reset();
+
+    [[nodiscard]] size_t buffered() const { return tail_ - head_; }
+
+    [[nodiscard]] const Stats &stats() const { return stats_; }
+
+private:
+    static constexpr size_t MASK = CAPACITY - 1;
+    static_assert((CAPACITY & MASK) == 0, "CAPACITY must be a power of two");
+
+    [[nodiscard]] uint8_t at(size_t offset) const { return ring_[(head_ + offset) & MASK]; }
+
+    void consume(size_t len) { head_ += len; }
+
+    // Return a contiguous view of the first len buffered bytes, copying only if they wrap around
+    const uint8_t *contiguous(size_t len);
+
+    uint8_t ring_[CAPACITY]{};
+    uint8_t scratch_[MAX_FRAME_SIZE]{};
+    size_t head_ = 0;  // free-running read position
+    size_t tail_ = 0;  // free-running write position
+    Stats stats_;
+};
+
+#endif // FRAME_PARSER_H
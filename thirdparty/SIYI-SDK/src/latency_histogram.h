@@ -0,0 +1,84 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram in the style of HdrHistogram: each power of two is split into 16 linear
+// buckets, so any recorded value is reported within 1/16 (6.25 %) of its true value. Values are
+// unsigned integers, the SDK records microseconds. Recording is a couple of shifts and an increment.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_MAGNITUDE = 40;  // values up to 2^40, past any sensible latency in microseconds
+    static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + SUB_BUCKETS;
+
+    void record(uint64_t value) {
+        counts_[index_of(value)]++;
+        total_++;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // Smallest value such that the given percentage (0..100) of recordings are at or below it,
+    // reported as the top of its bucket. The exact maximum is returned for 100
+    [[nodiscard]] uint64_t value_at_percentile(double percentile) const {
+        if (total_ == 0) return 0;
+        if (percentile >= 100.) return max_;
+
+        auto target = static_cast<uint64_t>(percentile / 100. * double(total_) + 0.5);
+        target = std::max<uint64_t>(target, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKETS; i++) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    [[nodiscard]] uint64_t count() const { return total_; }
+
+    [[nodiscard]] uint64_t min() const { return total_ ? min_ : 0; }
+
+    [[nodiscard]] uint64_t max() const { return max_; }
+
+    [[nodiscard]] double mean() const { return total_ ? double(sum_) / double(total_) : 0.; }
+
+private:
+    // Values below 2 * SUB_BUCKETS get a bucket each, above that every magnitude has SUB_BUCKETS
+    static size_t index_of(uint64_t value) {
+        if (value < 2 * SUB_BUCKETS) return size_t(value);
+        int magnitude = 63 - __builtin_clzll(value);
+        if (magnitude > MAX_MAGNITUDE) return BUCKETS - 1;
+        int shift = magnitude - SUB_BUCKET_BITS;
+        return size_t(shift) * SUB_BUCKETS + size_t(value >> shift);
+    }
+
+    static uint64_t highest_equivalent(size_t index) {
+        if (index < 2 * SUB_BUCKETS) return index;
+        size_t shift = index / SUB_BUCKETS - 1;
+        uint64_t lowest = (index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+        return lowest + (uint64_t(1) << shift) - 1;
+    }
+
+    uint64_t counts_[BUCKETS]{};
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+#endif // LATENCY_HISTOGRAM_H
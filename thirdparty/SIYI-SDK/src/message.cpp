@@ -1,4 +1,7 @@
 #include "message.h"
+#include "message_templates.h"
+
+#include <cstring>
 
 std::string SIYI_Message::increment_seq(int val) {
     if (val < 0 || val > 65535) {
@@ -282,4 +285,231 @@ std::string SIYI_Message::gimbal_angles_msg(float yaw, float pitch) {
     std::string data = data1 + data2;
     std::string cmd_id = CONTROL_ANGLE;
     return SIYI_Message::encode_msg(data, cmd_id);
-}
\ No newline at end of file
+}
+
+////////////////////////
+//  BINARY CODEC API  //
+////////////////////////
+
+uint16_t SIYI_Message::next_seq() {
+    // Same wrap-around as increment_seq, but safe when several threads send requests
+    int seq = _seq.load(std::memory_order_relaxed);
+    int next;
+    do {
+        next = (seq < 0 || seq >= 65535) ? 0 : seq + 1;
+    } while (!_seq.compare_exchange_weak(seq, next, std::memory_order_relaxed));
+    return static_cast<uint16_t>(next);
+}
+
+bool SIYI_Message::encode_packet(uint8_t cmd_id, const uint8_t *data, size_t data_len, SIYI_Packet &packet) {
+    if (data_len > SIYI_Packet::MAX_DATA_LENGTH) {
+        std::cout << "Warning, data is too long for message encoding" << std::endl;
+        packet.size = 0;
+        return false;
+    }
+    return encode_packet(cmd_id, next_seq(), data, data_len, packet);
+}
+
+bool SIYI_Message::encode_packet(uint8_t cmd_id, uint16_t seq, const uint8_t *data, size_t data_len,
+                                 SIYI_Packet &packet) {
+    if (data_len > SIYI_Packet::MAX_DATA_LENGTH) {
+        std::cout << "Warning, data is too long for message encoding" << std::endl;
+        packet.size = 0;
+        return false;
+    }
+
+    uint8_t *p = packet.bytes;
+
+    // Header and control byte (need ACK)
+    p[0] = 0x55;
+    p[1] = 0x66;
+    p[2] = 0x01;
+
+    // Data length and sequence are little-endian, according to SIYI built-in SDK
+    p[3] = static_cast<uint8_t>(data_len & 0xff);
+    p[4] = static_cast<uint8_t>((data_len >> 8) & 0xff);
+    p[5] = static_cast<uint8_t>(seq & 0xff);
+    p[6] = static_cast<uint8_t>((seq >> 8) & 0xff);
+    p[7] = cmd_id;
+    if (data_len > 0) std::memcpy(p + 8, data, data_len);
+
+    // CRC16 over everything before it, low byte first
+    uint16_t crc = CRC16::compute(p, 8 + data_len);
+    p[8 + data_len] = static_cast<uint8_t>(crc & 0xff);
+    p[9 + data_len] = static_cast<uint8_t>((crc >> 8) & 0xff);
+
+    packet.size = SIYI_Packet::FRAME_OVERHEAD + data_len;
+    return true;
+}
+
+bool SIYI_Message::decode_packet(const uint8_t *buf, size_t len, SIYI_Frame &frame) {
+    if (len < SIYI_Packet::FRAME_OVERHEAD) {
+        std::cout << "Warning, message length is not long enough for decoding" << std::endl;
+        return false;
+    }
+    if (buf[0] != 0x55 || buf[1] != 0x66) return false;
+
+    size_t data_len = buf[3] | (buf[4] << 8);
+    if (len < SIYI_Packet::FRAME_OVERHEAD + data_len) {
+        std::cout << "Warning, message length is not long enough for decoding" << std::endl;
+        return false;
+    }
+
+    uint16_t crc = CRC16::compute(buf, 8 + data_len);
+    uint16_t msg_crc = buf[8 + data_len] | (buf[9 + data_len] << 8);
+    if (crc != msg_crc) {
+        std::cout << "Warning, CRC16 error during message decoding" << std::endl;
+        return false;
+    }
+
+    frame.seq = static_cast<uint16_t>(buf[5] | (buf[6] << 8));
+    frame.cmd_id = buf[7];
+    frame.data = buf + 8;
+    frame.data_len = data_len;
+    return true;
+}
+
+namespace {
+
+// Commands sent at a high rate are encoded from compile-time templates
+constexpr SIYI_PacketTemplate<CMD_ACQUIRE_GIMBAL_ATTITUDE, 0> gimbal_attitude_template;
+constexpr SIYI_PacketTemplate<CMD_GIMBAL_ROTATION, 2> gimbal_speed_template;
+constexpr SIYI_PacketTemplate<CMD_ABSOLUTE_ZOOM, 2> absolute_zoom_template;
+constexpr SIYI_PacketTemplate<CMD_CONTROL_ANGLE, 4> gimbal_angles_template;
+
+} // namespace
+
+SIYI_Packet SIYI_Message::make_packet(uint8_t cmd_id, const uint8_t *data, size_t data_len) {
+    SIYI_Packet packet;
+    encode_packet(cmd_id, data, data_len, packet);
+    return packet;
+}
+
+SIYI_Packet SIYI_Message::firmware_version_packet() {
+    return make_packet(CMD_ACQUIRE_FIRMWARE_VERSION);
+}
+
+SIYI_Packet SIYI_Message::hardware_id_packet() {
+    return make_packet(CMD_ACQUIRE_HARDWARE_ID);
+}
+
+SIYI_Packet SIYI_Message::autofocus_packet() {
+    const uint8_t data[] = {0x01};
+    return make_packet(CMD_AUTOFOCUS, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::zoom_in_packet() {
+    const uint8_t data[] = {0x01};
+    return make_packet(CMD_MANUAL_ZOOM, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::zoom_out_packet() {
+    const uint8_t data[] = {0xff};
+    return make_packet(CMD_MANUAL_ZOOM, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::zoom_halt_packet() {
+    const uint8_t data[] = {0x00};
+    return make_packet(CMD_MANUAL_ZOOM, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::absolute_zoom_packet(int integer, int fractional) {
+    const uint8_t data[] = {static_cast<uint8_t>(integer & 0xff), static_cast<uint8_t>(fractional & 0xff)};
+    SIYI_Packet packet;
+    absolute_zoom_template.encode(next_seq(), data, packet);
+    return packet;
+}
+
+SIYI_Packet SIYI_Message::maximum_zoom_packet() {
+    return make_packet(CMD_ACQUIRE_MAX_ZOOM);
+}
+
+SIYI_Packet SIYI_Message::focus_far_packet() {
+    const uint8_t data[] = {0x01};
+    return make_packet(CMD_MANUAL_FOCUS, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::focus_close_packet() {
+    const uint8_t data[] = {0xff};
+    return make_packet(CMD_MANUAL_FOCUS, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::focus_halt_packet() {
+    const uint8_t data[] = {0x00};
+    return make_packet(CMD_MANUAL_FOCUS, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::gimbal_speed_packet(int yaw_speed, int pitch_speed) {
+    // -100~0~100, sent as signed bytes
+    if (yaw_speed > 100) yaw_speed = 100;
+    else if (yaw_speed < -100) yaw_speed = -100;
+    if (pitch_speed > 100) pitch_speed = 100;
+    else if (pitch_speed < -100) pitch_speed = -100;
+
+    const uint8_t data[] = {static_cast<uint8_t>(yaw_speed & 0xff), static_cast<uint8_t>(pitch_speed & 0xff)};
+    SIYI_Packet packet;
+    gimbal_speed_template.encode(next_seq(), data, packet);
+    return packet;
+}
+
+SIYI_Packet SIYI_Message::gimbal_center_packet() {
+    const uint8_t data[] = {0x01};
+    return make_packet(CMD_CENTER, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::gimbal_info_packet() {
+    return make_packet(CMD_ACQUIRE_GIMBAL_INFO);
+}
+
+SIYI_Packet SIYI_Message::lock_mode_packet() {
+    const uint8_t data[] = {0x03};
+    return make_packet(CMD_PHOTO_VIDEO, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::follow_mode_packet() {
+    const uint8_t data[] = {0x04};
+    return make_packet(CMD_PHOTO_VIDEO, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::fpv_mode_packet() {
+    const uint8_t data[] = {0x05};
+    return make_packet(CMD_PHOTO_VIDEO, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::function_feedback_packet() {
+    return make_packet(CMD_FUNCTION_FEEDBACK_INFO);
+}
+
+SIYI_Packet SIYI_Message::photo_packet() {
+    const uint8_t data[] = {0x00};
+    return make_packet(CMD_PHOTO_VIDEO, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::record_packet() {
+    const uint8_t data[] = {0x02};
+    return make_packet(CMD_PHOTO_VIDEO, data, sizeof(data));
+}
+
+SIYI_Packet SIYI_Message::gimbal_attitude_packet() {
+    SIYI_Packet packet;
+    gimbal_attitude_template.encode(next_seq(), nullptr, packet);
+    return packet;
+}
+
+SIYI_Packet SIYI_Message::gimbal_angles_packet(float yaw, float pitch) {
+    if (yaw > 135.) yaw = 135.;
+    else if (yaw < -135.) yaw = -135.;
+    yaw = -yaw;  // reverse yaw as for some reason it is positive when turning clockwise by default
+    if (pitch > 25.) pitch = 25.;
+    else if (pitch < -90.) pitch = -90.;
+
+    // Angles are int16 in tenths of a degree, little-endian
+    auto control_yaw = static_cast<int16_t>(yaw * 10);
+    auto control_pitch = static_cast<int16_t>(pitch * 10);
+    const uint8_t data[] = {static_cast<uint8_t>(control_yaw & 0xff), static_cast<uint8_t>((control_yaw >> 8) & 0xff),
+                            static_cast<uint8_t>(control_pitch & 0xff),
+                            static_cast<uint8_t>((control_pitch >> 8) & 0xff)};
+    SIYI_Packet packet;
+    gimbal_angles_template.encode(next_seq(), data, packet);
+    return packet;
+}
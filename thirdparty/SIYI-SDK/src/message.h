@@ -1,6 +1,9 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <tuple>
 #include <iostream>
 
@@ -21,6 +24,41 @@
 #define ACQUIRE_GIMBAL_ATTITUDE "0d"
 #define CONTROL_ANGLE "0e"
 
+// Binary command IDs, matching the hex string IDs above
+constexpr uint8_t CMD_ACQUIRE_FIRMWARE_VERSION = 0x01;
+constexpr uint8_t CMD_ACQUIRE_HARDWARE_ID = 0x02;
+constexpr uint8_t CMD_AUTOFOCUS = 0x04;
+constexpr uint8_t CMD_MANUAL_ZOOM = 0x05;
+constexpr uint8_t CMD_MANUAL_FOCUS = 0x06;
+constexpr uint8_t CMD_GIMBAL_ROTATION = 0x07;
+constexpr uint8_t CMD_CENTER = 0x08;
+constexpr uint8_t CMD_ACQUIRE_GIMBAL_INFO = 0x0a;
+constexpr uint8_t CMD_FUNCTION_FEEDBACK_INFO = 0x0b;
+constexpr uint8_t CMD_PHOTO_VIDEO = 0x0c;
+constexpr uint8_t CMD_ACQUIRE_GIMBAL_ATTITUDE = 0x0d;
+constexpr uint8_t CMD_CONTROL_ANGLE = 0x0e;
+constexpr uint8_t CMD_ABSOLUTE_ZOOM = 0x0f;
+constexpr uint8_t CMD_ACQUIRE_MAX_ZOOM = 0x16;
+
+// Encoded packet in wire format, kept on the stack
+struct SIYI_Packet {
+    // header (2) + ctrl (1) + data length (2) + seq (2) + cmd id (1) + data + crc (2)
+    static constexpr size_t FRAME_OVERHEAD = 10;
+    static constexpr size_t MAX_DATA_LENGTH = 32;
+    static constexpr size_t MAX_SIZE = FRAME_OVERHEAD + MAX_DATA_LENGTH;
+
+    uint8_t bytes[MAX_SIZE]{};
+    size_t size = 0;
+};
+
+// Decoded view of a packet; data points into the buffer that was decoded
+struct SIYI_Frame {
+    uint8_t cmd_id = 0;
+    uint16_t seq = 0;
+    const uint8_t *data = nullptr;
+    size_t data_len = 0;
+};
+
 class SIYI_Message {
 public:
     std::string increment_seq(int val);
@@ -79,14 +117,75 @@ public:
 
     std::string gimbal_angles_msg(float yaw, float pitch);
 
+    ////////////////////////
+    //  BINARY CODEC API  //
+    ////////////////////////
+
+    // Encode a packet with the next sequence number, returns false if data does not fit
+    bool encode_packet(uint8_t cmd_id, const uint8_t *data, size_t data_len, SIYI_Packet &packet);
+
+    // Same with an explicit sequence number, e.g. to answer a request with its own
+    static bool encode_packet(uint8_t cmd_id, uint16_t seq, const uint8_t *data, size_t data_len, SIYI_Packet &packet);
+
+    // Validate header, length and CRC of a complete packet and expose its fields without copying
+    static bool decode_packet(const uint8_t *buf, size_t len, SIYI_Frame &frame);
+
+    SIYI_Packet firmware_version_packet();
+
+    SIYI_Packet hardware_id_packet();
+
+    SIYI_Packet autofocus_packet();
+
+    SIYI_Packet zoom_in_packet();
+
+    SIYI_Packet zoom_out_packet();
+
+    SIYI_Packet zoom_halt_packet();
+
+    SIYI_Packet absolute_zoom_packet(int integer, int fractional);
+
+    SIYI_Packet maximum_zoom_packet();
+
+    SIYI_Packet focus_far_packet();
+
+    SIYI_Packet focus_close_packet();
+
+    SIYI_Packet focus_halt_packet();
+
+    SIYI_Packet gimbal_speed_packet(int yaw_speed, int pitch_speed);
+
+    SIYI_Packet gimbal_center_packet();
+
+    SIYI_Packet gimbal_info_packet();
+
+    SIYI_Packet lock_mode_packet();
+
+    SIYI_Packet follow_mode_packet();
+
+    SIYI_Packet fpv_mode_packet();
+
+    SIYI_Packet function_feedback_packet();
+
+    SIYI_Packet photo_packet();
+
+    SIYI_Packet record_packet();
+
+    SIYI_Packet gimbal_attitude_packet();
+
+    SIYI_Packet gimbal_angles_packet(float yaw, float pitch);
+
 private:
+    SIYI_Packet make_packet(uint8_t cmd_id, const uint8_t *data = nullptr, size_t data_len = 0);
+
+    uint16_t next_seq();
+
     std::string HEADER = "5566";
     std::string _ctr = "01";
     std::string _cmd_id = "00";
     std::string _data;
     std::string _crc16 = "0000";
     const int MINIMUM_DATA_LENGTH = 10 * 2;
-    int _seq = 0;
+    std::atomic<int> _seq{0};
 };
 
 #endif // MESSAGE_H
\ No newline at end of file
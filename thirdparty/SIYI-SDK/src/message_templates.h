@@ -0,0 +1,87 @@
+#ifndef MESSAGE_TEMPLATES_H
+#define MESSAGE_TEMPLATES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "message.h"
+
+namespace siyi_template_detail {
+
+// Bitwise CRC16 (poly 0x1021, zero initial value), only used to build tables at compile time
+constexpr uint16_t crc_update(uint16_t crc, uint8_t byte) {
+    crc ^= static_cast<uint16_t>(byte << 8);
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : crc << 1;
+    return crc;
+}
+
+// CRC of one byte followed by the given number of zero bytes
+constexpr uint16_t crc_byte_then_zeros(uint8_t byte, size_t zeros) {
+    uint16_t crc = crc_update(0, byte);
+    for (size_t i = 0; i < zeros; i++) crc = crc_update(crc, 0);
+    return crc;
+}
+
+} // namespace siyi_template_detail
+
+// Pre-encoded frame for a command with a fixed payload length. Header, control byte, length and
+// command ID are laid out at compile time; encode() only patches the sequence and payload bytes.
+//
+// With a zero initial value and no final XOR the CRC is linear over equal-length frames, so the
+// CRC of a frame is the CRC of the template with those bytes zeroed, XOR-ed with one table entry
+// per patched byte: the CRC of that byte alone at its position.
+template<uint8_t CmdId, size_t DataLen>
+class SIYI_PacketTemplate {
+public:
+    static constexpr size_t SIZE = SIYI_Packet::FRAME_OVERHEAD + DataLen;
+    static_assert(DataLen <= SIYI_Packet::MAX_DATA_LENGTH, "payload does not fit in SIYI_Packet");
+
+    constexpr SIYI_PacketTemplate() {
+        base_[0] = 0x55;
+        base_[1] = 0x66;
+        base_[2] = 0x01;
+        base_[3] = static_cast<uint8_t>(DataLen & 0xff);
+        base_[4] = static_cast<uint8_t>((DataLen >> 8) & 0xff);
+        base_[7] = CmdId;
+
+        for (size_t i = 0; i < CRC_LENGTH; i++) base_crc_ = siyi_template_detail::crc_update(base_crc_, base_[i]);
+
+        for (size_t slot = 0; slot < PATCHED; slot++) {
+            size_t zeros = CRC_LENGTH - 1 - offset(slot);
+            for (size_t v = 0; v < 256; v++)
+                contribution_[slot][v] = siyi_template_detail::crc_byte_then_zeros(static_cast<uint8_t>(v), zeros);
+        }
+    }
+
+    void encode(uint16_t seq, const uint8_t *data, SIYI_Packet &packet) const {
+        uint8_t *p = packet.bytes;
+        std::memcpy(p, base_, SIZE);
+
+        p[5] = static_cast<uint8_t>(seq & 0xff);
+        p[6] = static_cast<uint8_t>((seq >> 8) & 0xff);
+        uint16_t crc = base_crc_ ^ contribution_[0][p[5]] ^ contribution_[1][p[6]];
+        for (size_t i = 0; i < DataLen; i++) {
+            p[8 + i] = data[i];
+            crc ^= contribution_[2 + i][data[i]];
+        }
+
+        // Low byte first, as in encode_packet()
+        p[CRC_LENGTH] = static_cast<uint8_t>(crc & 0xff);
+        p[CRC_LENGTH + 1] = static_cast<uint8_t>((crc >> 8) & 0xff);
+        packet.size = SIZE;
+    }
+
+private:
+    static constexpr size_t CRC_LENGTH = SIZE - 2;
+    static constexpr size_t PATCHED = 2 + DataLen;  // sequence (2) + payload
+
+    // Frame offset of a patched byte: sequence at 5..6, payload from 8
+    static constexpr size_t offset(size_t slot) { return slot < 2 ? 5 + slot : 8 + slot - 2; }
+
+    uint8_t base_[SIZE]{};
+    uint16_t base_crc_ = 0;
+    uint16_t contribution_[PATCHED][256]{};
+};
+
+#endif // MESSAGE_TEMPLATES_H
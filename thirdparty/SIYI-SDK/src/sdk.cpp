@@ -1,8 +1,47 @@
 #include "sdk.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+namespace {
+
+int64_t monotonic_ns() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Commands the gimbal answers. Photo/video and function feedback have no reply of their own
+bool expects_reply(uint8_t cmd_id) {
+    switch (cmd_id) {
+        case CMD_ACQUIRE_FIRMWARE_VERSION:
+        case CMD_ACQUIRE_HARDWARE_ID:
+        case CMD_AUTOFOCUS:
+        case CMD_MANUAL_ZOOM:
+        case CMD_MANUAL_FOCUS:
+        case CMD_GIMBAL_ROTATION:
+        case CMD_CENTER:
+        case CMD_ACQUIRE_GIMBAL_INFO:
+        case CMD_ACQUIRE_GIMBAL_ATTITUDE:
+        case CMD_CONTROL_ANGLE:
+        case CMD_ABSOLUTE_ZOOM:
+        case CMD_ACQUIRE_MAX_ZOOM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
 SIYI_SDK::SIYI_SDK(const char *ip_address, const int port) {
-    // Create a UDP socket
-    sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    // Create a UDP socket, the reactor drains it until it would block
+    sockfd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd_ < 0) {
         std::cout << "Error, failed create socket" << std::endl;
         throw std::runtime_error("Failed to create socket");
@@ -13,24 +52,207 @@ SIYI_SDK::SIYI_SDK(const char *ip_address, const int port) {
     server_addr_.sin_addr.s_addr = inet_addr(ip_address);
     server_addr_.sin_port = htons(port);
 
+    // One epoll set for the socket, the request timer and the stop event
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool registered = epoll_fd_ >= 0 && timer_fd_ >= 0 && wake_fd_ >= 0;
+    for (int fd: {sockfd_, timer_fd_, wake_fd_}) {
+        if (!registered) break;
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        registered = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+    if (!registered) {
+        std::cout << "Error, failed to set up the I/O reactor" << std::endl;
+        for (int fd: {sockfd_, epoll_fd_, timer_fd_, wake_fd_})
+            if (fd >= 0) close(fd);
+        throw std::runtime_error("Failed to set up the I/O reactor");
+    }
+
+    // Everything is due right away, then at its own rate
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        int64_t now = monotonic_ns();
+        for (PeriodicRequest &request: schedule_) request.next_due_ns = now;
+        tx_next_tick_ns_ = now;
+        arm_timer();
+    }
+
+    tx_accepting_ = true;
     live = true;
-    gimbal_attitude_thread = std::thread([this] { gimbal_attitude_loop(live); });
-    gimbal_info_thread = std::thread([this] { gimbal_info_loop(live); });
-    receive_message_thread = std::thread([this] { receive_message_loop(live); });
+    reactor_thread_ = std::thread([this] { reactor_loop(); });
     std::cout << "UDP connection established" << std::endl;
 }
 
 SIYI_SDK::~SIYI_SDK() {
-    // Close the socket
-    close(sockfd_);
+    stop();
 
-    live = false;
-    gimbal_attitude_thread.join();
-    gimbal_info_thread.join();
-    receive_message_thread.join();
+    close(epoll_fd_);
+    close(timer_fd_);
+    close(wake_fd_);
+    close(sockfd_);
     std::cout << "UDP connection closed" << std::endl;
 }
 
+void SIYI_SDK::stop() {
+    bool was_live;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        was_live = live.exchange(false);
+    }
+    stop_cv_.notify_all();
+
+    if (was_live) {
+        uint64_t one = 1;
+        if (write(wake_fd_, &one, sizeof(one)) < 0) std::cout << "Error, failed to wake the I/O reactor" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(join_mutex_);
+    if (reactor_thread_.joinable() && reactor_thread_.get_id() != std::this_thread::get_id())
+        reactor_thread_.join();
+}
+
+bool SIYI_SDK::is_running() const {
+    return live;
+}
+
+bool SIYI_SDK::set_request_rate(uint8_t cmd_id, double rate_hz) {
+    if (rate_hz < 0.) return false;
+
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    PeriodicRequest *request = find_periodic_request(cmd_id);
+    if (request == nullptr) return false;
+
+    request->period_ns = rate_hz > 0. ? std::max<int64_t>(int64_t(1e9 / rate_hz), 1) : 0;
+    request->next_due_ns = monotonic_ns();
+    arm_timer();
+    return true;
+}
+
+double SIYI_SDK::get_request_rate(uint8_t cmd_id) const {
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    for (const PeriodicRequest &request: schedule_)
+        if (request.cmd_id == cmd_id) return request.period_ns > 0 ? 1e9 / double(request.period_ns) : 0.;
+    return 0.;
+}
+
+bool SIYI_SDK::set_tx_tick_rate(double rate_hz) {
+    if (rate_hz <= 0.) return false;
+
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    tx_tick_period_ns_ = std::max<int64_t>(int64_t(1e9 / rate_hz), 1);
+    tx_next_tick_ns_ = monotonic_ns();
+    arm_timer();
+    return true;
+}
+
+SIYI_SDK::TxStats SIYI_SDK::get_tx_stats() const {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    return tx_stats_;
+}
+
+void SIYI_SDK::set_ack_timeout(int timeout_ms) {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    ack_timeout_ns_ = int64_t(std::max(timeout_ms, 1)) * 1000000;
+}
+
+SIYI_SDK::CommandLatency SIYI_SDK::get_command_latency(uint8_t cmd_id) const {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    return summarize_latency(cmd_id);
+}
+
+std::vector<SIYI_SDK::CommandLatency> SIYI_SDK::get_command_latencies() const {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    std::vector<CommandLatency> latencies;
+    for (const auto &entry: tracking_) latencies.push_back(summarize_latency(entry.first));
+    return latencies;
+}
+
+void SIYI_SDK::reset_command_latencies() {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    tracking_.clear();
+}
+
+SIYI_SDK::CommandLatency SIYI_SDK::summarize_latency(uint8_t cmd_id) const {
+    CommandLatency latency;
+    latency.cmd_id = cmd_id;
+
+    auto it = tracking_.find(cmd_id);
+    if (it == tracking_.end()) return latency;
+
+    const CommandTracking &tracking = it->second;
+    latency.sent = tracking.sent;
+    latency.replies = tracking.rtt_us.count();
+    latency.timeouts = tracking.timeouts;
+    latency.unmatched = tracking.unmatched;
+    latency.p50_ms = double(tracking.rtt_us.value_at_percentile(50.)) / 1000.;
+    latency.p99_ms = double(tracking.rtt_us.value_at_percentile(99.)) / 1000.;
+    latency.max_ms = double(tracking.rtt_us.max()) / 1000.;
+    latency.mean_ms = tracking.rtt_us.mean() / 1000.;
+    return latency;
+}
+
+void SIYI_SDK::track_sent(const SIYI_Packet &packet, int64_t now_ns) {
+    if (packet.size < SIYI_Packet::FRAME_OVERHEAD || !expects_reply(packet.bytes[7])) return;
+
+    auto seq = static_cast<uint16_t>(packet.bytes[5] | (packet.bytes[6] << 8));
+    uint8_t cmd_id = packet.bytes[7];
+    tracking_[cmd_id].sent++;
+
+    InFlight &slot = inflight_[seq % INFLIGHT_CAPACITY];
+    if (slot.sent_ns != 0) {
+        tracking_[slot.cmd_id].timeouts++;
+        inflight_count_--;
+    }
+    slot.sent_ns = now_ns;
+    slot.seq = seq;
+    slot.cmd_id = cmd_id;
+    inflight_count_++;
+}
+
+void SIYI_SDK::track_reply(const SIYI_Frame &frame, int64_t now_ns) {
+    if (!expects_reply(frame.cmd_id)) return;
+
+    CommandTracking &tracking = tracking_[frame.cmd_id];
+    InFlight *match = nullptr;
+    InFlight &slot = inflight_[frame.seq % INFLIGHT_CAPACITY];
+    if (slot.sent_ns != 0 && slot.seq == frame.seq && slot.cmd_id == frame.cmd_id) {
+        match = &slot;
+    } else if (inflight_count_ > 0) {
+        // Replies may carry the gimbal's own sequence number, then the oldest request of that type is answered
+        for (InFlight &entry: inflight_)
+            if (entry.sent_ns != 0 && entry.cmd_id == frame.cmd_id && (match == nullptr || entry.sent_ns < match->sent_ns))
+                match = &entry;
+    }
+
+    if (match == nullptr) {
+        tracking.unmatched++;
+        return;
+    }
+    tracking.rtt_us.record(uint64_t(std::max<int64_t>(now_ns - match->sent_ns, 0) / 1000));
+    match->sent_ns = 0;
+    inflight_count_--;
+}
+
+void SIYI_SDK::sweep_ack_timeouts(int64_t now_ns) {
+    if (inflight_count_ == 0) return;
+
+    for (InFlight &entry: inflight_) {
+        if (entry.sent_ns == 0 || now_ns - entry.sent_ns < ack_timeout_ns_) continue;
+        tracking_[entry.cmd_id].timeouts++;
+        entry.sent_ns = 0;
+        inflight_count_--;
+    }
+}
+
+SIYI_SDK::PeriodicRequest *SIYI_SDK::find_periodic_request(uint8_t cmd_id) {
+    for (PeriodicRequest &request: schedule_)
+        if (request.cmd_id == cmd_id) return &request;
+    return nullptr;
+}
+
 bool SIYI_SDK::send_message(const std::string &message) {
     // Convert the hex string to bytes
     std::stringstream ss(message);
@@ -51,249 +273,403 @@ bool SIYI_SDK::send_message(const std::string &message) {
     return true;
 }
 
-void SIYI_SDK::receive_message_loop(bool &connected) {
-    while (connected) {
-        char buff[BUFFER_SIZE];
-        int bytes = int(recvfrom(sockfd_, buff, BUFFER_SIZE, 0, (struct sockaddr *) &server_addr_, &server_addr_len));
-        
-        // Verify if any data was received
-        if (bytes <= 0) {
-            std::cerr << "Error: No data received or connection error (bytes=" << bytes << ")" << std::endl;
-            continue;
-        }
-        
-        // Convert received bytes to hex string in uppercase
-        std::stringstream ss;
-        ss << std::hex << std::uppercase << std::setfill('0');
-        for (int i = 0; i < bytes; i++) {
-            ss << std::setw(2) << (int) (unsigned char) buff[i];
+bool SIYI_SDK::send_packet(const SIYI_Packet &packet) {
+    if (packet.size == 0) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        if (tx_accepting_ && tx_queued_ < TX_QUEUE_CAPACITY) {
+            tx_queue_[tx_queued_++] = packet;
+            return true;
         }
+        tx_stats_.direct_sends++;
+    }
+    return send_packet_now(packet);
+}
 
-        // Convert hex string to lowercase
-        std::string buff_str = ss.str();
-        for (char &i: buff_str) i = char(tolower(i));
+bool SIYI_SDK::send_packet_now(const SIYI_Packet &packet) {
+    if (packet.size == 0) return false;
 
-        // Add a sanity check for buffer length before further processing
-        if (buff_str.length() < MINIMUM_DATA_LENGTH) {
-            std::cerr << "Error: Received data is too short to process. Length: " << buff_str.length() << std::endl;
-            continue;
-        }
+    ssize_t send_len = sendto(sockfd_, packet.bytes, packet.size, 0, (struct sockaddr *) &server_addr_,
+                              sizeof(server_addr_));
+    if (send_len < 0) {
+        std::cout << "Error, failed to send message" << std::endl;
+        return false;
+    }
 
-        // Process the buffer
-        while (buff_str.length() >= MINIMUM_DATA_LENGTH) {
-            if (buff_str.substr(0, 4) != HEADER) {
-                std::cerr << "Error: Invalid header detected. Discarding bytes..." << std::endl;
-                buff_str = buff_str.substr(2); // Shift the buffer by two characters
-                continue;
-            }
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    track_sent(packet, monotonic_ns());
+    return true;
+}
 
-            // Check data length in the message
-            std::string low_b = buff_str.substr(6, 2);
-            std::string high_b = buff_str.substr(8, 2);
-            std::string data_len_str = high_b + low_b;
-            int data_len;
-
-            try {
-                data_len = std::stoi(data_len_str, nullptr, 16);
-            } catch (const std::exception &e) {
-                std::cerr << "Error: Failed to parse data length. " << e.what() << std::endl;
-                buff_str = "";
-                break;
-            }
+void SIYI_SDK::reactor_loop() {
+    struct epoll_event events[4];
+    while (live) {
+        int count = epoll_wait(epoll_fd_, events, 4, -1);
+        reactor_syscalls_++;
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "Error, epoll_wait failed" << std::endl;
+            break;
+        }
 
-            // Ensure buffer has enough data for the payload
-            if (buff_str.length() >= (MINIMUM_DATA_LENGTH + data_len * 2)) {
-                std::string packet = buff_str.substr(0, MINIMUM_DATA_LENGTH + data_len * 2);
-                buff_str = buff_str.substr(MINIMUM_DATA_LENGTH + data_len * 2);
-
-                // Decode the packet
-                std::tuple<std::string, int, std::string, int> decoded = msg.decode_msg(packet);
-                if (std::get<0>(decoded).empty()) {
-                    std::cerr << "Error: Failed to decode message." << std::endl;
-                    continue;
-                }
-
-                std::string data = std::get<0>(decoded);
-                std::string cmd_id = std::get<2>(decoded);
-                int seq = std::get<3>(decoded);
-
-                // Parse message based on command ID
-                if (cmd_id == ACQUIRE_GIMBAL_ATTITUDE) SIYI_SDK::parse_gimbal_attitude_msg(data, seq);
-                else if (cmd_id == ACQUIRE_GIMBAL_INFO) SIYI_SDK::parse_gimbal_info_msg(data, seq);
-                else if (cmd_id == MANUAL_ZOOM) SIYI_SDK::parse_manual_zoom_msg(data, seq);
-                else if (cmd_id == ACQUIRE_FIRMWARE_VERSION) SIYI_SDK::parse_firmware_version_msg(data, seq);
-                else if (cmd_id == ACQUIRE_HARDWARE_ID) SIYI_SDK::parse_hardware_id_msg(data, seq);
-                else if (cmd_id == FUNCTION_FEEDBACK_INFO) SIYI_SDK::parse_function_feedback_msg(data, seq);
-                else if (cmd_id == GIMBAL_ROTATION) SIYI_SDK::parse_gimbal_speed_msg(data, seq);
-                else if (cmd_id == CONTROL_ANGLE) SIYI_SDK::parse_gimbal_angles_msg(data, seq);
-                else if (cmd_id == AUTOFOCUS) SIYI_SDK::parse_autofocus_msg(data, seq);
-                else if (cmd_id == MANUAL_FOCUS) SIYI_SDK::parse_manual_focus_msg(data, seq);
-                else if (cmd_id == CENTER) SIYI_SDK::parse_gimbal_center_msg(data, seq);
-                else if (cmd_id == ABSOLUTE_ZOOM) SIYI_SDK::parse_absolute_zoom_msg(data, seq);
-                else if (cmd_id == ACQUIRE_MAX_ZOOM) SIYI_SDK::parse_maximum_zoom_msg(data, seq);
-            } else {
-                std::cerr << "Error: Incomplete data packet detected. Discarding buffer." << std::endl;
-                buff_str = "";
-                break;
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == sockfd_) handle_readable();
+            else if (fd == timer_fd_) handle_timer();
+            else if (fd == wake_fd_) {
+                uint64_t value;
+                while (read(wake_fd_, &value, sizeof(value)) > 0) reactor_syscalls_++;
+                reactor_syscalls_++;
             }
         }
     }
+
+    // Whatever was queued before stop() still goes out, later packets are sent directly
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        tx_accepting_ = false;
+    }
+    flush_tx();
+}
+
+void SIYI_SDK::handle_readable() {
+    uint8_t buff[BUFFER_SIZE];
+    while (true) {
+        struct sockaddr_in from_addr{};
+        socklen_t from_len = sizeof(from_addr);
+        ssize_t bytes = recvfrom(sockfd_, buff, BUFFER_SIZE, 0, (struct sockaddr *) &from_addr, &from_len);
+        reactor_syscalls_++;
+        if (bytes < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                std::cerr << "Error: receive failed (errno=" << errno << ")" << std::endl;
+            return;
+        }
+        if (bytes > 0) handle_datagram(buff, size_t(bytes));
+    }
 }
 
+void SIYI_SDK::handle_timer() {
+    uint64_t expirations;
+    reactor_syscalls_++;
+    if (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) return;
 
-void SIYI_SDK::gimbal_attitude_loop(bool &connected) {
-    while (connected) {
-        SIYI_SDK::request_gimbal_attitude();
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // set frequency to 100 Hz
+    uint8_t due[NUM_PERIODIC_REQUESTS];
+    int due_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        int64_t now = monotonic_ns();
+        for (PeriodicRequest &request: schedule_) {
+            if (request.period_ns == 0 || request.next_due_ns > now) continue;
+            due[due_count++] = request.cmd_id;
+
+            // Keep the phase, but never send a burst to catch up after a stall
+            request.next_due_ns += request.period_ns;
+            if (request.next_due_ns <= now) request.next_due_ns = now + request.period_ns;
+        }
+        if (tx_next_tick_ns_ <= now) {
+            tx_next_tick_ns_ += tx_tick_period_ns_;
+            if (tx_next_tick_ns_ <= now) tx_next_tick_ns_ = now + tx_tick_period_ns_;
+        }
+        arm_timer();
+        reactor_syscalls_++;
+    }
+
+    // Due requests join the queue and go out in the same batch as the commands queued since the last tick
+    for (int i = 0; i < due_count; i++) send_periodic_request(due[i]);
+    flush_tx();
+
+    {
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        sweep_ack_timeouts(monotonic_ns());
+    }
+
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    tx_stats_.ticks++;
+    tx_stats_.syscalls = reactor_syscalls_;
+    tx_stats_.last_tick_syscalls = static_cast<uint32_t>(reactor_syscalls_ - syscalls_at_last_tick_);
+    syscalls_at_last_tick_ = reactor_syscalls_;
+}
+
+void SIYI_SDK::flush_tx() {
+    int count = 0;
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        for (int i = 0; i < tx_queued_; i++) tx_batch_[count++] = tx_queue_[i];
+        tx_queued_ = 0;
+        if (tx_gimbal_speed_pending_) {
+            tx_batch_[count++] = tx_gimbal_speed_;
+            tx_gimbal_speed_pending_ = false;
+        }
+    }
+    if (count == 0) return;
+
+    struct iovec iov[TX_QUEUE_CAPACITY + 1];
+    struct mmsghdr msgs[TX_QUEUE_CAPACITY + 1];
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = tx_batch_[i].bytes;
+        iov[i].iov_len = tx_batch_[i].size;
+        msgs[i] = {};
+        msgs[i].msg_hdr.msg_name = &server_addr_;
+        msgs[i].msg_hdr.msg_namelen = sizeof(server_addr_);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent = 0;
+    uint64_t batches = 0;
+    while (sent < count) {
+        int result = sendmmsg(sockfd_, msgs + sent, count - sent, 0);
+        reactor_syscalls_++;
+        batches++;
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "Error, failed to send message" << std::endl;
+            break;
+        }
+        sent += result;
+    }
+
+    if (sent > 0) {
+        int64_t now = monotonic_ns();
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        for (int i = 0; i < sent; i++) track_sent(tx_batch_[i], now);
+    }
+
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    tx_stats_.packets += sent;
+    tx_stats_.batches += batches;
+    tx_stats_.send_errors += count - sent;
+    tx_stats_.max_batch = std::max<uint32_t>(tx_stats_.max_batch, count);
+}
+
+void SIYI_SDK::arm_timer() {
+    int64_t next = tx_next_tick_ns_;
+    for (const PeriodicRequest &request: schedule_)
+        if (request.period_ns > 0 && request.next_due_ns < next) next = request.next_due_ns;
+
+    // The transmit tick keeps the timer armed. A zero it_value would disarm it, hence the clamp
+    struct itimerspec spec{};
+    next = std::max<int64_t>(next, 1);
+    spec.it_value.tv_sec = next / 1000000000;
+    spec.it_value.tv_nsec = next % 1000000000;
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void SIYI_SDK::send_periodic_request(uint8_t cmd_id) {
+    switch (cmd_id) {
+        case CMD_ACQUIRE_GIMBAL_ATTITUDE: request_gimbal_attitude(); break;
+        case CMD_ACQUIRE_GIMBAL_INFO: request_gimbal_info(); break;
+        case CMD_ACQUIRE_FIRMWARE_VERSION: request_firmware_version(); break;
+        case CMD_ACQUIRE_HARDWARE_ID:
+            // Initialize hardware ID once (takes some time)
+            if (get_hardware_id().empty()) request_hardware_id();
+            break;
+        default: break;
     }
 }
 
-void SIYI_SDK::gimbal_info_loop(bool &connected) {
-    while (connected) {
-        // Initialize hardware ID once (takes some time)
-        if (SIYI_SDK::get_hardware_id().empty()) SIYI_SDK::request_hardware_id();
+void SIYI_SDK::wait_until_stopped(const bool &connected) {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (connected && live) stop_cv_.wait_for(lock, std::chrono::milliseconds(LEGACY_LOOP_POLL_MS));
+}
+
+void SIYI_SDK::receive_message_loop(bool &connected) {
+    wait_until_stopped(connected);
+}
 
-        SIYI_SDK::request_firmware_version();
-        SIYI_SDK::request_gimbal_info();
-        std::this_thread::sleep_for(std::chrono::seconds(1));  // set frequency to 1 Hz
+void SIYI_SDK::handle_datagram(const uint8_t *data, size_t len) {
+    parser_.push(data, len);
+
+    SIYI_Frame frame;
+    while (parser_.next(frame)) dispatch_frame(frame);
+}
+
+void SIYI_SDK::dispatch_frame(const SIYI_Frame &frame) {
+    {
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        track_reply(frame, monotonic_ns());
+    }
+
+    const uint8_t *data = frame.data;
+    size_t len = frame.data_len;
+    int seq = frame.seq;
+
+    // Parse message based on command ID
+    switch (frame.cmd_id) {
+        case CMD_ACQUIRE_GIMBAL_ATTITUDE: parse_gimbal_attitude_msg(data, len, seq); break;
+        case CMD_ACQUIRE_GIMBAL_INFO: parse_gimbal_info_msg(data, len, seq); break;
+        case CMD_MANUAL_ZOOM: parse_manual_zoom_msg(data, len, seq); break;
+        case CMD_ACQUIRE_FIRMWARE_VERSION: parse_firmware_version_msg(data, len, seq); break;
+        case CMD_ACQUIRE_HARDWARE_ID: parse_hardware_id_msg(data, len, seq); break;
+        case CMD_FUNCTION_FEEDBACK_INFO: parse_function_feedback_msg(data, len, seq); break;
+        case CMD_GIMBAL_ROTATION: parse_gimbal_speed_msg(data, len, seq); break;
+        case CMD_CONTROL_ANGLE: parse_gimbal_angles_msg(data, len, seq); break;
+        case CMD_AUTOFOCUS: parse_autofocus_msg(data, len, seq); break;
+        case CMD_MANUAL_FOCUS: parse_manual_focus_msg(data, len, seq); break;
+        case CMD_CENTER: parse_gimbal_center_msg(data, len, seq); break;
+        case CMD_ABSOLUTE_ZOOM: parse_absolute_zoom_msg(data, len, seq); break;
+        case CMD_ACQUIRE_MAX_ZOOM: parse_maximum_zoom_msg(data, len, seq); break;
+        default: break;
     }
 }
 
+
+void SIYI_SDK::gimbal_attitude_loop(bool &connected) {
+    wait_until_stopped(connected);
+}
+
+void SIYI_SDK::gimbal_info_loop(bool &connected) {
+    wait_until_stopped(connected);
+}
+
 /////////////////////////////////
 //  REQUEST AND SET FUNCTIONS  //
 /////////////////////////////////
 
 bool SIYI_SDK::request_firmware_version() {
-    std::string message = msg.firmware_version_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.firmware_version_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_hardware_id() {
-    std::string message = msg.hardware_id_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.hardware_id_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_autofocus() {
-    std::string message = msg.autofocus_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.autofocus_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_zoom_in() {
-    std::string message = msg.zoom_in_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.zoom_in_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_zoom_out() {
-    std::string message = msg.zoom_out_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.zoom_out_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_zoom_halt() {
-    std::string message = msg.zoom_halt_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.zoom_halt_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::set_absolute_zoom(int integer, int fractional) {
-    std::string message = msg.absolute_zoom_msg(integer, fractional);
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.absolute_zoom_packet(integer, fractional);
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_maximum_zoom() {
-    std::string message = msg.maximum_zoom_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.maximum_zoom_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_focus_far() {
-    std::string message = msg.focus_far_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.focus_far_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_focus_close() {
-    std::string message = msg.focus_close_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.focus_close_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_focus_halt() {
-    std::string message = msg.focus_halt_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.focus_halt_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::set_gimbal_speed(int yaw_speed, int pitch_speed) {
     /// -100~0~100. Away from 0 rotates faster, close to 0 - slower. 0 halts rotation
-    std::string message = msg.gimbal_speed_msg(yaw_speed, pitch_speed);
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.gimbal_speed_packet(yaw_speed, pitch_speed);
+
+    // Only the newest speed is worth sending, it replaces one still waiting for the next tick
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        if (tx_accepting_) {
+            if (tx_gimbal_speed_pending_) tx_stats_.superseded++;
+            tx_gimbal_speed_ = packet;
+            tx_gimbal_speed_pending_ = true;
+            return true;
+        }
+        tx_stats_.direct_sends++;
+    }
+    if (send_packet_now(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_gimbal_center() {
-    std::string message = msg.gimbal_center_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.gimbal_center_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_gimbal_info() {
-    std::string message = msg.gimbal_info_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.gimbal_info_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_lock_mode() {
-    std::string message = msg.lock_mode_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.lock_mode_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_follow_mode() {
-    std::string message = msg.follow_mode_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.follow_mode_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_fpv_mode() {
-    std::string message = msg.fpv_mode_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.fpv_mode_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_function_feedback() {
-    std::string message = msg.function_feedback_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.function_feedback_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_photo() {
-    std::string message = msg.photo_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.photo_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_record() {
     // Start/stop recording
-    std::string message = msg.record_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.record_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::request_gimbal_attitude() {
-    std::string message = msg.gimbal_attitude_msg();
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.gimbal_attitude_packet();
+    if (send_packet(packet)) return true;
     else return false;
 }
 
 bool SIYI_SDK::set_gimbal_angles(float yaw, float pitch) {
-    std::string message = msg.gimbal_angles_msg(yaw, pitch);
-    if (send_message(message)) return true;
+    SIYI_Packet packet = msg.gimbal_angles_packet(yaw, pitch);
+    if (send_packet(packet)) return true;
     else return false;
 }
 
@@ -301,140 +677,233 @@ bool SIYI_SDK::set_gimbal_angles(float yaw, float pitch) {
 //  PARSE FUNCTIONS  //
 ///////////////////////
 
+namespace {
+
+// Convert a hex string payload to bytes, returns the number of bytes written
+size_t hex_to_bytes(const std::string &hex, uint8_t *out, size_t max_len) {
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return 0;
+    };
+    size_t len = 0;
+    for (size_t i = 0; i + 1 < hex.length() && len < max_len; i += 2)
+        out[len++] = static_cast<uint8_t>((nibble(hex[i]) << 4) | nibble(hex[i + 1]));
+    return len;
+}
+
+// Lowercase hex representation, as produced by the hex string codec
+std::string bytes_to_hex(const uint8_t *data, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(len * 2, '0');
+    for (size_t i = 0; i < len; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+int16_t read_int16(const uint8_t *data) {
+    return static_cast<int16_t>(data[0] | (data[1] << 8));
+}
+
+bool any_nonzero(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        if (data[i]) return true;
+    return false;
+}
+
+} // namespace
+
 void SIYI_SDK::parse_firmware_version_msg(const std::string &parse_msg, int seq) {
-    firmware_version_msg.seq = seq;
-    firmware_version_msg.code_board_version = parse_msg.substr(0, 8);
-    firmware_version_msg.gimbal_firmware_version = parse_msg.substr(8, 8);
-    firmware_version_msg.zoom_firmware_version = parse_msg.substr(16, 8);
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_firmware_version_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_hardware_id_msg(const std::string &parse_msg, int seq) {
-    hardware_id_msg.seq = seq;
-    hardware_id_msg.id = parse_msg;
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_hardware_id_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_autofocus_msg(const std::string &parse_msg, int seq) {
-    autofocus_msg.seq = seq;
-    autofocus_msg.success = static_cast<bool>(std::stoi(parse_msg, nullptr, 16));
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_autofocus_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_manual_zoom_msg(const std::string &parse_msg, int seq) {
-    int32_t level;
-
-    std::stringstream ss;
-    ss << std::hex << (parse_msg.substr(2, 2) + parse_msg.substr(0, 2));
-    ss >> level;
-
-    manual_zoom_msg.seq = seq;
-    manual_zoom_msg.zoom_level = float(level / 10.);
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_manual_zoom_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_absolute_zoom_msg(const std::string &parse_msg, int seq) {
-    absoluteZoom_msg.seq = seq;
-    absoluteZoom_msg.success = static_cast<bool>(std::stoi(parse_msg, nullptr, 16));
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_absolute_zoom_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_maximum_zoom_msg(const std::string &parse_msg, int seq) {
-    int max_int = std::stoi(parse_msg.substr(0, 2), nullptr, 16);
-    int max_float = std::stoi(parse_msg.substr(2, 2), nullptr, 16);
-
-    max_zoom_msg.max_level = float((max_int * 10 + max_float) / 10.);
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_maximum_zoom_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_manual_focus_msg(const std::string &parse_msg, int seq) {
-    manual_focus_msg.seq = seq;
-    manual_focus_msg.success = static_cast<bool>(std::stoi(parse_msg, nullptr, 16));
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_manual_focus_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_gimbal_speed_msg(const std::string &parse_msg, int seq) {
-    gimbal_speed_msg.seq = seq;
-    gimbal_speed_msg.success = static_cast<bool>(std::stoi(parse_msg, nullptr, 16));
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_gimbal_speed_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_gimbal_center_msg(const std::string &parse_msg, int seq) {
-    gimbal_center_msg.seq = seq;
-    gimbal_center_msg.success = static_cast<bool>(std::stoi(parse_msg, nullptr, 16));
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_gimbal_center_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_gimbal_info_msg(const std::string &parse_msg, int seq) {
-    int state = std::stoi(parse_msg.substr(6, 2), nullptr, 16);
-    int mode = std::stoi(parse_msg.substr(8, 2), nullptr, 16);
-    int dir = std::stoi(parse_msg.substr(10, 2), nullptr, 16);
-
-    recording_state_msg.seq = seq;
-    mounting_direction_msg.seq = seq;
-    motion_mode_msg.seq = seq;
-    recording_state_msg.state = state;
-    mounting_direction_msg.direction = dir;
-    motion_mode_msg.mode = mode;
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_gimbal_info_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_function_feedback_msg(const std::string &parse_msg, int seq) {
-    function_feedback_msg.seq = seq;
-    function_feedback_msg.info_type = std::stoi(parse_msg, nullptr, 16);
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_function_feedback_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_gimbal_attitude_msg(const std::string &parse_msg, int seq) {
-    int yaw, pitch, roll, yaw_speed, pitch_speed, roll_speed;
-
-    std::stringstream ss;
-    ss << std::hex << (parse_msg.substr(2, 2) + parse_msg.substr(0, 2));
-    ss >> yaw;
-    if (yaw > 65536 / 2) yaw = yaw - 65536;
-    yaw = -yaw;  // reverse yaw as for some reason it is positive when turning clockwise by default
-
-    ss.clear();
-    ss << std::hex << parse_msg.substr(6, 2) + parse_msg.substr(4, 2);
-    ss >> pitch;
-    if (pitch > 65536 / 2) pitch = pitch - 65536;
-
-    ss.clear();
-    ss << std::hex << parse_msg.substr(10, 2) + parse_msg.substr(8, 2);
-    ss >> roll;
-    if (roll > 65536 / 2) roll = roll - 65536;
-
-    ss.clear();
-    ss << std::hex << parse_msg.substr(4, 2) + parse_msg.substr(12, 2);
-    ss >> yaw_speed;
-    if (yaw_speed > 65536 / 2) yaw_speed = yaw_speed - 65536;
-
-    ss.clear();
-    ss << std::hex << parse_msg.substr(18, 2) + parse_msg.substr(16, 2);
-    ss >> pitch_speed;
-    if (pitch_speed > 65536 / 2) pitch_speed = pitch_speed - 65536;
-
-    ss.clear();
-    ss << std::hex << parse_msg.substr(22, 2) + parse_msg.substr(20, 2);
-    ss >> roll_speed;
-    if (roll_speed > 65536 / 2) roll_speed = roll_speed - 65536;
-
-    gimbal_att_msg.seq = seq;
-    gimbal_att_msg.yaw = float(yaw / 10.);
-    gimbal_att_msg.pitch = float(pitch / 10.);
-    gimbal_att_msg.roll = float(roll / 10.);
-    gimbal_att_msg.yaw_speed = float(yaw_speed / 10.);
-    gimbal_att_msg.pitch_speed = float(pitch_speed / 10.);
-    gimbal_att_msg.roll_speed = float(roll_speed / 10.);
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_gimbal_attitude_msg(data, len, seq);
 }
 
 void SIYI_SDK::parse_gimbal_angles_msg(const std::string &parse_msg, int seq) {
-    int yaw, pitch, roll;
+    uint8_t data[SIYI_Packet::MAX_DATA_LENGTH];
+    size_t len = hex_to_bytes(parse_msg, data, sizeof(data));
+    parse_gimbal_angles_msg(data, len, seq);
+}
+
+void SIYI_SDK::parse_firmware_version_msg(const uint8_t *data, size_t len, int seq) {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    firmware_version_msg.seq = seq;
+    firmware_version_msg.code_board_version = bytes_to_hex(data, std::min<size_t>(len, 4));
+    firmware_version_msg.gimbal_firmware_version = bytes_to_hex(data + 4, len > 4 ? std::min<size_t>(len - 4, 4) : 0);
+    firmware_version_msg.zoom_firmware_version = bytes_to_hex(data + 8, len > 8 ? std::min<size_t>(len - 8, 4) : 0);
+}
+
+void SIYI_SDK::parse_hardware_id_msg(const uint8_t *data, size_t len, int seq) {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    hardware_id_msg.seq = seq;
+    hardware_id_msg.id = bytes_to_hex(data, len);
+}
+
+void SIYI_SDK::parse_autofocus_msg(const uint8_t *data, size_t len, int seq) {
+    autofocus_msg.seq = seq;
+    autofocus_msg.success = any_nonzero(data, len);
+}
+
+void SIYI_SDK::parse_manual_zoom_msg(const uint8_t *data, size_t len, int /*seq*/) {
+    if (len < 2) return;
+
+    int level = data[0] | (data[1] << 8);
+
+    std::lock_guard<std::mutex> lock(telemetry_write_mutex_);
+    telemetry_staging_.zoom_level = float(level / 10.);
+    publish_telemetry(monotonic_ns());
+}
+
+void SIYI_SDK::parse_absolute_zoom_msg(const uint8_t *data, size_t len, int seq) {
+    absoluteZoom_msg.seq = seq;
+    absoluteZoom_msg.success = any_nonzero(data, len);
+}
+
+void SIYI_SDK::parse_maximum_zoom_msg(const uint8_t *data, size_t len, int /*seq*/) {
+    if (len < 2) return;
+
+    int max_int = data[0];
+    int max_float = data[1];
+
+    std::lock_guard<std::mutex> lock(telemetry_write_mutex_);
+    telemetry_staging_.max_zoom = float((max_int * 10 + max_float) / 10.);
+    publish_telemetry(monotonic_ns());
+}
+
+void SIYI_SDK::parse_manual_focus_msg(const uint8_t *data, size_t len, int seq) {
+    manual_focus_msg.seq = seq;
+    manual_focus_msg.success = any_nonzero(data, len);
+}
+
+void SIYI_SDK::parse_gimbal_speed_msg(const uint8_t *data, size_t len, int seq) {
+    gimbal_speed_msg.seq = seq;
+    gimbal_speed_msg.success = any_nonzero(data, len);
+}
+
+void SIYI_SDK::parse_gimbal_center_msg(const uint8_t *data, size_t len, int seq) {
+    gimbal_center_msg.seq = seq;
+    gimbal_center_msg.success = any_nonzero(data, len);
+}
+
+void SIYI_SDK::parse_gimbal_info_msg(const uint8_t *data, size_t len, int /*seq*/) {
+    if (len < 6) return;
+
+    int state = data[3];
+    int mode = data[4];
+    int dir = data[5];
+
+    std::lock_guard<std::mutex> lock(telemetry_write_mutex_);
+    telemetry_staging_.recording_state = state;
+    telemetry_staging_.mounting_direction = dir;
+    telemetry_staging_.motion_mode = mode;
+    publish_telemetry(monotonic_ns());
+}
+
+void SIYI_SDK::parse_function_feedback_msg(const uint8_t *data, size_t len, int /*seq*/) {
+    if (len < 1) return;
+
+    std::lock_guard<std::mutex> lock(telemetry_write_mutex_);
+    telemetry_staging_.function_feedback = data[0];
+    publish_telemetry(monotonic_ns());
+}
+
+void SIYI_SDK::parse_gimbal_attitude_msg(const uint8_t *data, size_t len, int /*seq*/) {
+    if (len < 12) return;
 
-    std::stringstream ss;
-    ss << std::hex << (parse_msg.substr(2, 2) + parse_msg.substr(0, 2));
-    ss >> yaw;
-    if (yaw > 65536 / 2) yaw = yaw - 65536;
-    yaw = -yaw;  // reverse yaw as for some reason it is positive when turning clockwise by default
+    // int16 values in tenths of a degree (per second), little-endian
+    int yaw = -read_int16(data);  // reverse yaw as for some reason it is positive when turning clockwise by default
+    int pitch = read_int16(data + 2);
+    int roll = read_int16(data + 4);
+    int yaw_speed = read_int16(data + 6);
+    int pitch_speed = read_int16(data + 8);
+    int roll_speed = read_int16(data + 10);
 
-    ss.clear();
-    ss << std::hex << parse_msg.substr(6, 2) + parse_msg.substr(4, 2);
-    ss >> pitch;
-    if (pitch > 65536 / 2) pitch = pitch - 65536;
+    std::lock_guard<std::mutex> lock(telemetry_write_mutex_);
+    telemetry_staging_.yaw = float(yaw / 10.);
+    telemetry_staging_.pitch = float(pitch / 10.);
+    telemetry_staging_.roll = float(roll / 10.);
+    telemetry_staging_.yaw_speed = float(yaw_speed / 10.);
+    telemetry_staging_.pitch_speed = float(pitch_speed / 10.);
+    telemetry_staging_.roll_speed = float(roll_speed / 10.);
+    telemetry_staging_.attitude_timestamp_ns = monotonic_ns();
+    publish_telemetry(telemetry_staging_.attitude_timestamp_ns);
+}
 
-    ss.clear();
-    ss << std::hex << parse_msg.substr(10, 2) + parse_msg.substr(8, 2);
-    ss >> roll;
-    if (roll > 65536 / 2) roll = roll - 65536;
+void SIYI_SDK::parse_gimbal_angles_msg(const uint8_t *data, size_t len, int seq) {
+    if (len < 6) return;
+
+    int yaw = -read_int16(data);  // reverse yaw as for some reason it is positive when turning clockwise by default
+    int pitch = read_int16(data + 2);
+    int roll = read_int16(data + 4);
 
     gimbal_angles_msg.seq = seq;
     gimbal_angles_msg.yaw = float(yaw / 10.);
@@ -442,53 +911,67 @@ void SIYI_SDK::parse_gimbal_angles_msg(const std::string &parse_msg, int seq) {
     gimbal_angles_msg.roll = float(roll / 10.);
 }
 
+void SIYI_SDK::publish_telemetry(int64_t rx_timestamp_ns) {
+    telemetry_staging_.sequence++;
+    telemetry_staging_.rx_timestamp_ns = rx_timestamp_ns;
+    telemetry_.store(telemetry_staging_);
+}
+
 /////////////////////
 //  GET FUNCTIONS  //
 /////////////////////
 
+SIYI_SDK::GimbalTelemetry SIYI_SDK::get_telemetry() const {
+    return telemetry_.load();
+}
+
 std::tuple<std::string, std::string, std::string> SIYI_SDK::get_firmware_version() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
     return std::make_tuple(firmware_version_msg.code_board_version, firmware_version_msg.gimbal_firmware_version,
                            firmware_version_msg.zoom_firmware_version);
 }
 
 std::string SIYI_SDK::get_hardware_id() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
     return hardware_id_msg.id;
 }
 
 float SIYI_SDK::get_zoom_level() const {
-    return manual_zoom_msg.zoom_level;
+    return telemetry_.load().zoom_level;
 }
 
 float SIYI_SDK::get_maximum_zoom() const {
-    return max_zoom_msg.max_level;
+    return telemetry_.load().max_zoom;
 }
 
 int SIYI_SDK::get_recording_state() const {
     // 0 - off, 1 - on, 2 - slot empty, 3 - data loss
-    return recording_state_msg.state;
+    return telemetry_.load().recording_state;
 }
 
 int SIYI_SDK::get_motion_mode() const {
     // 0 - lock, 1 - follow, 2 - FPV
-    return motion_mode_msg.mode;
+    return telemetry_.load().motion_mode;
 }
 
 int SIYI_SDK::get_mounting_direction() const {
     // 0 - normal, 1 - upside
-    return mounting_direction_msg.direction;
+    return telemetry_.load().mounting_direction;
 }
 
 int SIYI_SDK::get_function_feedback() const {
     // 0 - successful, 1 - photo fail, 2 - HDR on, 3 - HDR off, 4 - record fail
-    return function_feedback_msg.info_type;
+    return telemetry_.load().function_feedback;
 }
 
 std::tuple<float, float, float> SIYI_SDK::get_gimbal_attitude() const {
     // yaw, pitch, roll angles in degrees
-    return std::make_tuple(gimbal_att_msg.yaw, gimbal_att_msg.pitch, gimbal_att_msg.roll);
+    GimbalTelemetry telemetry = telemetry_.load();
+    return std::make_tuple(telemetry.yaw, telemetry.pitch, telemetry.roll);
 }
 
 std::tuple<float, float, float> SIYI_SDK::get_gimbal_attitude_speed() const {
     // yaw, pitch, roll speeds in degrees/second
-    return std::make_tuple(gimbal_att_msg.yaw_speed, gimbal_att_msg.pitch_speed, gimbal_att_msg.roll_speed);
+    GimbalTelemetry telemetry = telemetry_.load();
+    return std::make_tuple(telemetry.yaw_speed, telemetry.pitch_speed, telemetry.roll_speed);
 }
\ No newline at end of file
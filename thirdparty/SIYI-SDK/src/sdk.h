@@ -3,10 +3,18 @@
 
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "message.h"
+#include "frame_parser.h"
+#include "latency_histogram.h"
+#include "seqlock.h"
 
 class SIYI_SDK {
 public:
@@ -100,10 +108,95 @@ public:
         float roll = 0.;
     };
 
+    // Everything the gimbal reports periodically, published as one consistent snapshot
+    struct GimbalTelemetry {
+        uint64_t sequence = 0;          // incremented on every published update
+        int64_t rx_timestamp_ns = 0;    // CLOCK_MONOTONIC time of the last update, 0 before any
+        int64_t attitude_timestamp_ns = 0;
+        float yaw = 0.;
+        float pitch = 0.;
+        float roll = 0.;
+        float yaw_speed = 0.;
+        float pitch_speed = 0.;
+        float roll_speed = 0.;
+        float zoom_level = -1;
+        float max_zoom = 0.;
+        int recording_state = -1;
+        int motion_mode = -1;
+        int mounting_direction = -1;
+        int function_feedback = -1;
+    };
+
+    // Transmit counters of the reactor, see get_tx_stats()
+    struct TxStats {
+        uint64_t ticks = 0;                 // reactor timer expiries, each one flushes the queue
+        uint64_t packets = 0;               // packets handed to the kernel by the reactor
+        uint64_t batches = 0;               // sendmmsg calls
+        uint64_t superseded = 0;            // gimbal speed commands replaced before they were sent
+        uint64_t direct_sends = 0;          // sendto on the caller's thread: reactor stopped or queue full
+        uint64_t send_errors = 0;
+        uint64_t syscalls = 0;              // all syscalls made by the reactor thread
+        uint32_t last_tick_syscalls = 0;    // reactor syscalls since the tick before, receiving included
+        uint32_t max_batch = 0;
+    };
+
+    // Round trip of one command type, from the request leaving the socket to its reply being parsed
+    struct CommandLatency {
+        uint8_t cmd_id = 0;
+        uint64_t sent = 0;
+        uint64_t replies = 0;
+        uint64_t timeouts = 0;      // no reply within the acknowledgement timeout
+        uint64_t unmatched = 0;     // replies with no request in flight
+        double p50_ms = 0.;
+        double p99_ms = 0.;
+        double max_ms = 0.;
+        double mean_ms = 0.;
+    };
+
     bool send_message(const std::string &message);
 
+    // Queue a packet, the reactor sends everything queued with one sendmmsg per timer tick
+    bool send_packet(const SIYI_Packet &packet);
+
+    // Send a packet right away from the calling thread
+    bool send_packet_now(const SIYI_Packet &packet);
+
+    // How often the reactor flushes the transmit queue when no periodic request is due, 100 Hz by default
+    bool set_tx_tick_rate(double rate_hz);
+
+    [[nodiscard]] TxStats get_tx_stats() const;
+
+    // Requests that got no reply within this time count as timeouts, 1 s by default
+    void set_ack_timeout(int timeout_ms);
+
+    [[nodiscard]] CommandLatency get_command_latency(uint8_t cmd_id) const;
+
+    // Every command type that was sent or replied to so far
+    [[nodiscard]] std::vector<CommandLatency> get_command_latencies() const;
+
+    void reset_command_latencies();
+
+    // Stop the I/O reactor. It is woken immediately, the call returns once its thread has exited
+    void stop();
+
+    [[nodiscard]] bool is_running() const;
+
+    // Set how often the reactor sends a periodic request, 0 disables it. Only the telemetry requests
+    // CMD_ACQUIRE_GIMBAL_ATTITUDE, CMD_ACQUIRE_GIMBAL_INFO, CMD_ACQUIRE_FIRMWARE_VERSION and
+    // CMD_ACQUIRE_HARDWARE_ID (sent until the ID is known) can be scheduled
+    bool set_request_rate(uint8_t cmd_id, double rate_hz);
+
+    [[nodiscard]] double get_request_rate(uint8_t cmd_id) const;
+
+    // Receiving and periodic requests are done by the reactor. The loops below are kept for existing
+    // callers and only block until the flag is cleared or the SDK is stopped
     void receive_message_loop(bool &connected);
 
+    // Feed received bytes to the frame parser and dispatch every complete frame to its parse_* handler
+    void handle_datagram(const uint8_t *data, size_t len);
+
+    void dispatch_frame(const SIYI_Frame &frame);
+
     void gimbal_attitude_loop(bool &connected);
 
     void gimbal_info_loop(bool &connected);
@@ -187,10 +280,40 @@ public:
 
     void parse_gimbal_angles_msg(const std::string &parse_msg, int seq);
 
+    // Byte-oriented variants, the hex string variants above decode into these
+    void parse_firmware_version_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_hardware_id_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_autofocus_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_manual_zoom_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_absolute_zoom_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_maximum_zoom_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_manual_focus_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_gimbal_speed_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_gimbal_center_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_gimbal_info_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_function_feedback_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_gimbal_attitude_msg(const uint8_t *data, size_t len, int seq);
+
+    void parse_gimbal_angles_msg(const uint8_t *data, size_t len, int seq);
+
     /////////////////////
     //  GET FUNCTIONS  //
     /////////////////////
 
+    // Lock-free, never waits for the receive path
+    [[nodiscard]] GimbalTelemetry get_telemetry() const;
+
     [[nodiscard]] std::tuple<std::string, std::string, std::string> get_firmware_version() const;
 
     [[nodiscard]] std::string get_hardware_id() const;
@@ -212,29 +335,122 @@ public:
     [[nodiscard]] std::tuple<float, float, float> get_gimbal_attitude_speed() const;
 
 private:
+    // Stamp and publish telemetry_staging_, caller holds telemetry_write_mutex_
+    void publish_telemetry(int64_t rx_timestamp_ns);
+
+    // Written by the parse functions under telemetry_write_mutex_, read through the seqlock
+    GimbalTelemetry telemetry_staging_;
+    SeqLock<GimbalTelemetry> telemetry_;
+    std::mutex telemetry_write_mutex_;
+
+    // Strings cannot live in the seqlock, they change rarely and sit behind a mutex
     FirmwareVersionMsg firmware_version_msg;
     HardwareIDMsg hardware_id_msg;
+    mutable std::mutex info_mutex_;
+
     AutofocusMsg autofocus_msg;
-    ManualZoomMsg manual_zoom_msg;
-    MaxZoomMsg max_zoom_msg;
     AbsoluteZoomMsg absoluteZoom_msg;
     ManualFocusMsg manual_focus_msg;
     GimbalSpeedMsg gimbal_speed_msg;
     CenterMsg gimbal_center_msg;
-    RecordingStateMsg recording_state_msg;
-    MountingDirectionMsg mounting_direction_msg;
-    MotionModeMsg motion_mode_msg;
-    FunctionFeedbackMsg function_feedback_msg;
-    GimbalAttitudeMsg gimbal_att_msg;
     GimbalAnglesMsg gimbal_angles_msg;
 
-    bool live = false;
-    std::thread receive_message_thread;
-    std::thread gimbal_attitude_thread;
-    std::thread gimbal_info_thread;
-    const int MINIMUM_DATA_LENGTH = 20;
-    const int BUFFER_SIZE = 1024;
-    std::string HEADER = "5566";
+    struct PeriodicRequest {
+        uint8_t cmd_id;
+        int64_t period_ns;    // 0 when disabled
+        int64_t next_due_ns;  // CLOCK_MONOTONIC
+    };
+
+    void reactor_loop();
+
+    void handle_readable();
+
+    void handle_timer();
+
+    // Program the timerfd for the earliest due request or transmit tick, caller holds schedule_mutex_
+    void arm_timer();
+
+    void send_periodic_request(uint8_t cmd_id);
+
+    // Send everything queued since the last tick, reactor thread only
+    void flush_tx();
+
+    // Acknowledgement tracking, all under ack_mutex_
+    void track_sent(const SIYI_Packet &packet, int64_t now_ns);
+
+    void track_reply(const SIYI_Frame &frame, int64_t now_ns);
+
+    void sweep_ack_timeouts(int64_t now_ns);
+
+    [[nodiscard]] CommandLatency summarize_latency(uint8_t cmd_id) const;
+
+    void wait_until_stopped(const bool &connected);
+
+    PeriodicRequest *find_periodic_request(uint8_t cmd_id);
+
+    static constexpr int NUM_PERIODIC_REQUESTS = 4;
+    PeriodicRequest schedule_[NUM_PERIODIC_REQUESTS] = {
+            {CMD_ACQUIRE_GIMBAL_ATTITUDE, 10000000, 0},     // 100 Hz
+            {CMD_ACQUIRE_GIMBAL_INFO, 1000000000, 0},       // 1 Hz
+            {CMD_ACQUIRE_FIRMWARE_VERSION, 1000000000, 0},  // 1 Hz
+            {CMD_ACQUIRE_HARDWARE_ID, 1000000000, 0},       // 1 Hz until known
+    };
+    int64_t tx_tick_period_ns_ = 10000000;
+    int64_t tx_next_tick_ns_ = 0;
+    mutable std::mutex schedule_mutex_;
+
+    // Outbound queue, only the newest gimbal speed command is kept
+    static constexpr int TX_QUEUE_CAPACITY = 32;
+    SIYI_Packet tx_queue_[TX_QUEUE_CAPACITY];
+    int tx_queued_ = 0;
+    SIYI_Packet tx_gimbal_speed_;
+    bool tx_gimbal_speed_pending_ = false;
+    bool tx_accepting_ = false;
+    TxStats tx_stats_;
+    mutable std::mutex tx_mutex_;
+
+    // Requests waiting for a reply, slot chosen by sequence number. Consecutive sequence numbers
+    // never share a slot, so only a request that has been waiting for 256 sends gets evicted
+    struct InFlight {
+        int64_t sent_ns = 0;  // 0 when the slot is free
+        uint16_t seq = 0;
+        uint8_t cmd_id = 0;
+    };
+
+    struct CommandTracking {
+        LatencyHistogram rtt_us;
+        uint64_t sent = 0;
+        uint64_t timeouts = 0;
+        uint64_t unmatched = 0;
+    };
+
+    static constexpr int INFLIGHT_CAPACITY = 256;
+    InFlight inflight_[INFLIGHT_CAPACITY];
+    int inflight_count_ = 0;
+    int64_t ack_timeout_ns_ = 1000000000;
+    std::map<uint8_t, CommandTracking> tracking_;
+    mutable std::mutex ack_mutex_;
+
+    // Owned by the reactor thread
+    SIYI_Packet tx_batch_[TX_QUEUE_CAPACITY + 1];
+    uint64_t reactor_syscalls_ = 0;
+    uint64_t syscalls_at_last_tick_ = 0;
+
+    std::atomic<bool> live{false};
+    std::thread reactor_thread_;
+    std::mutex join_mutex_;
+
+    // Wakes the legacy loops when the SDK stops
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    static constexpr int LEGACY_LOOP_POLL_MS = 20;
+
+    static constexpr int BUFFER_SIZE = 1024;
+    SIYI_FrameParser parser_;
+
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int wake_fd_ = -1;
 
     int sockfd_;
     struct sockaddr_in server_addr_{};
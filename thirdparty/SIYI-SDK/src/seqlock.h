@@ -0,0 +1,67 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Sequence lock around a trivially copyable value. Readers never block the writer: they copy the
+// value and retry if a store happened meanwhile. Stores must be serialized by the caller.
+// The payload is kept in atomic words so that a torn read is a retry, not a data race.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() {
+        store(T{});
+        seq_.store(0, std::memory_order_relaxed);
+    }
+
+    void store(const T &value) {
+        uint64_t words[WORDS]{};
+        std::memcpy(words, &value, sizeof(T));
+
+        // An odd sequence tells readers a store is in progress. The payload stores are release so a
+        // reader that sees any new word also sees the odd sequence on its second check
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        for (size_t i = 0; i < WORDS; i++) data_[i].store(words[i], std::memory_order_release);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copy the value if no store is in progress or completes during the copy
+    bool try_load(T &out) const {
+        uint64_t before = seq_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        uint64_t words[WORDS];
+        for (size_t i = 0; i < WORDS; i++) words[i] = data_[i].load(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != before) return false;
+
+        std::memcpy(&out, words, sizeof(T));
+        return true;
+    }
+
+    [[nodiscard]] T load() const {
+        T value;
+        for (int spins = 0; !try_load(value); spins++)
+            if (spins >= 64) std::this_thread::yield();
+        return value;
+    }
+
+    // Number of completed stores since construction
+    [[nodiscard]] uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Own cache line for the sequence so readers polling it do not share one with unrelated members
+    alignas(64) std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> data_[WORDS];
+};
+
+#endif // SEQLOCK_H